@@ -0,0 +1,960 @@
+#define _POSIX_C_SOURCE 200809L
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "core/JobSystem.h"
+#include "ecs/PhysicsQuery.h"
+#include "ecs/System.h"
+#include "ecs/World.h"
+#include "maths/Maths3D.h"
+#include "assets/Mesh.h"
+#include "scene/SceneParser.h"
+
+// Micro-benchmark suite for the simulation hot paths. Every case runs a
+// few untimed warmup samples, then SAMPLES timed ones, each with its own
+// untimed setup/teardown. Results are reported per operation as
+// min/median/mean/stddev/p95 on stdout and, with --out, as JSON.
+// After the timings, a few checks assert that the parallel paths give
+// the same results as the serial ones; a failed check makes the suite
+// exit non-zero.
+//
+//   bench_suite [--filter substring] [--quick] [--out path]
+
+#define WARMUP    3
+#define SAMPLES   15
+#define MAX_CASES 64
+
+typedef void (*BenchFn)(void *ctx);
+
+typedef struct {
+  char    name[64];
+  int     ops;
+  int     samples;
+  double  min_ns;
+  double  median_ns;
+  double  mean_ns;
+  double  stddev_ns;
+  double  p95_ns;
+} BenchResult;
+
+static BenchResult results[MAX_CASES];
+static int result_count = 0;
+static const char *filter = NULL;
+static int quick = 0;
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compare_double(const void *a, const void *b) {
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// load_obj and the scene parser log every mesh to stdout; keep that out
+// of the report.
+static int quiet_fd = -1;
+
+static void quiet_begin(void) {
+  fflush(stdout);
+  quiet_fd = dup(STDOUT_FILENO);
+  int null_fd = open("/dev/null", O_WRONLY);
+  dup2(null_fd, STDOUT_FILENO);
+  close(null_fd);
+}
+
+static void quiet_end(void) {
+  fflush(stdout);
+  dup2(quiet_fd, STDOUT_FILENO);
+  close(quiet_fd);
+}
+
+static const char* format_time(char *buf, size_t size, double ns) {
+  if (ns < 1e3)       snprintf(buf, size, "%8.2f ns", ns);
+  else if (ns < 1e6)  snprintf(buf, size, "%8.2f us", ns / 1e3);
+  else                snprintf(buf, size, "%8.2f ms", ns / 1e6);
+  return buf;
+}
+
+static void bench_run(const char *name, int ops, BenchFn setup, BenchFn fn, BenchFn teardown, void *ctx) {
+  if (filter && !strstr(name, filter)) return;
+  if (result_count == MAX_CASES) {
+    printf("Failed to add benchmark - hit max case count of: %d\n", result_count);
+    return;
+  }
+
+  int samples = quick ? 5 : SAMPLES;
+  double times[SAMPLES];
+
+  for (int i = 0; i < WARMUP + samples; i++) {
+    if (setup) setup(ctx);
+    double start = now_s();
+    fn(ctx);
+    double t = now_s() - start;
+    if (teardown) teardown(ctx);
+    if (i >= WARMUP) times[i - WARMUP] = t * 1e9 / ops;
+  }
+
+  qsort(times, samples, sizeof(double), compare_double);
+  double sum = 0.0, sq = 0.0;
+  for (int i = 0; i < samples; i++) sum += times[i];
+  double mean = sum / samples;
+  for (int i = 0; i < samples; i++) sq += (times[i] - mean) * (times[i] - mean);
+
+  BenchResult *r = &results[result_count++];
+  snprintf(r->name, sizeof(r->name), "%s", name);
+  r->ops        = ops;
+  r->samples    = samples;
+  r->min_ns     = times[0];
+  r->median_ns  = times[samples / 2];
+  r->mean_ns    = mean;
+  r->stddev_ns  = samples > 1 ? sqrt(sq / (samples - 1)) : 0.0;
+  r->p95_ns     = times[(int)ceil(0.95 * samples) - 1];
+
+  char median[32], min[32], stddev[32], p95[32];
+  printf("%-44s %8d %12s %12s %12s %12s\n", r->name, r->ops,
+         format_time(median, sizeof(median), r->median_ns),
+         format_time(min, sizeof(min), r->min_ns),
+         format_time(stddev, sizeof(stddev), r->stddev_ns),
+         format_time(p95, sizeof(p95), r->p95_ns));
+}
+
+
+// ECS
+
+typedef struct {
+  World   world;
+  Entity  *entities;
+  int     n;
+  float   sink;
+} EcsCtx;
+
+static void ecs_populate(EcsCtx *c) {
+  world_init(&c->world);
+  srand(1);
+  for (int i = 0; i < c->n; i++) {
+    Entity e = world_create_entity(&c->world);
+    c->entities[i] = e;
+    world_add_position(&c->world, e, (Vec3f){(float)(rand() % 1000), 1.0f, (float)(rand() % 1000)});
+    world_add_rotation(&c->world, e, (Vec3f){0.1f * i, 0.2f, 0.0f});
+    world_add_mesh(&c->world, e, 0);
+    if (i % 2) world_add_velocity(&c->world, e, (Vec3f){1.0f, 0.0f, 0.0f});
+  }
+}
+
+static void ecs_init(void *ctx) {
+  EcsCtx *c = ctx;
+  world_init(&c->world);
+}
+
+static void ecs_teardown(void *ctx) {
+  EcsCtx *c = ctx;
+  world_destroy(&c->world);
+}
+
+static void ecs_add(void *ctx) {
+  EcsCtx *c = ctx;
+  for (int i = 0; i < c->n; i++) {
+    Entity e = world_create_entity(&c->world);
+    world_add_position(&c->world, e, (Vec3f){(float)i, 0.0f, 0.0f});
+    world_add_velocity(&c->world, e, (Vec3f){1.0f, 0.0f, 0.0f});
+    world_add_mesh(&c->world, e, 0);
+  }
+}
+
+static void ecs_get(void *ctx) {
+  EcsCtx *c = ctx;
+  float sum = 0.0f;
+  for (int i = 0; i < c->n; i++) {
+    Entity e = c->entities[(i * 7919) % c->n];
+    PositionComponent *pc = world_get_position(&c->world, e);
+    VelocityComponent *vc = world_get_velocity(&c->world, e);
+    sum += pc->position.x + (vc ? vc->velocity.x : 0.0f);
+  }
+  c->sink += sum;
+}
+
+static void ecs_iterate(void *ctx) {
+  EcsCtx *c = ctx;
+  float sum = 0.0f;
+  QueryIter it = query_iter(&c->world, COMPONENT_BIT(COMPONENT_POSITION) | COMPONENT_BIT(COMPONENT_VELOCITY));
+  while (query_next(&it)) {
+    PositionComponent *pc = it.components[COMPONENT_POSITION];
+    VelocityComponent *vc = it.components[COMPONENT_VELOCITY];
+    sum += pc->position.x * vc->velocity.x;
+  }
+  c->sink += sum;
+}
+
+static void ecs_transforms_dirty(void *ctx) {
+  EcsCtx *c = ctx;
+  ecs_populate(c);
+  world_update_transforms(&c->world);
+  for (int i = 0; i < c->n; i++) world_mark_transform_dirty(&c->world, c->entities[i]);
+}
+
+static void ecs_get_transform(void *ctx) {
+  EcsCtx *c = ctx;
+  float sum = 0.0f;
+  for (int i = 0; i < c->n; i++) {
+    Mat4 m = world_get_transform(&c->world, c->entities[i]);
+    sum += m.m[0][3];
+  }
+  c->sink += sum;
+}
+
+// Spawn/destroy churn: a steady population where half the entities die
+// and are replaced every round, alternating which half.
+#define CHURN_LIVE    10000
+#define CHURN_ROUNDS  200
+
+typedef struct {
+  World   world;
+  Entity  live[CHURN_LIVE];
+  Entity  doomed[CHURN_LIVE / 2];
+  int     rounds;
+} ChurnCtx;
+
+static void churn_spawn(ChurnCtx *c, int i) {
+  Entity e = world_create_entity(&c->world);
+  c->live[i] = e;
+  world_add_position(&c->world, e, (Vec3f){(float)i, 1.0f, 0.0f});
+  world_add_velocity(&c->world, e, (Vec3f){1.0f, 0.0f, 0.0f});
+  world_add_mass(&c->world, e, 1.0f);
+}
+
+static void churn_setup(void *ctx) {
+  ChurnCtx *c = ctx;
+  world_init(&c->world);
+  for (int i = 0; i < CHURN_LIVE; i++) churn_spawn(c, i);
+}
+
+static void churn_teardown(void *ctx) {
+  ChurnCtx *c = ctx;
+  world_destroy(&c->world);
+}
+
+static void churn_rounds(void *ctx) {
+  ChurnCtx *c = ctx;
+  for (int r = 0; r < c->rounds; r++) {
+    for (int i = 0; i < CHURN_LIVE / 2; i++) c->doomed[i] = c->live[2 * i + (r & 1)];
+    world_destroy_entities(&c->world, c->doomed, CHURN_LIVE / 2);
+    for (int i = 0; i < CHURN_LIVE / 2; i++) churn_spawn(c, 2 * i + (r & 1));
+  }
+}
+
+static long peak_rss_kb(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+static void bench_ecs(void) {
+  int sizes[] = { 10000, 100000 };
+  char name[64];
+
+  // First, so the peak RSS is not masked by the larger cases below. With
+  // slots recycled the peak should not move between the short and the
+  // long run.
+  static ChurnCtx churn;
+  int rounds[] = { 1, quick ? 20 : CHURN_ROUNDS };
+  for (int i = 0; i < 2; i++) {
+    churn.rounds = rounds[i];
+    snprintf(name, sizeof(name), "ecs/churn/%d", churn.rounds * CHURN_LIVE / 2);
+    int count = result_count;
+    bench_run(name, churn.rounds * CHURN_LIVE / 2, churn_setup, churn_rounds, churn_teardown, &churn);
+    if (result_count > count) printf("%-44s peak RSS %ld KB\n", name, peak_rss_kb());
+  }
+
+  for (int s = 0; s < 2; s++) {
+    EcsCtx c = { .n = sizes[s] };
+    c.entities = malloc(c.n * sizeof(Entity));
+
+    snprintf(name, sizeof(name), "ecs/add_3/%d", c.n);
+    bench_run(name, c.n, ecs_init, ecs_add, ecs_teardown, &c);
+
+    ecs_populate(&c);
+    snprintf(name, sizeof(name), "ecs/get_2/%d", c.n);
+    bench_run(name, c.n, NULL, ecs_get, NULL, &c);
+    snprintf(name, sizeof(name), "ecs/iterate_pos_vel/%d", c.n);
+    bench_run(name, c.n / 2, NULL, ecs_iterate, NULL, &c);
+    world_update_transforms(&c.world);
+    snprintf(name, sizeof(name), "ecs/get_transform_cached/%d", c.n);
+    bench_run(name, c.n, NULL, ecs_get_transform, NULL, &c);
+    world_destroy(&c.world);
+
+    snprintf(name, sizeof(name), "ecs/get_transform_dirty/%d", c.n);
+    bench_run(name, c.n, ecs_transforms_dirty, ecs_get_transform, ecs_teardown, &c);
+
+    free(c.entities);
+  }
+}
+
+
+// MATH
+
+#define MATH_OPS 200000
+
+typedef struct {
+  Vec3f *angles;
+  Mat4  *mats;
+  float sink;
+} MathCtx;
+
+static void math_mul(void *ctx) {
+  MathCtx *c = ctx;
+  Mat4 acc = mat4_identity();
+  for (int i = 0; i < MATH_OPS; i++) {
+    acc = mat4_mul(c->mats[i & 1023], acc);
+    acc.m[3][3] = 1.0f;
+  }
+  c->sink += acc.m[0][0];
+}
+
+static void math_rotation(void *ctx) {
+  MathCtx *c = ctx;
+  float sum = 0.0f;
+  for (int i = 0; i < MATH_OPS; i++) sum += mat4_rotation(c->angles[i & 1023]).m[0][1];
+  c->sink += sum;
+}
+
+static void math_trs(void *ctx) {
+  MathCtx *c = ctx;
+  float sum = 0.0f;
+  for (int i = 0; i < MATH_OPS; i++) {
+    Vec3f a = c->angles[i & 1023];
+    sum += mat4_trs(a, a, (Vec3f){1.0f, 2.0f, 1.0f}).m[0][1];
+  }
+  c->sink += sum;
+}
+
+static void bench_math(void) {
+  MathCtx c = {0};
+  c.angles = malloc(1024 * sizeof(Vec3f));
+  c.mats   = malloc(1024 * sizeof(Mat4));
+  for (int i = 0; i < 1024; i++) {
+    c.angles[i] = (Vec3f){i * 0.01f, i * 0.02f, i * 0.03f};
+    c.mats[i]   = mat4_rotation(c.angles[i]);
+  }
+
+  bench_run("math/mat4_mul", MATH_OPS, NULL, math_mul, NULL, &c);
+  bench_run("math/mat4_rotation", MATH_OPS, NULL, math_rotation, NULL, &c);
+  bench_run("math/mat4_trs", MATH_OPS, NULL, math_trs, NULL, &c);
+
+  free(c.angles);
+  free(c.mats);
+}
+
+
+// PHYSICS
+
+typedef struct {
+  World           world;
+  int             colliders;
+  BroadphaseType  broadphase;
+} CollisionCtx;
+
+// A static floor plus boxes scattered over an area that grows with the
+// count, so the density of overlaps stays roughly constant.
+static void collision_setup(void *ctx) {
+  CollisionCtx *c = ctx;
+  systems_set_broadphase(c->broadphase);
+  world_init(&c->world);
+  srand(3);
+
+  float extent = sqrtf((float)c->colliders) * 2.0f;
+  Entity floor = world_create_entity(&c->world);
+  world_add_position(&c->world, floor, (Vec3f){0.0f, 0.0f, 0.0f});
+  world_add_collider(&c->world, floor, (Vec3f){extent, 0.1f, extent}, 1, 0.3f, 0.8f);
+
+  for (int i = 0; i < c->colliders; i++) {
+    Entity e = world_create_entity(&c->world);
+    Vec3f p = {
+      ((float)rand() / RAND_MAX * 2.0f - 1.0f) * extent,
+      0.5f + (float)(rand() % 4),
+      ((float)rand() / RAND_MAX * 2.0f - 1.0f) * extent
+    };
+    world_add_position(&c->world, e, p);
+    world_add_collider(&c->world, e, (Vec3f){0.5f, 0.5f, 0.5f}, i % 4 == 0, 0.3f, 0.5f);
+  }
+  update_systems(&c->world, 1.0f / 60.0f);
+}
+
+static void collision_teardown(void *ctx) {
+  CollisionCtx *c = ctx;
+  world_destroy(&c->world);
+}
+
+static void collision_tick(void *ctx) {
+  CollisionCtx *c = ctx;
+  update_systems(&c->world, 1.0f / 60.0f);
+}
+
+typedef struct {
+  World   world;
+  int     statics;
+} LevelCtx;
+
+// Level geometry: a grid of static tiles and pillars, baked as a scene
+// load would, with 256 bodies resting on it.
+static void level_setup(void *ctx) {
+  LevelCtx *c = ctx;
+  world_init(&c->world);
+
+  int side = (int)sqrtf((float)c->statics);
+  for (int i = 0; i < c->statics; i++) {
+    Entity e = world_create_entity(&c->world);
+    float x = (float)(i % side) * 2.0f, z = (float)(i / side) * 2.0f;
+    int pillar = i % 7 == 0;
+    world_add_position(&c->world, e, (Vec3f){x, pillar ? 1.0f : 0.0f, z});
+    world_add_collider(&c->world, e, (Vec3f){1.0f, pillar ? 1.0f : 0.1f, 1.0f}, 1, 0.3f, 0.8f);
+  }
+  for (int i = 0; i < 256; i++) {
+    Entity e = world_create_entity(&c->world);
+    world_add_position(&c->world, e, (Vec3f){(float)(i % 16) * 3.0f + 1.0f, 0.6f, (float)(i / 16) * 3.0f + 1.0f});
+    world_add_mass(&c->world, e, 1.0f);
+    world_add_collider(&c->world, e, (Vec3f){0.5f, 0.5f, 0.5f}, 0, 0.3f, 0.5f);
+  }
+  systems_bake_statics(&c->world);
+  update_systems(&c->world, 1.0f / 60.0f);
+}
+
+static void level_teardown(void *ctx) {
+  LevelCtx *c = ctx;
+  world_destroy(&c->world);
+}
+
+static void level_tick(void *ctx) {
+  LevelCtx *c = ctx;
+  update_systems(&c->world, 1.0f / 60.0f);
+}
+
+typedef struct {
+  World   world;
+  int     bodies;
+  int     sleeping;
+} RestingCtx;
+
+// Clusters of 16 bodies settled on a floor, timed once they are at rest:
+// with sleeping on every cluster has fallen asleep by then.
+static void resting_setup(void *ctx) {
+  RestingCtx *c = ctx;
+  systems_set_sleeping(c->sleeping);
+  world_init(&c->world);
+
+  int side = (int)sqrtf((float)c->bodies);
+  Entity floor = world_create_entity(&c->world);
+  world_add_position(&c->world, floor, (Vec3f){0.0f, 0.0f, 0.0f});
+  world_add_collider(&c->world, floor, (Vec3f){(float)side * 2.0f, 0.1f, (float)side * 2.0f}, 1, 0.3f, 0.8f);
+
+  for (int i = 0; i < c->bodies; i++) {
+    Entity e = world_create_entity(&c->world);
+    int x = i % side, z = i / side;
+    Vec3f p = {
+      (float)x * 1.05f + (float)(x / 4) * 2.0f - (float)side,
+      0.6f,
+      (float)z * 1.05f + (float)(z / 4) * 2.0f - (float)side
+    };
+    world_add_position(&c->world, e, p);
+    world_add_mass(&c->world, e, 1.0f);
+    world_add_collider(&c->world, e, (Vec3f){0.5f, 0.5f, 0.5f}, 0, 0.3f, 0.5f);
+  }
+  systems_bake_statics(&c->world);
+  for (int i = 0; i < 90; i++) update_systems(&c->world, 1.0f / 60.0f);
+}
+
+static void resting_teardown(void *ctx) {
+  RestingCtx *c = ctx;
+  world_destroy(&c->world);
+}
+
+static void resting_tick(void *ctx) {
+  RestingCtx *c = ctx;
+  update_systems(&c->world, 1.0f / 60.0f);
+}
+
+typedef struct {
+  World       world;
+  int         side;
+} MeshLevelCtx;
+
+static float terrain_height(float x, float z) {
+  return sinf(x * 0.3f) * cosf(z * 0.3f);
+}
+
+// The same kind of level as one triangle-mesh collider: a side x side quad
+// heightfield with 256 bodies resting on it.
+static void mesh_level_setup(void *ctx) {
+  MeshLevelCtx *c = ctx;
+  world_init(&c->world);
+
+  int n = c->side + 1;
+  Vec3f *positions = malloc(n * n * sizeof(Vec3f));
+  int *indices = malloc(c->side * c->side * 6 * sizeof(int));
+  int index_count = 0;
+  for (int z = 0; z < n; z++) {
+    for (int x = 0; x < n; x++) positions[z * n + x] = (Vec3f){(float)x, terrain_height(x, z), (float)z};
+  }
+  for (int z = 0; z < c->side; z++) {
+    for (int x = 0; x < c->side; x++) {
+      int a = z * n + x, b = a + 1, d = a + n, e = d + 1;
+      indices[index_count++] = a;
+      indices[index_count++] = d;
+      indices[index_count++] = b;
+      indices[index_count++] = b;
+      indices[index_count++] = d;
+      indices[index_count++] = e;
+    }
+  }
+  Entity terrain = world_create_entity(&c->world);
+  world_add_position(&c->world, terrain, (Vec3f){0.0f, 0.0f, 0.0f});
+  world_add_mesh_collider(&c->world, terrain, positions, indices, index_count, vec3f_identity(),
+                          (Vec3f){1.0f, 1.0f, 1.0f}, 0.3f, 0.8f);
+  free(positions);
+  free(indices);
+
+  float spacing = (float)c->side / 16.0f;
+  for (int i = 0; i < 256; i++) {
+    Entity e = world_create_entity(&c->world);
+    float x = ((float)(i % 16) + 0.5f) * spacing, z = ((float)(i / 16) + 0.5f) * spacing;
+    world_add_position(&c->world, e, (Vec3f){x, terrain_height(x, z) + 1.0f, z});
+    world_add_mass(&c->world, e, 1.0f);
+    world_add_collider(&c->world, e, (Vec3f){0.5f, 0.5f, 0.5f}, 0, 0.3f, 0.5f);
+  }
+  systems_bake_statics(&c->world);
+  for (int i = 0; i < 30; i++) update_systems(&c->world, 1.0f / 60.0f);
+}
+
+static void mesh_level_teardown(void *ctx) {
+  MeshLevelCtx *c = ctx;
+  world_destroy(&c->world);
+}
+
+static void mesh_level_tick(void *ctx) {
+  MeshLevelCtx *c = ctx;
+  update_systems(&c->world, 1.0f / 60.0f);
+}
+
+#define QUERY_RAYS 4096
+
+typedef struct {
+  LevelCtx    level;
+  PhysicsRay  rays[QUERY_RAYS];
+  PhysicsHit  hits[QUERY_RAYS];
+} QueryCtx;
+
+// Gameplay-style probes over the static level: each body casts a ground
+// probe and seven line-of-sight rays fanned out around it, 8 rays per
+// body in a row so each packet shares an origin.
+static void query_setup(void *ctx) {
+  QueryCtx *c = ctx;
+  level_setup(&c->level);
+  srand(5);
+  for (int i = 0; i < QUERY_RAYS; i++) {
+    Vec3f origin = { (float)(i / 8 % 64) * 3.0f + 1.0f, 1.2f, (float)(i / 512) * 3.0f + 1.0f };
+    float angle = (float)(i % 8) * 0.9f;
+    Vec3f dir = i % 8 == 0 ? (Vec3f){0.0f, -1.0f, 0.0f} :
+                             (Vec3f){cosf(angle), ((float)rand() / RAND_MAX - 0.5f) * 0.2f, sinf(angle)};
+    c->rays[i] = (PhysicsRay){ origin, dir, i % 8 == 0 ? 4.0f : 30.0f, ENTITY_NONE };
+  }
+  physics_refresh(&c->level.world);
+}
+
+static void query_teardown(void *ctx) {
+  QueryCtx *c = ctx;
+  level_teardown(&c->level);
+}
+
+static void query_raycast(void *ctx) {
+  QueryCtx *c = ctx;
+  for (int i = 0; i < QUERY_RAYS; i++) {
+    const PhysicsRay *r = &c->rays[i];
+    physics_raycast(&c->level.world, r->origin, r->dir, r->max_t, r->ignore, &c->hits[i]);
+  }
+}
+
+static void query_raycast_batch(void *ctx) {
+  QueryCtx *c = ctx;
+  physics_raycast_batch(&c->level.world, c->rays, c->hits, QUERY_RAYS);
+}
+
+static void query_overlap_box(void *ctx) {
+  QueryCtx *c = ctx;
+  Entity found[64];
+  for (int i = 0; i < QUERY_RAYS; i += 8) {
+    physics_overlap_box(&c->level.world, c->rays[i].origin, (Vec3f){1.5f, 1.5f, 1.5f}, ENTITY_NONE, found, 64);
+  }
+}
+
+// Brute force is the O(n^2) reference and stops at 3200 colliders.
+static void bench_physics(void) {
+  int counts[] = { 100, 400, 1600, 3200, 12800 };
+  BroadphaseType types[] = {
+    BROADPHASE_BRUTE_FORCE, BROADPHASE_SPATIAL_HASH, BROADPHASE_SWEEP_AND_PRUNE, BROADPHASE_DYNAMIC_TREE
+  };
+  char name[64];
+
+  for (int t = 0; t < 4; t++) {
+    for (int i = 0; i < (quick ? 3 : 5); i++) {
+      if (types[t] == BROADPHASE_BRUTE_FORCE && counts[i] > 3200) continue;
+      CollisionCtx c = { .colliders = counts[i], .broadphase = types[t] };
+      snprintf(name, sizeof(name), "physics/collide_tick/%s/%d", broadphase_name(types[t]), c.colliders);
+      bench_run(name, 1, collision_setup, collision_tick, collision_teardown, &c);
+    }
+  }
+  systems_set_broadphase(BROADPHASE_SPATIAL_HASH);
+
+  int statics[] = { 1000, 10000 };
+  for (int i = 0; i < 2; i++) {
+    LevelCtx c = { .statics = statics[i] };
+    snprintf(name, sizeof(name), "physics/static_level/%d", c.statics);
+    bench_run(name, 1, level_setup, level_tick, level_teardown, &c);
+  }
+
+  QueryCtx *q = malloc(sizeof(QueryCtx));
+  q->level.statics = 10000;
+  bench_run("physics/query/raycast/10000", QUERY_RAYS, query_setup, query_raycast, query_teardown, q);
+  bench_run("physics/query/raycast_batch/10000", QUERY_RAYS, query_setup, query_raycast_batch, query_teardown, q);
+  bench_run("physics/query/overlap_box/10000", QUERY_RAYS / 8, query_setup, query_overlap_box, query_teardown, q);
+  free(q);
+
+  MeshLevelCtx m = { .side = 128 };
+  bench_run("physics/mesh_level/32768", 1, mesh_level_setup, mesh_level_tick, mesh_level_teardown, &m);
+
+  for (int sleeping = 0; sleeping < 2; sleeping++) {
+    RestingCtx c = { .bodies = 4096, .sleeping = sleeping };
+    snprintf(name, sizeof(name), "physics/resting/%s/%d", sleeping ? "asleep" : "awake", c.bodies);
+    bench_run(name, 1, resting_setup, resting_tick, resting_teardown, &c);
+  }
+  systems_set_sleeping(1);
+}
+
+
+// ASSETS
+
+typedef struct {
+  char  path[64];
+  Scene scene;
+} AssetCtx;
+
+// Writes a size x size vertex grid as an OBJ with v/vt/vn and quad faces.
+// 100x100 is the largest grid load_obj accepts (MAX_RAW vertices).
+static void write_grid_obj(const char *path, int size) {
+  FILE *f = fopen(path, "w");
+  for (int z = 0; z < size; z++) {
+    for (int x = 0; x < size; x++) {
+      fprintf(f, "v %f %f %f\n", (float)x, sinf(x * 0.3f) * cosf(z * 0.3f), (float)z);
+      fprintf(f, "vt %f %f\n", (float)x / size, (float)z / size);
+      fprintf(f, "vn 0 1 0\n");
+    }
+  }
+  for (int z = 0; z + 1 < size; z++) {
+    for (int x = 0; x + 1 < size; x++) {
+      int a = z * size + x + 1, b = a + 1, c = a + size, d = c + 1;
+      fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, d, d, d, c, c, c);
+    }
+  }
+  fclose(f);
+}
+
+static void write_scene(const char *path, const char *mesh_path, int objects) {
+  FILE *f = fopen(path, "w");
+  fprintf(f, "mesh cube %s\n\n", mesh_path);
+  fprintf(f, "material red\n  color 1.0 0.2 0.2\nend\n\n");
+  fprintf(f, "material teal\n  color 0.4 0.8 0.8\nend\n\n");
+  fprintf(f, "object cube red\n  scale 100.0 1.0 100.0\n  collider\n    extents 50.0 0.1 50.0\n  end\nend\n\n");
+  for (int i = 0; i < objects; i++) {
+    fprintf(f, "// object %d\n", i);
+    fprintf(f, "object cube %s\n", i % 2 ? "red" : "teal");
+    fprintf(f, "  position %f %f %f\n", (float)(i % 40) * 2.0f - 40.0f, 1.0f + i / 1600, (float)(i / 40 % 40) * 2.0f - 40.0f);
+    fprintf(f, "  scale 0.5 0.5 0.5\n");
+    if (i % 3 == 0) {
+      fprintf(f, "  mass 10.0\n  collider dynamic\n    extents 0.5 0.5 0.5\n    friction 0.6\n  end\n");
+    } else if (i % 3 == 1) {
+      fprintf(f, "  speed 2.0\n  path loop\n    waypoint 0.0 0.0 0.0\n    waypoint 3.0 0.0 0.0\n  end\n");
+    }
+    fprintf(f, "end\n\n");
+  }
+  fclose(f);
+}
+
+static void asset_load_obj(void *ctx) {
+  AssetCtx *c = ctx;
+  quiet_begin();
+  Mesh mesh = load_obj(c->path);
+  quiet_end();
+  free_mesh(&mesh);
+}
+
+static void asset_parse_scene(void *ctx) {
+  AssetCtx *c = ctx;
+  quiet_begin();
+  parse_scene_file(&c->scene, c->path);
+  quiet_end();
+}
+
+static void asset_scene_teardown(void *ctx) {
+  AssetCtx *c = ctx;
+  world_destroy(&c->scene.world);
+}
+
+static void bench_assets(void) {
+  int grids[] = { 32, 64, 100 };
+  int objects[] = { 100, 1000, 5000 };
+  char name[64], mesh_path[64];
+
+  snprintf(mesh_path, sizeof(mesh_path), "/tmp/bench_%d_cube.obj", (int)getpid());
+  write_grid_obj(mesh_path, 4);
+
+  for (int i = 0; i < 3; i++) {
+    AssetCtx c;
+    snprintf(c.path, sizeof(c.path), "/tmp/bench_%d_grid.obj", (int)getpid());
+    write_grid_obj(c.path, grids[i]);
+    snprintf(name, sizeof(name), "assets/load_obj/%dx%d", grids[i], grids[i]);
+    bench_run(name, 1, NULL, asset_load_obj, NULL, &c);
+    remove(c.path);
+  }
+
+  for (int i = 0; i < (quick ? 2 : 3); i++) {
+    AssetCtx c;
+    snprintf(c.path, sizeof(c.path), "/tmp/bench_%d.scene", (int)getpid());
+    write_scene(c.path, mesh_path, objects[i]);
+    snprintf(name, sizeof(name), "assets/parse_scene/%d", objects[i]);
+    bench_run(name, 1, NULL, asset_parse_scene, asset_scene_teardown, &c);
+    remove(c.path);
+  }
+
+  remove(mesh_path);
+}
+
+
+// CHECKS
+
+static int check_failures = 0;
+
+static void bench_check(const char *name, int ok) {
+  printf("%-44s %s\n", name, ok ? "ok" : "FAILED");
+  if (!ok) check_failures++;
+}
+
+static uint64_t hash_store(uint64_t h, World *world, ComponentType type) {
+  SparseSet *set = &world->components[type];
+  const unsigned char *bytes = set->data;
+  for (size_t i = 0; i < (size_t)set->count * set->stride; i++) h = (h ^ bytes[i]) * 1099511628211ull;
+  return (h ^ (uint64_t)set->count) * 1099511628211ull;
+}
+
+static uint64_t hash_bodies(World *world) {
+  uint64_t h = 1469598103934665603ull;
+  h = hash_store(h, world, COMPONENT_POSITION);
+  h = hash_store(h, world, COMPONENT_VELOCITY);
+  return hash_store(h, world, COMPONENT_MASS);
+}
+
+typedef uint64_t (*SimulateFn)(void);
+
+// Runs the simulation with 1, 4 and 8 job threads; positions, velocities
+// and mass state (grounded entity, sleep) must come out bit-identical.
+static void check_thread_counts(const char *name, SimulateFn simulate) {
+  if (filter && !strstr(name, filter)) return;
+  int threads[] = { 1, 4, 8 };
+  uint64_t hashes[3];
+  for (int i = 0; i < 3; i++) {
+    job_system_init(threads[i]);
+    systems_init(threads[i] == 1);
+    hashes[i] = simulate();
+    systems_shutdown();
+    job_system_shutdown();
+  }
+  bench_check(name, hashes[0] == hashes[1] && hashes[0] == hashes[2]);
+}
+
+// Columns of overlapping boxes dropped on a floor, so the narrowphase has
+// thousands of contacts every tick.
+static uint64_t pile_simulate(void) {
+  World world;
+  world_init(&world);
+  Entity floor = world_create_entity(&world);
+  world_add_position(&world, floor, (Vec3f){0.0f, 0.0f, 0.0f});
+  world_add_collider(&world, floor, (Vec3f){40.0f, 0.1f, 40.0f}, 1, 0.3f, 0.8f);
+
+  srand(7);
+  for (int i = 0; i < 2048; i++) {
+    Entity e = world_create_entity(&world);
+    Vec3f p = {
+      (float)(i % 8) * 1.5f + (float)rand() / RAND_MAX * 0.2f,
+      0.6f + (float)(i / 64) * 0.9f,
+      (float)(i / 8 % 8) * 1.5f + (float)rand() / RAND_MAX * 0.2f
+    };
+    world_add_position(&world, e, p);
+    world_add_mass(&world, e, 1.0f);
+    world_add_collider(&world, e, (Vec3f){0.5f, 0.5f, 0.5f}, 0, 0.3f, 0.5f);
+  }
+  for (int i = 0; i < 120; i++) update_systems(&world, 1.0f / 60.0f);
+
+  uint64_t h = hash_bodies(&world);
+  world_destroy(&world);
+  return h;
+}
+
+static Entity spawn_mixed(World *world, int i) {
+  Entity e = world_create_entity(world);
+  Vec3f p = { (float)(rand() % 120) - 60.0f, 1.0f + (float)(rand() % 12), (float)(rand() % 120) - 60.0f };
+  world_add_position(world, e, p);
+  if (i % 3 == 0) {
+    world_add_mass(world, e, 1.0f);
+    world_add_collider(world, e, (Vec3f){0.5f, 0.5f, 0.5f}, 0, 0.3f, 0.5f);
+  } else if (i % 3 == 1) {
+    Path path = { .starting_pos = p, .waypoint_count = 3, .is_loop = i % 2 };
+    path.waypoints[1] = (Vec3f){3.0f, 0.0f, 0.0f};
+    path.waypoints[2] = (Vec3f){3.0f, 0.0f, 3.0f};
+    world_add_speed(world, e, 2.0f);
+    world_add_path(world, e, path);
+  } else {
+    world_add_velocity(world, e, (Vec3f){1.0f, 0.0f, -1.0f});
+  }
+  return e;
+}
+
+// Every kind of row the rigid-body store holds (baked statics, bodies
+// that fall asleep, path followers, plain movers) with entities destroyed
+// and spawned every 20 ticks, so the store layout is rebuilt while bodies
+// sleep.
+static uint64_t mixed_simulate(void) {
+  World world;
+  world_init(&world);
+  Entity floor = world_create_entity(&world);
+  world_add_position(&world, floor, (Vec3f){0.0f, 0.0f, 0.0f});
+  world_add_collider(&world, floor, (Vec3f){80.0f, 0.1f, 80.0f}, 1, 0.3f, 0.8f);
+
+  srand(11);
+  for (int i = 0; i < 200; i++) {
+    Entity e = world_create_entity(&world);
+    world_add_position(&world, e, (Vec3f){(float)(i % 20) * 6.0f - 60.0f, 1.0f, (float)(i / 20) * 12.0f - 60.0f});
+    world_add_collider(&world, e, (Vec3f){1.0f, 1.0f, 1.0f}, 1, 0.3f, 0.8f);
+  }
+  systems_bake_statics(&world);
+
+  Entity spawned[3000];
+  for (int i = 0; i < 3000; i++) spawned[i] = spawn_mixed(&world, i);
+  for (int t = 0; t < 200; t++) {
+    if (t % 20 == 19) {
+      for (int k = 0; k < 32; k++) {
+        int i = rand() % 3000;
+        world_destroy_entity(&world, spawned[i]);
+        spawned[i] = spawn_mixed(&world, i);
+      }
+    }
+    update_systems(&world, 1.0f / 60.0f);
+  }
+
+  uint64_t h = hash_bodies(&world);
+  world_destroy(&world);
+  return h;
+}
+
+static int same_hit(const PhysicsHit *a, const PhysicsHit *b) {
+  if (a->entity != b->entity) return 0;
+  if (a->entity == ENTITY_NONE) return 1;
+  return a->t == b->t &&
+         memcmp(&a->point, &b->point, sizeof(Vec3f)) == 0 &&
+         memcmp(&a->normal, &b->normal, sizeof(Vec3f)) == 0;
+}
+
+// Packet traversal must find exactly the hits single rays do, over both
+// the baked statics and the dynamic tree.
+static void check_raycast_batch(void) {
+  const char *name = "check/raycast_batch";
+  if (filter && !strstr(name, filter)) return;
+  job_system_init(1);
+  systems_init(1);
+
+  QueryCtx *q = malloc(sizeof(QueryCtx));
+  q->level.statics = 10000;
+  query_setup(q);
+  PhysicsHit *single = malloc(QUERY_RAYS * sizeof(PhysicsHit));
+  for (int i = 0; i < QUERY_RAYS; i++) {
+    const PhysicsRay *r = &q->rays[i];
+    physics_raycast(&q->level.world, r->origin, r->dir, r->max_t, r->ignore, &single[i]);
+  }
+  query_raycast_batch(q);
+
+  int mismatches = 0;
+  for (int i = 0; i < QUERY_RAYS; i++) mismatches += !same_hit(&single[i], &q->hits[i]);
+  bench_check(name, mismatches == 0);
+
+  free(single);
+  query_teardown(q);
+  free(q);
+  systems_shutdown();
+  job_system_shutdown();
+}
+
+static void run_checks(void) {
+  check_thread_counts("check/narrowphase_threads", pile_simulate);
+  check_raycast_batch();
+  check_thread_counts("check/rigid_body_threads", mixed_simulate);
+}
+
+
+static int write_json(const char *path) {
+  FILE *f = fopen(path, "w");
+  if (!f) {
+    printf("Failed to open output file: %s\n", path);
+    return 1;
+  }
+
+  fprintf(f, "{\n  \"warmup\": %d,\n  \"results\": [\n", WARMUP);
+  for (int i = 0; i < result_count; i++) {
+    BenchResult *r = &results[i];
+    fprintf(f, "    { \"name\": \"%s\", \"ops\": %d, \"samples\": %d, \"min_ns\": %.3f, \"median_ns\": %.3f, "
+               "\"mean_ns\": %.3f, \"stddev_ns\": %.3f, \"p95_ns\": %.3f }%s\n",
+            r->name, r->ops, r->samples, r->min_ns, r->median_ns, r->mean_ns, r->stddev_ns, r->p95_ns,
+            i + 1 < result_count ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+  fclose(f);
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  const char *out_path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filter = argv[++i];
+    } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      out_path = argv[++i];
+    } else if (strcmp(argv[i], "--quick") == 0) {
+      quick = 1;
+    } else {
+      printf("Unknown argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  // Single-threaded and deterministic so numbers are comparable between
+  // runs and machines.
+  job_system_init(1);
+  systems_init(1);
+
+  printf("%-44s %8s %12s %12s %12s %12s\n", "benchmark (per op)", "ops", "median", "min", "stddev", "p95");
+  bench_ecs();
+  bench_math();
+  bench_physics();
+  bench_assets();
+
+  systems_shutdown();
+  job_system_shutdown();
+  run_checks();
+
+  int status = out_path ? write_json(out_path) : 0;
+  return status || check_failures ? 1 : 0;
+}
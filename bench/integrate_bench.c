@@ -0,0 +1,97 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "physics/Integrate.h"
+
+// Integration kernel benchmark: ns per body for each backend at 10k, 100k
+// and 1M bodies, half of them grounded. Also checks every backend produces
+// the same bits as the scalar path.
+
+#define REPEATS 20
+#define STEPS   10
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fill(IntegrateBatch *b, float *pool, int n) {
+  float **fields[] = {
+    &b->px, &b->py, &b->pz, &b->vx, &b->vy, &b->vz,
+    &b->gravity_scale, &b->damping, &b->threshold
+  };
+  for (int f = 0; f < 9; f++) *fields[f] = pool + (size_t)f * n;
+  b->count = n;
+
+  srand(7);
+  for (int i = 0; i < n; i++) {
+    b->px[i] = (float)(rand() % 1000);
+    b->py[i] = (float)(rand() % 100);
+    b->pz[i] = (float)(rand() % 1000);
+    b->vx[i] = (rand() % 200 - 100) * 0.01f;
+    b->vy[i] = (rand() % 200 - 100) * 0.01f;
+    b->vz[i] = (rand() % 200 - 100) * 0.01f;
+    int grounded = i & 1;
+    b->gravity_scale[i] = grounded ? 0.0f : 1.0f;
+    b->damping[i]       = grounded ? 0.99f : 1.0f;
+    b->threshold[i]     = grounded ? 0.015f : 0.0f;
+  }
+}
+
+static double run(IntegrateBackend backend, float *pool, int n, float *out) {
+  IntegrateBatch b;
+  integrate_set_backend(backend);
+
+  double best = 1e9;
+  for (int r = 0; r < REPEATS; r++) {
+    fill(&b, pool, n);
+    double start = now_s();
+    for (int s = 0; s < STEPS; s++) integrate_batch(&b, 9.8f, 1.0f / 60.0f);
+    double t = now_s() - start;
+    if (t < best) best = t;
+  }
+  if (out) memcpy(out, pool, (size_t)6 * n * sizeof(float));
+  return best * 1e9 / ((double)n * STEPS);
+}
+
+int main(void) {
+  int sizes[] = { 10000, 100000, 1000000 };
+  IntegrateBackend backends[] = {
+    INTEGRATE_SCALAR, INTEGRATE_SSE, INTEGRATE_AVX2, INTEGRATE_NEON
+  };
+
+  float *pool      = malloc((size_t)9 * 1000000 * sizeof(float));
+  float *reference = malloc((size_t)6 * 1000000 * sizeof(float));
+  float *result    = malloc((size_t)6 * 1000000 * sizeof(float));
+
+  printf("bodies    backend  ns/body  speedup  match\n");
+  for (int s = 0; s < 3; s++) {
+    int n = sizes[s];
+    double base = run(INTEGRATE_SCALAR, pool, n, reference);
+    printf("%-9d %-8s %7.3f  %6.2fx  -\n", n, "scalar", base, 1.0);
+
+    const char *seen[4] = { "scalar" };
+    int seen_count = 1;
+    for (int k = 1; k < 4; k++) {
+      integrate_set_backend(backends[k]);
+      const char *name = integrate_backend_name();
+      int dup = 0;
+      for (int j = 0; j < seen_count; j++) dup |= strcmp(name, seen[j]) == 0;
+      if (dup) continue;
+      seen[seen_count++] = name;
+
+      double ns = run(backends[k], pool, n, result);
+      int match = memcmp(reference, result, (size_t)6 * n * sizeof(float)) == 0;
+      printf("%-9d %-8s %7.3f  %6.2fx  %s\n", n, name, ns, base / ns, match ? "yes" : "NO");
+    }
+  }
+
+  free(pool);
+  free(reference);
+  free(result);
+  return 0;
+}
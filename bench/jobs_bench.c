@@ -0,0 +1,100 @@
+#define _POSIX_C_SOURCE 200809L
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "core/JobSystem.h"
+
+// Job system micro-benchmark: per-job scheduling overhead and parallel_for
+// scaling from 1 to N threads on a fixed CPU-bound workload.
+
+#define EMPTY_JOBS    200000
+#define JOB_BATCH     256
+#define WORK_ITEMS    (1 << 22)
+#define REPEATS       5
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void empty_job(void *arg) {
+  (void)arg;
+}
+
+static void empty_range(void *ctx, int begin, int end) {
+  (void)ctx; (void)begin; (void)end;
+}
+
+static void work_range(void *ctx, int begin, int end) {
+  float *data = ctx;
+  for (int i = begin; i < end; i++) {
+    float x = data[i];
+    for (int k = 0; k < 16; k++) x = sqrtf(x * x + 1.0f);
+    data[i] = x;
+  }
+}
+
+static double bench_job_overhead(void) {
+  JobCounter counter;
+  job_counter_init(&counter);
+
+  double start = now_s();
+  for (int done = 0; done < EMPTY_JOBS; done += JOB_BATCH) {
+    for (int i = 0; i < JOB_BATCH; i++) job_run(empty_job, NULL, &counter);
+    job_wait(&counter);
+  }
+  return (now_s() - start) * 1e9 / EMPTY_JOBS;
+}
+
+static double bench_parallel_for_overhead(void) {
+  int calls = 20000;
+  double start = now_s();
+  for (int i = 0; i < calls; i++) job_parallel_for(0, 1024, 16, empty_range, NULL);
+  return (now_s() - start) * 1e9 / calls;
+}
+
+static double bench_work(float *data) {
+  double best = 1e9;
+  for (int r = 0; r < REPEATS; r++) {
+    double start = now_s();
+    job_parallel_for(0, WORK_ITEMS, 0, work_range, data);
+    double t = now_s() - start;
+    if (t < best) best = t;
+  }
+  return best * 1000.0;
+}
+
+// Doubles up to max_threads, ending on max_threads itself when it is not a
+// power of two. Anything past max_threads ends the sweep.
+static int next_thread_count(int threads, int max_threads) {
+  return threads * 2 > max_threads && threads < max_threads ? max_threads : threads * 2;
+}
+
+int main(int argc, char **argv) {
+  int max_threads = argc > 1 ? atoi(argv[1]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (max_threads < 1) max_threads = 1;
+  if (max_threads > MAX_JOB_THREADS) max_threads = MAX_JOB_THREADS;
+
+  float *data = malloc(WORK_ITEMS * sizeof(float));
+  for (int i = 0; i < WORK_ITEMS; i++) data[i] = (float)i;
+
+  printf("threads  job_ns  parallel_for_ns  work_ms  speedup\n");
+  double base = 0.0;
+  for (int threads = 1; threads <= max_threads; threads = next_thread_count(threads, max_threads)) {
+    job_system_init(threads);
+    double job_ns = bench_job_overhead();
+    double for_ns = bench_parallel_for_overhead();
+    double work_ms = bench_work(data);
+    job_system_shutdown();
+
+    if (threads == 1) base = work_ms;
+    printf("%7d  %6.1f  %15.1f  %7.2f  %7.2fx\n", threads, job_ns, for_ns, work_ms, base / work_ms);
+  }
+
+  free(data);
+  return 0;
+}
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "src/core/JobSystem.h"
+#include "src/core/Trace.h"
+#include "src/ecs/System.h"
+#include "src/scene/SceneParser.h"
+
+// Headless simulation runner: loads a scene without a window or GL
+// context, runs update_systems for a fixed number of ticks and prints
+// throughput, per-system timings and peak memory as JSON. Built with
+// TRACE=1 it also writes the trace zones of the run on exit.
+//
+//   renderer_headless [--scene path] [--ticks n] [--hz n] [--threads n]
+//                     [--deterministic] [--out path] [--trace path]
+//                     [--broadphase brute_force|spatial_hash|sweep_and_prune|dynamic_tree]
+
+#define DEFAULT_SCENE "scenes/scene1.scene"
+#define DEFAULT_TICKS 10000
+#define DEFAULT_HZ    60
+
+static double now_s(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int parse_broadphase(const char *name, BroadphaseType *out) {
+  BroadphaseType types[] = {
+    BROADPHASE_BRUTE_FORCE, BROADPHASE_SPATIAL_HASH, BROADPHASE_SWEEP_AND_PRUNE, BROADPHASE_DYNAMIC_TREE
+  };
+  for (int i = 0; i < (int)(sizeof(types) / sizeof(types[0])); i++) {
+    if (strcmp(name, broadphase_name(types[i])) == 0) {
+      *out = types[i];
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static long peak_rss_kb(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+int main(int argc, char **argv) {
+  char *scene_path = DEFAULT_SCENE;
+  const char *out_path = NULL;
+  const char *trace_path = TRACE_DUMP_PATH;
+  int ticks = DEFAULT_TICKS;
+  int hz = DEFAULT_HZ;
+  int threads = 0;
+  int deterministic = 0;
+  BroadphaseType broadphase = BROADPHASE_SPATIAL_HASH;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) {
+      scene_path = argv[++i];
+    } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+      ticks = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--hz") == 0 && i + 1 < argc) {
+      hz = atoi(argv[++i]);
+      if (hz <= 0) {
+        printf("Invalid tick rate: %s\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      out_path = argv[++i];
+    } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      trace_path = argv[++i];
+    } else if (strcmp(argv[i], "--broadphase") == 0 && i + 1 < argc) {
+      if (!parse_broadphase(argv[++i], &broadphase)) {
+        printf("Unknown broadphase: %s\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--deterministic") == 0) {
+      deterministic = 1;
+    } else {
+      printf("Unknown argument: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  job_system_init(threads);
+  systems_set_broadphase(broadphase);
+  systems_init(deterministic);
+
+  Scene scene;
+  double load_start = now_s();
+  if (parse_scene_file(&scene, scene_path) != 0) return 1;
+  double load_s = now_s() - load_start;
+
+  const Scheduler *scheduler = systems_scheduler();
+  double system_ms[MAX_SYSTEMS] = {0};
+
+  double start = now_s();
+  for (int t = 0; t < ticks; t++) {
+    update_systems(&scene.world, 1.0f / hz);
+    for (int i = 0; i < scheduler->count; i++) {
+      system_ms[i] += scheduler->timings_ms[i];
+    }
+  }
+  double elapsed = now_s() - start;
+
+  FILE *out = stdout;
+  if (out_path) {
+    out = fopen(out_path, "w");
+    if (!out) {
+      printf("Failed to open output file: %s\n", out_path);
+      return 1;
+    }
+  }
+
+  fprintf(out, "{\n");
+  fprintf(out, "  \"scene\": \"%s\",\n", scene_path);
+  fprintf(out, "  \"ticks\": %d,\n", ticks);
+  fprintf(out, "  \"hz\": %d,\n", hz);
+  fprintf(out, "  \"threads\": %d,\n", job_thread_count());
+  fprintf(out, "  \"deterministic\": %d,\n", deterministic);
+  fprintf(out, "  \"broadphase\": \"%s\",\n", broadphase_name(broadphase));
+  fprintf(out, "  \"entities\": %d,\n", world_entity_count(&scene.world));
+  fprintf(out, "  \"load_ms\": %.3f,\n", load_s * 1000.0);
+  fprintf(out, "  \"elapsed_ms\": %.3f,\n", elapsed * 1000.0);
+  fprintf(out, "  \"ticks_per_sec\": %.1f,\n", elapsed > 0.0 ? ticks / elapsed : 0.0);
+  fprintf(out, "  \"systems\": [\n");
+  for (int i = 0; i < scheduler->count; i++) {
+    fprintf(out, "    { \"name\": \"%s\", \"total_ms\": %.3f, \"us_per_tick\": %.3f }%s\n",
+            scheduler->systems[i].name, system_ms[i],
+            ticks > 0 ? system_ms[i] * 1000.0 / ticks : 0.0,
+            i + 1 < scheduler->count ? "," : "");
+  }
+  fprintf(out, "  ],\n");
+  fprintf(out, "  \"peak_rss_kb\": %ld\n", peak_rss_kb());
+  fprintf(out, "}\n");
+  if (out != stdout) fclose(out);
+
+  if (trace_enabled()) trace_dump(trace_path);
+
+  world_destroy(&scene.world);
+  systems_shutdown();
+  job_system_shutdown();
+  trace_shutdown();
+  return 0;
+}
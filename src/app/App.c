@@ -4,11 +4,17 @@
 #include "rendering/Shader.h"
 #include "scene/Scene.h"
 #include "ecs/System.h"
+#include "ecs/Snapshot.h"
 #include "assets/Grid.h"
+#include "core/JobSystem.h"
+#include "core/Trace.h"
 #include "Input.h"
 
 const char* APP_NAME = "Renderer";
 
+// Frames of history kept for rewinding with R.
+#define HISTORY_FRAMES 600
+
 void setup_cursor_callback(App *app, Scene *scene) {
   glfwSetWindowUserPointer(app->window, &scene->world.camera);
   glfwSetCursorPosCallback(app->window, mouse_callback);
@@ -69,9 +75,16 @@ int app_create(App *app, int width, int height) {
   app->shader = shader;
   app->flat_shader = flat_shader;
 
+  job_system_init(0);
+
   return 0;
 }
 
+static void swap_buffers(App *app) {
+  TRACE_FN();
+  glfwSwapBuffers(app->window);
+}
+
 void app_run(App *app) {
   Scene scene;
   scene_create(&scene);
@@ -80,24 +93,40 @@ void app_run(App *app) {
 
   setup_cursor_callback(app, &scene);
 
+  SnapshotRing history;
+  snapshot_ring_init(&history, HISTORY_FRAMES);
+
   float last_frame_time = glfwGetTime();
 
   while (!glfwWindowShouldClose(app->window)) {
+    TRACE_ZONE("frame");
     float now = glfwGetTime();
     float delta_time = now - last_frame_time;
     last_frame_time = now;
 
     handle_input(app, &scene, delta_time);
 
-    update_systems(&scene.world, delta_time);
+    if (glfwGetKey(app->window, GLFW_KEY_R) == GLFW_PRESS) {
+      snapshot_ring_pop(&history, &scene.world);
+    } else {
+      snapshot_ring_push(&history, &scene.world);
+      update_systems(&scene.world, delta_time);
+    }
 
     scene_render(&scene, app);
+    swap_buffers(app);
   }
 
+  if (trace_enabled()) trace_dump(TRACE_DUMP_PATH);
+
+  snapshot_ring_destroy(&history);
   scene_destroy(&scene);
 }
 
 void app_destroy(App *app) {
+  systems_shutdown();
+  job_system_shutdown();
+  trace_shutdown();
   shader_free(app->shader);
   shader_free(app->flat_shader);
   glfwTerminate();
@@ -1,5 +1,6 @@
 #include "Input.h"
 #include "GLFW/glfw3.h"
+#include "core/Trace.h"
 #include "ecs/System.h"
 #include "scene/camera.h"
 
@@ -31,6 +32,7 @@ float clampf(float value, float max, float min) {
 }
 
 void handle_input(App *app, Scene *scene, float dt) {
+  TRACE_FN();
   glfwPollEvents();
 
   if (glfwGetKey(app->window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -47,6 +49,13 @@ void handle_input(App *app, Scene *scene, float dt) {
     jump(&scene->world, scene->world.player.entity);
   if (glfwGetKey(app->window, GLFW_KEY_G) == GLFW_PRESS)
     scene->grid.visible = !scene->grid.visible;
+
+  // Dump once per press, not once per frame the key is held.
+  static int trace_key_down = 0;
+  int trace_key = glfwGetKey(app->window, GLFW_KEY_T) == GLFW_PRESS;
+  if (trace_key && !trace_key_down)
+    trace_dump(TRACE_DUMP_PATH);
+  trace_key_down = trace_key;
 }
 
 void mouse_callback(GLFWwindow *window, double mx, double my) {
@@ -1,4 +1,5 @@
 #include "Mesh.h"
+#include "core/Trace.h"
 #include "maths/Maths3D.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -34,6 +35,7 @@ static int find_or_add_vertex(
 }
 
 Mesh load_obj(const char *path) {
+  TRACE_FN();
   Mesh mesh = {0};
 
   FILE *f = fopen(path, "r");
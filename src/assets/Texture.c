@@ -2,10 +2,13 @@
 
 #include <stdio.h>
 
+#include "core/Trace.h"
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "vendor/stb_image.h"
 
 GLuint texture_load(const char* path) {
+  TRACE_FN();
   GLuint id;
   glGenTextures(1, &id);
   glBindTexture(GL_TEXTURE_2D, id);
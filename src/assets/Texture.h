@@ -1,7 +1,11 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#ifdef HEADLESS
+typedef unsigned int GLuint;
+#else
 #include <GL/glew.h>
+#endif
 
 GLuint  texture_load(const char *path);
 void    texture_free(GLuint texture_id);
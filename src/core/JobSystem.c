@@ -0,0 +1,308 @@
+#define _POSIX_C_SOURCE 200809L
+#include "JobSystem.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define DEQUE_SIZE      4096
+#define DEQUE_MASK      (DEQUE_SIZE - 1)
+#define MAX_FOR_CHUNKS  256
+#define SPIN_ROUNDS     64
+
+typedef struct {
+  JobFn       fn;
+  void        *arg;
+  JobCounter  *counter;
+} Job;
+
+// A job as stored in a deque slot. Thieves read a slot before their CAS
+// on `top` decides whether they got it, so the owner may be refilling it
+// at the same time; the fields are atomics so that read is never torn.
+typedef struct {
+  _Atomic(JobFn)        fn;
+  _Atomic(void *)       arg;
+  _Atomic(JobCounter *) counter;
+} JobSlot;
+
+// Chase-Lev deque: the owner pushes/pops at `bottom`, thieves CAS `top`.
+// Jobs are stored by value, and a slot is only written once the push knows
+// it is free, so a queued job is never overwritten.
+typedef struct {
+  JobSlot         slots[DEQUE_SIZE];
+  atomic_long     top;
+  atomic_long     bottom;
+} JobQueue;
+
+typedef struct {
+  JobQueue        queues[MAX_JOB_THREADS];
+  pthread_t       threads[MAX_JOB_THREADS];
+  int             thread_count;
+  atomic_int      running;
+  atomic_int      queued;
+  atomic_int      sleeping;
+  pthread_mutex_t lock;
+  pthread_cond_t  wake;
+} JobSystem;
+
+static JobSystem jobs;
+static int jobs_ready = 0;
+static _Thread_local int thread_index = 0;
+static _Thread_local unsigned int steal_seed = 1;
+
+// DEQUE
+
+static void slot_write(JobSlot *slot, const Job *job) {
+  atomic_store_explicit(&slot->fn, job->fn, memory_order_relaxed);
+  atomic_store_explicit(&slot->arg, job->arg, memory_order_relaxed);
+  atomic_store_explicit(&slot->counter, job->counter, memory_order_relaxed);
+}
+
+static Job slot_read(JobSlot *slot) {
+  return (Job){
+    atomic_load_explicit(&slot->fn, memory_order_relaxed),
+    atomic_load_explicit(&slot->arg, memory_order_relaxed),
+    atomic_load_explicit(&slot->counter, memory_order_relaxed),
+  };
+}
+
+static int queue_push(JobQueue *q, const Job *job) {
+  long b = atomic_load_explicit(&q->bottom, memory_order_relaxed);
+  long t = atomic_load_explicit(&q->top, memory_order_acquire);
+  if (b - t >= DEQUE_SIZE) return 0;
+
+  slot_write(&q->slots[b & DEQUE_MASK], job);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+  return 1;
+}
+
+static int queue_pop(JobQueue *q, Job *job) {
+  long b = atomic_load_explicit(&q->bottom, memory_order_relaxed) - 1;
+  atomic_store_explicit(&q->bottom, b, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  long t = atomic_load_explicit(&q->top, memory_order_relaxed);
+
+  if (t > b) {
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+    return 0;
+  }
+
+  *job = slot_read(&q->slots[b & DEQUE_MASK]);
+  int got = 1;
+  if (t == b) {
+    // Last job: race any thief for it.
+    got = atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+            memory_order_seq_cst, memory_order_relaxed);
+    atomic_store_explicit(&q->bottom, b + 1, memory_order_relaxed);
+  }
+  return got;
+}
+
+// The slot is copied out before the CAS: once `top` moves past it the
+// owner is free to refill it.
+static int queue_steal(JobQueue *q, Job *job) {
+  long t = atomic_load_explicit(&q->top, memory_order_acquire);
+  atomic_thread_fence(memory_order_seq_cst);
+  long b = atomic_load_explicit(&q->bottom, memory_order_acquire);
+  if (t >= b) return 0;
+
+  *job = slot_read(&q->slots[t & DEQUE_MASK]);
+  return atomic_compare_exchange_strong_explicit(&q->top, &t, t + 1,
+           memory_order_seq_cst, memory_order_relaxed);
+}
+
+// SCHEDULING
+
+static int find_job(Job *job) {
+  if (queue_pop(&jobs.queues[thread_index], job)) return 1;
+
+  int n = jobs.thread_count;
+  steal_seed = steal_seed * 1103515245u + 12345u;
+  int start = (int)(steal_seed >> 16) % n;
+  for (int i = 0; i < n; i++) {
+    int victim = (start + i) % n;
+    if (victim == thread_index) continue;
+    if (queue_steal(&jobs.queues[victim], job)) return 1;
+  }
+  return 0;
+}
+
+static void execute(Job job) {
+  atomic_fetch_sub(&jobs.queued, 1);
+  job.fn(job.arg);
+  if (job.counter) atomic_fetch_sub(&job.counter->pending, 1);
+}
+
+static void* worker_main(void *arg) {
+  thread_index = (int)(long)arg;
+  steal_seed = (unsigned int)thread_index * 2654435761u;
+
+  while (atomic_load(&jobs.running)) {
+    Job job;
+    int found = 0;
+    for (int spin = 0; spin < SPIN_ROUNDS && !found; spin++) {
+      found = find_job(&job);
+      if (!found) sched_yield();
+    }
+    if (found) {
+      execute(job);
+      continue;
+    }
+
+    // Nothing to steal: sleep until a push bumps `queued`. `sleeping` is
+    // raised before `queued` is re-checked so a concurrent push either sees
+    // the sleeper and signals, or is seen here.
+    pthread_mutex_lock(&jobs.lock);
+    atomic_fetch_add(&jobs.sleeping, 1);
+    while (atomic_load(&jobs.running) && atomic_load(&jobs.queued) == 0) {
+      pthread_cond_wait(&jobs.wake, &jobs.lock);
+    }
+    atomic_fetch_sub(&jobs.sleeping, 1);
+    pthread_mutex_unlock(&jobs.lock);
+  }
+  return NULL;
+}
+
+int job_system_init(int thread_count) {
+  if (jobs_ready) job_system_shutdown();
+
+  if (thread_count <= 0) thread_count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (thread_count < 1) thread_count = 1;
+  if (thread_count > MAX_JOB_THREADS) thread_count = MAX_JOB_THREADS;
+
+  jobs.thread_count = thread_count;
+  for (int i = 0; i < thread_count; i++) {
+    atomic_init(&jobs.queues[i].top, 0);
+    atomic_init(&jobs.queues[i].bottom, 0);
+  }
+  atomic_init(&jobs.running, 1);
+  atomic_init(&jobs.queued, 0);
+  atomic_init(&jobs.sleeping, 0);
+  pthread_mutex_init(&jobs.lock, NULL);
+  pthread_cond_init(&jobs.wake, NULL);
+
+  thread_index = 0;
+  for (int i = 1; i < thread_count; i++) {
+    if (pthread_create(&jobs.threads[i], NULL, worker_main, (void *)(long)i) != 0) {
+      printf("Failed to start job worker %d\n", i);
+      jobs.thread_count = i;
+      break;
+    }
+  }
+
+  jobs_ready = 1;
+  return jobs.thread_count;
+}
+
+void job_system_shutdown(void) {
+  if (!jobs_ready) return;
+
+  pthread_mutex_lock(&jobs.lock);
+  atomic_store(&jobs.running, 0);
+  pthread_cond_broadcast(&jobs.wake);
+  pthread_mutex_unlock(&jobs.lock);
+
+  for (int i = 1; i < jobs.thread_count; i++) {
+    pthread_join(jobs.threads[i], NULL);
+  }
+
+  pthread_mutex_destroy(&jobs.lock);
+  pthread_cond_destroy(&jobs.wake);
+  jobs.thread_count = 0;
+  jobs_ready = 0;
+}
+
+int job_thread_count(void) {
+  return jobs_ready ? jobs.thread_count : 1;
+}
+
+int job_thread_index(void) {
+  return thread_index;
+}
+
+void job_counter_init(JobCounter *counter) {
+  atomic_init(&counter->pending, 0);
+}
+
+void job_run(JobFn fn, void *arg, JobCounter *counter) {
+  if (!jobs_ready || jobs.thread_count == 1) {
+    fn(arg);
+    return;
+  }
+
+  Job job = { fn, arg, counter };
+  if (counter) atomic_fetch_add(&counter->pending, 1);
+  atomic_fetch_add(&jobs.queued, 1);
+
+  if (!queue_push(&jobs.queues[thread_index], &job)) {
+    // Deque full: run it here rather than block.
+    execute(job);
+    return;
+  }
+
+  if (atomic_load(&jobs.sleeping) > 0) {
+    pthread_mutex_lock(&jobs.lock);
+    pthread_cond_signal(&jobs.wake);
+    pthread_mutex_unlock(&jobs.lock);
+  }
+}
+
+// Waiting threads keep executing jobs (their own first, then stolen ones)
+// so nested waits inside jobs cannot deadlock the pool.
+void job_wait(JobCounter *counter) {
+  while (atomic_load(&counter->pending) > 0) {
+    Job job;
+    if (jobs_ready && find_job(&job)) {
+      execute(job);
+    } else {
+      sched_yield();
+    }
+  }
+}
+
+typedef struct {
+  ParallelForFn fn;
+  void          *ctx;
+  int           begin;
+  int           end;
+} ForRange;
+
+static void run_range(void *arg) {
+  ForRange *r = arg;
+  r->fn(r->ctx, r->begin, r->end);
+}
+
+// Splits [begin, end) into chunks of at least `grain` items (grain <= 0
+// picks roughly four chunks per thread) and blocks until all have run. The
+// caller runs the last chunk itself.
+void job_parallel_for(int begin, int end, int grain, ParallelForFn fn, void *ctx) {
+  int n = end - begin;
+  if (n <= 0) return;
+
+  int threads = job_thread_count();
+  if (grain <= 0) grain = (n + threads * 4 - 1) / (threads * 4);
+  if (grain < 1) grain = 1;
+  if ((n + grain - 1) / grain > MAX_FOR_CHUNKS) grain = (n + MAX_FOR_CHUNKS - 1) / MAX_FOR_CHUNKS;
+
+  int chunks = (n + grain - 1) / grain;
+  if (threads == 1 || chunks == 1) {
+    fn(ctx, begin, end);
+    return;
+  }
+
+  ForRange ranges[MAX_FOR_CHUNKS];
+  JobCounter counter;
+  job_counter_init(&counter);
+
+  for (int c = 0; c < chunks; c++) {
+    ranges[c].fn    = fn;
+    ranges[c].ctx   = ctx;
+    ranges[c].begin = begin + c * grain;
+    ranges[c].end   = begin + (c + 1) * grain < end ? begin + (c + 1) * grain : end;
+    if (c < chunks - 1) job_run(run_range, &ranges[c], &counter);
+  }
+
+  run_range(&ranges[chunks - 1]);
+  job_wait(&counter);
+}
@@ -0,0 +1,31 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <stdatomic.h>
+
+#define MAX_JOB_THREADS 32
+
+typedef void (*JobFn)(void *arg);
+typedef void (*ParallelForFn)(void *ctx, int begin, int end);
+
+// Counts jobs still outstanding; job_wait() returns once it reaches zero.
+typedef struct {
+  atomic_int pending;
+} JobCounter;
+
+// Work-stealing job system. The thread that calls job_system_init becomes
+// thread 0 and takes part in job_wait/job_parallel_for; workers are 1..N.
+// Each thread owns a deque it pushes and pops at the bottom, and idle threads
+// steal from the top of the others. Without init everything runs inline.
+int  job_system_init(int thread_count);
+void job_system_shutdown(void);
+int  job_thread_count(void);
+int  job_thread_index(void);
+
+void job_counter_init(JobCounter *counter);
+void job_run(JobFn fn, void *arg, JobCounter *counter);
+void job_wait(JobCounter *counter);
+
+void job_parallel_for(int begin, int end, int grain, ParallelForFn fn, void *ctx);
+
+#endif
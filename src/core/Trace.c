@@ -0,0 +1,243 @@
+#define _POSIX_C_SOURCE 200809L
+#include "Trace.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TRACE_RING_MASK (TRACE_RING_SIZE - 1)
+
+typedef struct {
+  const char  *name;
+  uint64_t    start_ns;
+  uint64_t    dur_ns;
+} TraceEvent;
+
+// Single producer: only the owning thread writes events and bumps `head`.
+// A reader copies the ring, then re-reads `head` and drops any slot the
+// owner may have overwritten while it was copying. When its thread exits
+// the ring is released, keeping its events, and the next new thread takes
+// it over, so restarting the job system does not add rings.
+typedef struct {
+  TraceEvent      events[TRACE_RING_SIZE];
+  atomic_ullong   head;
+  atomic_int      owned;
+  int             tid;
+} TraceRing;
+
+static _Atomic(TraceRing *) rings[MAX_TRACE_THREADS];
+static atomic_int ring_count = 0;
+static _Thread_local TraceRing *local_ring = NULL;
+static _Thread_local int ring_failed = 0;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+
+uint64_t trace_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// RECORDING
+
+static void release_ring(void *ring) {
+  atomic_store_explicit(&((TraceRing *)ring)->owned, 0, memory_order_release);
+}
+
+static void create_ring_key(void) {
+  pthread_key_create(&ring_key, release_ring);
+}
+
+static TraceRing* claim_ring(void) {
+  int count = atomic_load(&ring_count);
+  if (count > MAX_TRACE_THREADS) count = MAX_TRACE_THREADS;
+
+  for (int r = 0; r < count; r++) {
+    TraceRing *ring = atomic_load_explicit(&rings[r], memory_order_acquire);
+    int expected = 0;
+    if (ring && atomic_compare_exchange_strong_explicit(&ring->owned, &expected, 1,
+                                                        memory_order_acquire, memory_order_relaxed)) {
+      return ring;
+    }
+  }
+  return NULL;
+}
+
+static TraceRing* thread_ring(void) {
+  if (local_ring || ring_failed) return local_ring;
+
+  pthread_once(&ring_key_once, create_ring_key);
+  TraceRing *reused = claim_ring();
+  if (reused) {
+    pthread_setspecific(ring_key, reused);
+    local_ring = reused;
+    return reused;
+  }
+
+  int slot = atomic_fetch_add(&ring_count, 1);
+  if (slot >= MAX_TRACE_THREADS) {
+    printf("Failed to create trace ring - hit max thread count of: %d\n", MAX_TRACE_THREADS);
+    ring_failed = 1;
+    return NULL;
+  }
+
+  TraceRing *ring = malloc(sizeof(TraceRing));
+  if (!ring) {
+    printf("Failed to allocate trace ring for thread: %d\n", slot);
+    ring_failed = 1;
+    return NULL;
+  }
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->owned, 1);
+  ring->tid = slot;
+
+  atomic_store_explicit(&rings[slot], ring, memory_order_release);
+  pthread_setspecific(ring_key, ring);
+  local_ring = ring;
+  return ring;
+}
+
+TraceZone trace_zone_begin(const char *name) {
+  return (TraceZone){ name, trace_now_ns() };
+}
+
+void trace_zone_end(TraceZone *zone) {
+  uint64_t end = trace_now_ns();
+  TraceRing *ring = thread_ring();
+  if (!ring) return;
+
+  unsigned long long head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  TraceEvent *ev = &ring->events[head & TRACE_RING_MASK];
+  ev->name      = zone->name;
+  ev->start_ns  = zone->start_ns;
+  ev->dur_ns    = end - zone->start_ns;
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// EXPORT
+
+int trace_enabled(void) {
+#ifdef TRACE
+  return 1;
+#else
+  return 0;
+#endif
+}
+
+static void write_name(FILE *out, const char *name) {
+  fputc('"', out);
+  for (const char *c = name; *c; c++) {
+    if (*c == '"' || *c == '\\') fputc('\\', out);
+    fputc(*c, out);
+  }
+  fputc('"', out);
+}
+
+// Copies the live part of a ring into `events` and returns how many of
+// them were not overwritten during the copy.
+static int copy_ring(TraceRing *ring, TraceEvent *events) {
+  unsigned long long head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  unsigned long long first = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+
+  for (unsigned long long i = first; i < head; i++) {
+    events[i - first] = ring->events[i & TRACE_RING_MASK];
+  }
+
+  atomic_thread_fence(memory_order_acquire);
+  unsigned long long after = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  unsigned long long valid = after > TRACE_RING_SIZE ? after - TRACE_RING_SIZE : 0;
+  if (valid <= first) return (int)(head - first);
+  if (valid >= head) return 0;
+
+  int dropped = (int)(valid - first);
+  memmove(events, events + dropped, (size_t)(head - valid) * sizeof(TraceEvent));
+  return (int)(head - valid);
+}
+
+// Safe to call while other threads keep recording, though dumping between
+// frames gives the cleanest picture. Timestamps are in microseconds from
+// the earliest zone in the dump.
+int trace_dump(const char *path) {
+  if (!trace_enabled()) {
+    printf("Failed to dump trace - tracing is compiled out, rebuild with TRACE=1\n");
+    return 1;
+  }
+
+  int count = atomic_load(&ring_count);
+  if (count > MAX_TRACE_THREADS) count = MAX_TRACE_THREADS;
+
+  TraceEvent *events[MAX_TRACE_THREADS] = {0};
+  int event_count[MAX_TRACE_THREADS] = {0};
+  int tids[MAX_TRACE_THREADS] = {0};
+  uint64_t base = UINT64_MAX;
+
+  int ok = 1;
+  for (int r = 0; r < count; r++) {
+    TraceRing *ring = atomic_load_explicit(&rings[r], memory_order_acquire);
+    if (!ring) continue;
+
+    events[r] = malloc(TRACE_RING_SIZE * sizeof(TraceEvent));
+    if (!events[r]) {
+      printf("Failed to allocate trace dump buffer for thread: %d\n", ring->tid);
+      ok = 0;
+      break;
+    }
+    event_count[r] = copy_ring(ring, events[r]);
+    tids[r] = ring->tid;
+    for (int i = 0; i < event_count[r]; i++) {
+      if (events[r][i].start_ns < base) base = events[r][i].start_ns;
+    }
+  }
+
+  FILE *out = ok ? fopen(path, "w") : NULL;
+  if (ok && !out) {
+    printf("Failed to open trace file: %s\n", path);
+    ok = 0;
+  }
+
+  if (ok) {
+    int total = 0;
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    int first = 1;
+    for (int r = 0; r < count; r++) {
+      if (!events[r]) continue;
+      fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,"
+                   "\"args\":{\"name\":\"thread %d\"}}",
+              first ? "" : ",\n", tids[r], tids[r]);
+      first = 0;
+
+      for (int i = 0; i < event_count[r]; i++) {
+        TraceEvent *ev = &events[r][i];
+        fprintf(out, ",\n{\"name\":");
+        write_name(out, ev->name);
+        fprintf(out, ",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                tids[r], (ev->start_ns - base) / 1000.0, ev->dur_ns / 1000.0);
+      }
+      total += event_count[r];
+    }
+    fprintf(out, "\n]}\n");
+    fclose(out);
+    printf("Wrote %d trace zones to %s\n", total, path);
+  }
+
+  for (int r = 0; r < count; r++) free(events[r]);
+  return ok ? 0 : 1;
+}
+
+// Frees every ring. Only call once no other thread records anymore,
+// i.e. after job_system_shutdown().
+void trace_shutdown(void) {
+  int count = atomic_load(&ring_count);
+  if (count > MAX_TRACE_THREADS) count = MAX_TRACE_THREADS;
+
+  for (int r = 0; r < count; r++) {
+    free(atomic_load(&rings[r]));
+    atomic_store(&rings[r], NULL);
+  }
+  atomic_store(&ring_count, 0);
+  if (local_ring) pthread_setspecific(ring_key, NULL);
+  local_ring = NULL;
+  ring_failed = 0;
+}
@@ -0,0 +1,54 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#define TRACE_RING_SIZE     65536
+#define MAX_TRACE_THREADS   64
+#define TRACE_DUMP_PATH     "trace.json"
+
+// Scoped trace zones. Build with -DTRACE (make TRACE=1) to record them;
+// otherwise TRACE_ZONE expands to nothing and costs nothing.
+//
+//   void update(...) {
+//     TRACE_ZONE("update");      // closed when the enclosing scope exits
+//     ...
+//   }
+//
+// Each thread writes complete zones into its own ring, so recording never
+// takes a lock; once a ring is full the oldest zones are overwritten.
+// trace_dump() writes every ring as Chrome trace JSON, which loads in
+// chrome://tracing and ui.perfetto.dev. Names must outlive the dump:
+// string literals, __func__ or system names.
+typedef struct {
+  const char  *name;
+  uint64_t    start_ns;
+} TraceZone;
+
+#ifdef TRACE
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b)  TRACE_CONCAT_(a, b)
+
+#define TRACE_ZONE(name) \
+  TraceZone TRACE_CONCAT(trace_zone_, __LINE__) \
+    __attribute__((cleanup(trace_zone_end))) = trace_zone_begin(name)
+
+#define TRACE_FN() TRACE_ZONE(__func__)
+
+#else
+
+#define TRACE_ZONE(name)
+#define TRACE_FN()
+
+#endif
+
+uint64_t  trace_now_ns(void);
+TraceZone trace_zone_begin(const char *name);
+void      trace_zone_end(TraceZone *zone);
+
+int  trace_enabled(void);
+int  trace_dump(const char *path);
+void trace_shutdown(void);
+
+#endif
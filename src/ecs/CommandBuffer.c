@@ -0,0 +1,67 @@
+#include "CommandBuffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+void command_buffer_init(CommandBuffer *buf) {
+  buf->commands         = NULL;
+  buf->count            = 0;
+  buf->capacity         = 0;
+  buf->payload          = NULL;
+  buf->payload_size     = 0;
+  buf->payload_capacity = 0;
+}
+
+static Command* push_command(CommandBuffer *buf) {
+  if (buf->count == buf->capacity) {
+    buf->capacity = buf->capacity ? buf->capacity * 2 : 32;
+    buf->commands = realloc(buf->commands, buf->capacity * sizeof(Command));
+  }
+  return &buf->commands[buf->count++];
+}
+
+void command_add(CommandBuffer *buf, Entity e, int component, const void *data, size_t size) {
+  // Keep payloads 8-byte aligned so playback can read them in place.
+  size_t aligned = (size + 7) & ~(size_t)7;
+  if (buf->payload_size + aligned > buf->payload_capacity) {
+    size_t capacity = buf->payload_capacity ? buf->payload_capacity : 256;
+    while (capacity < buf->payload_size + aligned) capacity *= 2;
+    buf->payload = realloc(buf->payload, capacity);
+    buf->payload_capacity = capacity;
+  }
+
+  Command *c = push_command(buf);
+  c->type       = COMMAND_ADD;
+  c->component  = component;
+  c->entity     = e;
+  c->offset     = buf->payload_size;
+
+  memcpy(buf->payload + buf->payload_size, data, size);
+  buf->payload_size += aligned;
+}
+
+void command_remove(CommandBuffer *buf, Entity e, int component) {
+  Command *c = push_command(buf);
+  c->type       = COMMAND_REMOVE;
+  c->component  = component;
+  c->entity     = e;
+  c->offset     = 0;
+}
+
+void command_destroy(CommandBuffer *buf, Entity e) {
+  Command *c = push_command(buf);
+  c->type       = COMMAND_DESTROY;
+  c->component  = -1;
+  c->entity     = e;
+  c->offset     = 0;
+}
+
+void command_buffer_clear(CommandBuffer *buf) {
+  buf->count        = 0;
+  buf->payload_size = 0;
+}
+
+void command_buffer_destroy(CommandBuffer *buf) {
+  free(buf->commands);
+  free(buf->payload);
+  command_buffer_init(buf);
+}
@@ -0,0 +1,41 @@
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include <stddef.h>
+#include "ecs/Entity.h"
+
+#define MAX_COMMAND_BUFFERS 64
+
+typedef enum {
+  COMMAND_ADD,
+  COMMAND_REMOVE,
+  COMMAND_DESTROY
+} CommandType;
+
+typedef struct {
+  CommandType type;
+  int         component;
+  Entity      entity;
+  size_t      offset;
+} Command;
+
+// Records structural changes (component add/remove, entity destroy) so they
+// can be applied at a sync point instead of while a store is being iterated.
+// Component payloads are copied into `payload` at record time.
+typedef struct {
+  Command       *commands;
+  int           count;
+  int           capacity;
+  unsigned char *payload;
+  size_t        payload_size;
+  size_t        payload_capacity;
+} CommandBuffer;
+
+void command_buffer_init(CommandBuffer *buf);
+void command_add(CommandBuffer *buf, Entity e, int component, const void *data, size_t size);
+void command_remove(CommandBuffer *buf, Entity e, int component);
+void command_destroy(CommandBuffer *buf, Entity e);
+void command_buffer_clear(CommandBuffer *buf);
+void command_buffer_destroy(CommandBuffer *buf);
+
+#endif
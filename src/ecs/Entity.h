@@ -0,0 +1,27 @@
+#ifndef ENTITY_H
+#define ENTITY_H
+
+// An entity handle packs a slot index (low bits) and the generation of that
+// slot (high bits). Destroying an entity bumps its slot's generation, so old
+// handles stop resolving once the slot is recycled.
+typedef int Entity;
+
+#define ENTITY_NONE         (-1)
+#define ENTITY_INDEX_BITS   20
+#define ENTITY_INDEX_MASK   ((1 << ENTITY_INDEX_BITS) - 1)
+#define ENTITY_MAX_INDEX    ENTITY_INDEX_MASK
+#define ENTITY_GEN_MASK     0x7FF
+
+static inline int entity_index(Entity e) {
+  return e & ENTITY_INDEX_MASK;
+}
+
+static inline int entity_generation(Entity e) {
+  return (e >> ENTITY_INDEX_BITS) & ENTITY_GEN_MASK;
+}
+
+static inline Entity entity_make(int index, int generation) {
+  return ((generation & ENTITY_GEN_MASK) << ENTITY_INDEX_BITS) | index;
+}
+
+#endif
@@ -0,0 +1,277 @@
+#include "PhysicsQuery.h"
+#include "core/Trace.h"
+#include "physics/Narrowphase.h"
+#include "physics/RayPacket.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define COLLIDER_QUERY (COMPONENT_BIT(COMPONENT_COLLIDER) | COMPONENT_BIT(COMPONENT_POSITION))
+
+static Aabb collider_box(const ColliderComponent *c, const PositionComponent *p) {
+  return (Aabb){ vec3f_sub(p->position, c->half_extents), vec3f_add(p->position, c->half_extents) };
+}
+
+static const MeshBvh* collider_mesh(World *world, const ColliderComponent *c) {
+  return c->mesh >= 0 ? &world->collider_meshes.items[c->mesh] : NULL;
+}
+
+static int compare_entities(const void *x, const void *y) {
+  Entity a = *(const Entity *)x, b = *(const Entity *)y;
+  return (a > b) - (a < b);
+}
+
+static int is_baked(const StaticColliders *sc, Entity e) {
+  return sc->count && bsearch(&e, sc->entities, sc->count, sizeof(Entity), compare_entities);
+}
+
+// Brings the query tree in line with the colliders. A new collider query
+// layout or a new bake rebuilds it; otherwise each leaf is only moved,
+// which is free while a body stays inside its fat bounds.
+void physics_refresh(World *world) {
+  QueryColliders  *qc = &world->query_colliders;
+  StaticColliders *sc = &world->static_colliders;
+  Query *q = world_query(world, COLLIDER_QUERY);
+  if (!q) return;
+
+  int rebuild = q->version != qc->layout_version || sc->build_count != qc->bake_count;
+  if (!rebuild && !qc->stale) return;
+  TRACE_FN();
+
+  if (rebuild) {
+    tree_clear(&qc->tree);
+    if (q->count > qc->capacity) {
+      qc->capacity = q->count;
+      qc->proxies  = realloc(qc->proxies, qc->capacity * sizeof(int));
+    }
+  }
+
+  QueryIter it = query_iter(world, COLLIDER_QUERY);
+  for (int i = 0; query_next(&it); i++) {
+    Aabb box = collider_box(it.components[COMPONENT_COLLIDER], it.components[COMPONENT_POSITION]);
+    if (rebuild) {
+      qc->proxies[i] = is_baked(sc, it.entity) ? TREE_NULL : tree_insert(&qc->tree, &box, it.entity);
+    } else if (qc->proxies[i] != TREE_NULL) {
+      tree_move(&qc->tree, qc->proxies[i], &box);
+    }
+  }
+
+  qc->layout_version = q->version;
+  qc->bake_count     = sc->build_count;
+  qc->stale          = 0;
+}
+
+// RAYS
+
+// Slab test against a box. Returns the entry distance (0 when the origin
+// is inside) or -1 if the ray misses it within max_t, and the face entered
+// in *normal if asked for.
+static float ray_box(const Aabb *box, Vec3f origin, Vec3f dir, float max_t, Vec3f *normal) {
+  float o[3]  = { origin.x, origin.y, origin.z };
+  float d[3]  = { dir.x, dir.y, dir.z };
+  float lo[3] = { box->min.x, box->min.y, box->min.z };
+  float hi[3] = { box->max.x, box->max.y, box->max.z };
+  float t0 = 0.0f, t1 = max_t;
+  int axis = -1;
+  float side = 0.0f;
+
+  for (int i = 0; i < 3; i++) {
+    if (d[i] == 0.0f) {
+      if (o[i] < lo[i] || o[i] > hi[i]) return -1.0f;
+      continue;
+    }
+    float inv = 1.0f / d[i];
+    float near = (lo[i] - o[i]) * inv;
+    float far  = (hi[i] - o[i]) * inv;
+    float face = -1.0f;
+    if (near > far) {
+      float t = near;
+      near = far;
+      far = t;
+      face = 1.0f;
+    }
+    if (near > t0) {
+      t0 = near;
+      axis = i;
+      side = face;
+    }
+    if (far < t1) t1 = far;
+    if (t0 > t1) return -1.0f;
+  }
+
+  if (normal) {
+    *normal = (Vec3f){ axis == 0 ? side : 0.0f, axis == 1 ? side : 0.0f, axis == 2 ? side : 0.0f };
+  }
+  return t0;
+}
+
+typedef struct {
+  World             *world;
+  const PhysicsRay  *rays;
+} RayBatch;
+
+static float ray_collider(void *ctx, int id, int lane, Vec3f origin, Vec3f dir, float max_t) {
+  RayBatch *b = ctx;
+  if (id == b->rays[lane].ignore) return -1.0f;
+  ColliderComponent *c = world_get_collider(b->world, id);
+  PositionComponent *p = world_get_position(b->world, id);
+  if (!c || !p) return -1.0f;
+  const MeshBvh *mesh = collider_mesh(b->world, c);
+  if (mesh) {
+    Vec3f normal;
+    return mesh_bvh_raycast(mesh, vec3f_sub(origin, p->position), dir, max_t, &normal);
+  }
+  Aabb box = collider_box(c, p);
+  return ray_box(&box, origin, dir, max_t, NULL);
+}
+
+static void fill_ray_hit(World *world, const PhysicsRay *ray, Entity e, float t, PhysicsHit *hit) {
+  hit->entity = e;
+  hit->t      = t;
+  hit->point  = vec3f_add(ray->origin, vec3f_scale(ray->dir, t));
+  hit->normal = (Vec3f){ 0.0f, 0.0f, 0.0f };
+  if (e == ENTITY_NONE) return;
+  ColliderComponent *c = world_get_collider(world, e);
+  PositionComponent *p = world_get_position(world, e);
+  const MeshBvh *mesh = collider_mesh(world, c);
+  if (mesh) {
+    mesh_bvh_raycast(mesh, vec3f_sub(ray->origin, p->position), ray->dir, ray->max_t, &hit->normal);
+    return;
+  }
+  Aabb box = collider_box(c, p);
+  ray_box(&box, ray->origin, ray->dir, ray->max_t, &hit->normal);
+}
+
+// Each packet goes through the static BVH first and then the query tree,
+// so tree nodes beyond a static hit are already culled.
+int physics_raycast_batch(World *world, const PhysicsRay *rays, PhysicsHit *hits, int count) {
+  TRACE_FN();
+  physics_refresh(world);
+
+  int hit_count = 0;
+  for (int begin = 0; begin < count; begin += RAY_PACKET_SIZE) {
+    RayPacket packet;
+    RayBatch  batch = { world, rays + begin };
+    packet.count = count - begin < RAY_PACKET_SIZE ? count - begin : RAY_PACKET_SIZE;
+    // Spare lanes repeat the first ray so the slab math stays finite;
+    // they are masked out of every result.
+    for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+      const PhysicsRay *r = &batch.rays[i < packet.count ? i : 0];
+      ray_packet_set(&packet, i, r->origin, r->dir, r->max_t);
+    }
+
+    static_bvh_raycast_packet(&world->static_colliders.bvh, &packet, ray_collider, &batch);
+    tree_raycast_packet(&world->query_colliders.tree, &packet, ray_collider, &batch);
+
+    for (int i = 0; i < packet.count; i++) {
+      Entity e = packet.hit[i] < 0 ? ENTITY_NONE : packet.hit[i];
+      fill_ray_hit(world, &batch.rays[i], e, e == ENTITY_NONE ? batch.rays[i].max_t : packet.max_t[i],
+                   &hits[begin + i]);
+      hit_count += e != ENTITY_NONE;
+    }
+  }
+  return hit_count;
+}
+
+int physics_raycast(World *world, Vec3f origin, Vec3f dir, float max_t, Entity ignore, PhysicsHit *hit) {
+  PhysicsRay ray = { origin, dir, max_t, ignore };
+  return physics_raycast_batch(world, &ray, hit, 1);
+}
+
+// BOXES
+
+typedef struct {
+  World   *world;
+  Vec3f   center;
+  Vec3f   half_extents;
+  Vec3f   delta;
+  Entity  ignore;
+  Entity  *out;
+  int     capacity;
+  int     count;
+  float   toi;
+  Vec3f   normal;
+  Entity  hit;
+} BoxQuery;
+
+static int overlap_collider(void *ctx, int id) {
+  BoxQuery *b = ctx;
+  if (id == b->ignore) return 1;
+  ColliderComponent *c = world_get_collider(b->world, id);
+  PositionComponent *p = world_get_position(b->world, id);
+  if (!c || !p) return 1;
+  const MeshBvh *mesh = collider_mesh(b->world, c);
+  int axis;
+  float push;
+  int overlaps = mesh ? mesh_bvh_overlaps(mesh, vec3f_sub(b->center, p->position), b->half_extents)
+                      : narrowphase_pair(b->center, b->half_extents, p->position, c->half_extents, &axis, &push);
+  if (!overlaps) return 1;
+  if (b->count < b->capacity) b->out[b->count] = id;
+  b->count++;
+  return 1;
+}
+
+int physics_overlap_box(World *world, Vec3f center, Vec3f half_extents, Entity ignore,
+                        Entity *out, int capacity) {
+  TRACE_FN();
+  physics_refresh(world);
+
+  BoxQuery b = { .world = world, .center = center, .half_extents = half_extents,
+                 .ignore = ignore, .out = out, .capacity = capacity };
+  Aabb box = { vec3f_sub(center, half_extents), vec3f_add(center, half_extents) };
+  static_bvh_query(&world->static_colliders.bvh, &box, overlap_collider, &b);
+  tree_query(&world->query_colliders.tree, &box, overlap_collider, &b);
+  return b.count;
+}
+
+static int sweep_collider(void *ctx, int id) {
+  BoxQuery *b = ctx;
+  if (id == b->ignore) return 1;
+  ColliderComponent *c = world_get_collider(b->world, id);
+  PositionComponent *p = world_get_position(b->world, id);
+  if (!c || !p) return 1;
+  const MeshBvh *mesh = collider_mesh(b->world, c);
+  float toi;
+  Vec3f normal;
+  int hit;
+  if (mesh) {
+    hit = mesh_bvh_sweep(mesh, vec3f_sub(b->center, p->position), b->half_extents, b->delta, &toi, &normal);
+  } else {
+    int axis;
+    hit = narrowphase_sweep(b->center, b->half_extents, b->delta, p->position, c->half_extents, &toi, &axis);
+    if (hit) {
+      float d = axis == 0 ? b->delta.x : axis == 1 ? b->delta.y : b->delta.z;
+      float side = d > 0.0f ? -1.0f : 1.0f;
+      normal = (Vec3f){ axis == 0 ? side : 0.0f, axis == 1 ? side : 0.0f, axis == 2 ? side : 0.0f };
+    }
+  }
+  if (hit && toi < b->toi) {
+    b->toi    = toi;
+    b->normal = normal;
+    b->hit    = id;
+  }
+  return 1;
+}
+
+int physics_sweep_box(World *world, Vec3f center, Vec3f half_extents, Vec3f delta, Entity ignore,
+                      PhysicsHit *hit) {
+  TRACE_FN();
+  physics_refresh(world);
+
+  BoxQuery b = { .world = world, .center = center, .half_extents = half_extents, .delta = delta,
+                 .ignore = ignore, .toi = INFINITY, .hit = ENTITY_NONE };
+  Vec3f to = vec3f_add(center, delta);
+  Aabb swept = {
+    { fminf(center.x, to.x), fminf(center.y, to.y), fminf(center.z, to.z) },
+    { fmaxf(center.x, to.x), fmaxf(center.y, to.y), fmaxf(center.z, to.z) }
+  };
+  swept.min = vec3f_sub(swept.min, half_extents);
+  swept.max = vec3f_add(swept.max, half_extents);
+  static_bvh_query(&world->static_colliders.bvh, &swept, sweep_collider, &b);
+  tree_query(&world->query_colliders.tree, &swept, sweep_collider, &b);
+
+  hit->entity = b.hit;
+  hit->t      = b.hit == ENTITY_NONE ? 1.0f : b.toi;
+  hit->point  = vec3f_add(center, vec3f_scale(delta, hit->t));
+  hit->normal = b.hit == ENTITY_NONE ? (Vec3f){ 0.0f, 0.0f, 0.0f } : b.normal;
+  return b.hit != ENTITY_NONE;
+}
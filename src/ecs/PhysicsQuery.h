@@ -0,0 +1,50 @@
+#ifndef PHYSICS_QUERY_H
+#define PHYSICS_QUERY_H
+
+#include "ecs/World.h"
+#include "maths/Maths3D.h"
+
+// Ray and box queries against every collider in the world, for gameplay
+// probes (ground checks, line of sight) that cannot wait for collision
+// resolution. Baked statics are searched through their BVH and everything
+// else through the world's query tree, which the first query after each
+// tick brings up to date. Colliders are the boxes their ColliderComponents
+// describe, or their triangles for mesh colliders, not the padded bounds
+// the broadphase uses.
+//
+// Queries run on the calling thread and must not overlap update_systems.
+// A body moved by writing its position directly is seen after the next
+// tick, or right away after physics_refresh().
+
+typedef struct {
+  Vec3f   origin;
+  Vec3f   dir;        // need not be unit length; t is measured in it
+  float   max_t;
+  Entity  ignore;     // usually the body casting the ray, or ENTITY_NONE
+} PhysicsRay;
+
+typedef struct {
+  Entity  entity;     // ENTITY_NONE on a miss
+  float   t;          // along the ray, or the fraction of a sweep
+  Vec3f   point;      // where the ray meets the collider, or the swept box at impact
+  Vec3f   normal;     // face hit; zero when a ray starts inside the collider
+} PhysicsHit;
+
+// Closest collider along origin + t * dir for t in [0, max_t]. Returns
+// whether anything was hit.
+int  physics_raycast(World *world, Vec3f origin, Vec3f dir, float max_t, Entity ignore, PhysicsHit *hit);
+// Closest hit of every ray, traced RAY_PACKET_SIZE at a time in the order
+// given, so neighbouring rays should be coherent. Returns how many hit.
+int  physics_raycast_batch(World *world, const PhysicsRay *rays, PhysicsHit *hits, int count);
+// Colliders overlapping the box (touching does not count, as in collision
+// resolution). Writes up to `capacity` of them and returns how many there
+// are in total.
+int  physics_overlap_box(World *world, Vec3f center, Vec3f half_extents, Entity ignore,
+                         Entity *out, int capacity);
+// First collider the box touches when moved by `delta`. Colliders it
+// already overlaps are skipped. Returns whether anything was hit.
+int  physics_sweep_box(World *world, Vec3f center, Vec3f half_extents, Vec3f delta, Entity ignore,
+                       PhysicsHit *hit);
+void physics_refresh(World *world);
+
+#endif
@@ -0,0 +1,88 @@
+#include "World.h"
+#include "core/Trace.h"
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static atomic_uint next_version = 1;
+
+static void query_push(Query *q, Entity e) {
+  if (q->count == q->capacity) {
+    q->capacity = q->capacity ? q->capacity * 2 : 16;
+    q->entities = realloc(q->entities, q->capacity * sizeof(Entity));
+    q->rows     = realloc(q->rows, q->capacity * q->width * sizeof(int));
+  }
+  q->entities[q->count++] = e;
+}
+
+static void query_rebuild(World *world, Query *q) {
+  TRACE_FN();
+  q->count = 0;
+
+  // Drive from the smallest store in the signature; everything else is a
+  // signature test plus one sparse lookup per required component.
+  SparseSet *driver = NULL;
+  for (int t = 0; t < COMPONENT_COUNT; t++) {
+    if (!(q->mask & COMPONENT_BIT(t))) continue;
+    SparseSet *set = &world->components[t];
+    if (!driver || set->count < driver->count) driver = set;
+  }
+
+  if (driver) {
+    for (int i = 0; i < driver->count; i++) {
+      Entity e = driver->entities[i];
+      if ((world->signatures[entity_index(e)] & q->mask) != q->mask) continue;
+
+      query_push(q, e);
+      int *row = &q->rows[(q->count - 1) * q->width];
+      for (int col = 0; col < q->width; col++) {
+        row[col] = sparse_set_index(&world->components[q->types[col]], e);
+      }
+    }
+  }
+
+  q->dirty = 0;
+  q->version = atomic_fetch_add(&next_version, 1);
+}
+
+Query* world_query(World *world, ComponentMask mask) {
+  Query *q = NULL;
+  for (int i = 0; i < world->query_count; i++) {
+    if (world->queries[i].mask == mask) {
+      q = &world->queries[i];
+      break;
+    }
+  }
+
+  if (!q) {
+    if (world->query_count == MAX_QUERIES) {
+      printf("Failed to cache query - hit max query count of: %d\n", world->query_count);
+      return NULL;
+    }
+    q = &world->queries[world->query_count++];
+    *q = (Query){ .mask = mask, .dirty = 1 };
+    for (int t = 0; t < COMPONENT_COUNT; t++) {
+      if (mask & COMPONENT_BIT(t)) q->types[q->width++] = t;
+    }
+  }
+
+  if (q->dirty) query_rebuild(world, q);
+  return q;
+}
+
+QueryIter query_iter_range(World *world, ComponentMask mask, int begin, int end) {
+  Query *q = world_query(world, mask);
+  int count = q ? q->count : 0;
+
+  return (QueryIter){
+    .world  = world,
+    .query  = q,
+    .index  = begin - 1,
+    .end    = end < count ? end : count,
+  };
+}
+
+QueryIter query_iter(World *world, ComponentMask mask) {
+  return query_iter_range(world, mask, 0, INT_MAX);
+}
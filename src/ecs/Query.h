@@ -0,0 +1,30 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "ecs/Entity.h"
+
+#define MAX_QUERIES 16
+
+typedef unsigned int ComponentMask;
+
+#define COMPONENT_BIT(type) (1u << (type))
+
+// Cached match list for one component signature. `rows` holds, for every
+// matched entity, the dense index into each required store (in bit order),
+// so iterating never touches the sparse arrays. Rebuilt lazily when a
+// component type in `mask` is added to or removed from any entity.
+// `version` is unique per rebuild across all worlds, so a cache keyed on it
+// knows the match order it indexed is still current.
+typedef struct {
+  ComponentMask mask;
+  int           width;
+  unsigned char types[32];
+  int           dirty;
+  unsigned int  version;
+  Entity        *entities;
+  int           *rows;
+  int           count;
+  int           capacity;
+} Query;
+
+#endif
@@ -0,0 +1,138 @@
+#define _POSIX_C_SOURCE 200809L
+#include "Scheduler.h"
+#include "core/JobSystem.h"
+#include "core/Trace.h"
+#include <stdio.h>
+#include <time.h>
+
+typedef struct {
+  int           system;
+  SystemContext ctx;
+  double        ms;
+} Task;
+
+typedef struct {
+  Scheduler *s;
+  World     *world;
+  Task      *tasks;
+} Wave;
+
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static void run_tasks(void *ctx, int begin, int end) {
+  Wave *w = ctx;
+  for (int i = begin; i < end; i++) {
+    Task *t = &w->tasks[i];
+    TRACE_ZONE(w->s->systems[t->system].name);
+
+    double start = now_ms();
+    w->s->systems[t->system].run(w->world, &t->ctx);
+    t->ms = now_ms() - start;
+  }
+}
+
+static void dispatch(Scheduler *s, Wave *wave, int count) {
+  TRACE_ZONE("wave");
+  if (s->deterministic) {
+    run_tasks(wave, 0, count);
+    return;
+  }
+  job_parallel_for(0, count, 1, run_tasks, wave);
+}
+
+void scheduler_init(Scheduler *s, int deterministic) {
+  s->count          = 0;
+  s->wave_count     = 0;
+  s->deterministic  = deterministic;
+}
+
+static int conflicts(SystemDesc *a, SystemDesc *b) {
+  return (a->writes & (b->reads | b->writes)) || (b->writes & a->reads);
+}
+
+// Systems are kept in registration order; a system lands in the wave after
+// the latest earlier system it conflicts with, so every wave is a set of
+// systems that can run side by side and the DAG is respected wave to wave.
+void scheduler_add(Scheduler *s, SystemDesc desc) {
+  if (s->count == MAX_SYSTEMS) {
+    printf("Failed to add system %s - hit max system count of: %d\n", desc.name, s->count);
+    return;
+  }
+
+  int wave = 0;
+  for (int i = 0; i < s->count; i++) {
+    if (conflicts(&s->systems[i], &desc) && s->wave[i] + 1 > wave) wave = s->wave[i] + 1;
+  }
+
+  s->systems[s->count]    = desc;
+  s->wave[s->count]       = wave;
+  s->timings_ms[s->count] = 0.0;
+  s->count++;
+  if (wave + 1 > s->wave_count) s->wave_count = wave + 1;
+}
+
+// Chunking depends only on entity counts, never on the thread count, and
+// each task owns one command buffer, so the recorded structural changes
+// merge in the same order however the tasks were spread over threads.
+void scheduler_run(Scheduler *s, World *world, float dt) {
+  TRACE_FN();
+  Task tasks[MAX_COMMAND_BUFFERS];
+
+  for (int i = 0; i < s->count; i++) s->timings_ms[i] = 0.0;
+
+  for (int w = 0; w < s->wave_count; w++) {
+    int serial = 0, chunked = 0;
+    for (int i = 0; i < s->count; i++) {
+      if (s->wave[i] != w) continue;
+      if (s->systems[i].iterate) chunked++;
+      else serial++;
+    }
+    int budget = chunked ? (MAX_COMMAND_BUFFERS - serial) / chunked : 0;
+
+    int task_count = 0;
+    for (int i = 0; i < s->count; i++) {
+      if (s->wave[i] != w) continue;
+      SystemDesc *sys = &s->systems[i];
+
+      int count = 1, chunks = 1;
+      if (sys->iterate) {
+        // Refreshing the query here keeps rebuilds off the worker threads.
+        Query *q = world_query(world, sys->iterate);
+        count = q ? q->count : 0;
+        chunks = (count + MIN_CHUNK_SIZE - 1) / MIN_CHUNK_SIZE;
+        if (chunks > budget) chunks = budget;
+        if (chunks < 1) chunks = 1;
+      }
+
+      int size = (count + chunks - 1) / chunks;
+      for (int c = 0; c < chunks; c++) {
+        Task *t = &tasks[task_count];
+        t->system         = i;
+        t->ms             = 0.0;
+        t->ctx.begin      = c * size;
+        t->ctx.end        = (c + 1) * size < count ? (c + 1) * size : count;
+        t->ctx.dt         = dt;
+        t->ctx.commands   = world_commands(world, task_count);
+        task_count++;
+      }
+    }
+
+    Wave wave = { s, world, tasks };
+    dispatch(s, &wave, task_count);
+
+    for (int t = 0; t < task_count; t++) {
+      s->timings_ms[tasks[t].system] += tasks[t].ms;
+    }
+  }
+
+  world_flush_commands(world);
+}
+
+void scheduler_destroy(Scheduler *s) {
+  s->count = 0;
+  s->wave_count = 0;
+}
@@ -0,0 +1,47 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "ecs/World.h"
+
+#define MAX_SYSTEMS     32
+#define MIN_CHUNK_SIZE  256
+
+// Non-component state a system touches, tracked in the same masks.
+#define ACCESS_CAMERA   (1u << 31)
+#define ACCESS_BODIES   (1u << 30)    // the physics step's rigid-body store
+
+typedef struct {
+  int           begin;
+  int           end;
+  float         dt;
+  CommandBuffer *commands;
+} SystemContext;
+
+typedef void (*SystemFn)(World *world, SystemContext *ctx);
+
+// A system declares what it reads and writes. If `iterate` is set the
+// system is split into chunks over that query's matches, and run() is
+// called once per chunk with [begin, end).
+typedef struct {
+  const char    *name;
+  SystemFn      run;
+  ComponentMask reads;
+  ComponentMask writes;
+  ComponentMask iterate;
+} SystemDesc;
+
+typedef struct {
+  SystemDesc      systems[MAX_SYSTEMS];
+  int             wave[MAX_SYSTEMS];
+  double          timings_ms[MAX_SYSTEMS];
+  int             count;
+  int             wave_count;
+  int             deterministic;
+} Scheduler;
+
+void scheduler_init(Scheduler *s, int deterministic);
+void scheduler_add(Scheduler *s, SystemDesc desc);
+void scheduler_run(Scheduler *s, World *world, float dt);
+void scheduler_destroy(Scheduler *s);
+
+#endif
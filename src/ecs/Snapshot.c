@@ -0,0 +1,520 @@
+#include "Snapshot.h"
+#include "core/Trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SNAPSHOT_DELTA      1u
+#define SECTION_UNCHANGED   1u
+
+enum {
+  SECTION_STATE,
+  SECTION_GENERATIONS,
+  SECTION_ALIVE,
+  SECTION_SIGNATURES,
+  SECTION_FREE_SLOTS,
+  SECTION_COLLIDER_MESHES,
+  SECTION_COMPONENTS,
+  SECTION_COUNT = SECTION_COMPONENTS + 2 * COMPONENT_COUNT
+};
+
+#define SECTION_ENTITIES(t) (SECTION_COMPONENTS + 2 * (t))
+#define SECTION_DATA(t)     (SECTION_COMPONENTS + 2 * (t) + 1)
+
+typedef struct {
+  uint32_t  magic;
+  uint16_t  version;
+  uint16_t  flags;
+  uint32_t  section_count;
+  uint32_t  reserved;
+  uint64_t  id;
+  uint64_t  base_id;
+  uint64_t  size;
+} SnapshotHeader;
+
+typedef struct {
+  uint32_t  id;
+  uint32_t  flags;
+  uint64_t  size;
+} SectionHeader;
+
+// Everything that is not a plain array. Component strides are recorded so
+// a snapshot from a build with different component layouts is rejected.
+typedef struct {
+  int32_t         slot_count;
+  int32_t         free_count;
+  int32_t         hierarchy_unsorted;
+  int32_t         mesh_count;
+  int32_t         material_count;
+  int32_t         collider_mesh_count;
+  int32_t         component_count;
+  uint32_t        strides[COMPONENT_COUNT];
+  int32_t         counts[COMPONENT_COUNT];
+  PlayerComponent player;
+  Camera          camera;
+} SnapshotState;
+
+typedef struct {
+  const void  *data;
+  size_t      size;
+} SectionView;
+
+static uint64_t next_snapshot_id = 1;
+
+static size_t align8(size_t n) {
+  return (n + 7) & ~(size_t)7;
+}
+
+static void reserve_bytes(Snapshot *snap, size_t size) {
+  if (size <= snap->capacity) return;
+  size_t capacity = snap->capacity ? snap->capacity : 4096;
+  while (capacity < size) capacity *= 2;
+  snap->data = realloc(snap->data, capacity);
+  snap->capacity = capacity;
+}
+
+static int alive_words(int slots) {
+  return (slots + 63) / 64;
+}
+
+// Cached transforms are derived data: only their entities are stored and
+// restore marks them dirty, which halves the size of a mesh-heavy world.
+static size_t stored_stride(int type, SparseSet *set) {
+  return type == COMPONENT_TRANSFORM ? 0 : set->stride;
+}
+
+static void describe_world(World *world, SnapshotState *state, SectionView *views) {
+  memset(state, 0, sizeof(*state));
+  state->slot_count         = world->slot_count;
+  state->free_count         = world->free_count;
+  state->hierarchy_unsorted = world->hierarchy_unsorted;
+  state->mesh_count         = world->mesh_registry.count;
+  state->material_count     = world->material_registry.count;
+  state->collider_mesh_count = world->collider_meshes.count;
+  state->component_count    = COMPONENT_COUNT;
+  state->player             = world->player;
+  state->camera             = world->camera;
+
+  views[SECTION_STATE]        = (SectionView){ state, sizeof(*state) };
+  views[SECTION_GENERATIONS]  = (SectionView){ world->generations, world->slot_count * sizeof(int) };
+  views[SECTION_ALIVE]        = (SectionView){ world->alive, alive_words(world->slot_count) * sizeof(uint64_t) };
+  views[SECTION_SIGNATURES]   = (SectionView){ world->signatures, world->slot_count * sizeof(ComponentMask) };
+  views[SECTION_FREE_SLOTS]   = (SectionView){ world->free_slots, world->free_count * sizeof(int) };
+  views[SECTION_COLLIDER_MESHES] = (SectionView){ world->collider_meshes.ids,
+                                                  world->collider_meshes.count * sizeof(uint32_t) };
+
+  for (int t = 0; t < COMPONENT_COUNT; t++) {
+    SparseSet *set = &world->components[t];
+    state->strides[t] = (uint32_t)set->stride;
+    state->counts[t]  = set->count;
+    views[SECTION_ENTITIES(t)] = (SectionView){ set->entities, set->count * sizeof(Entity) };
+    views[SECTION_DATA(t)]     = (SectionView){ set->data, stored_stride(t, set) * set->count };
+  }
+}
+
+// Splits a snapshot buffer into per-section views. Unchanged sections of a
+// delta come back with a NULL data pointer and their flag set.
+static int read_sections(const Snapshot *snap, SnapshotHeader *header, SectionView *views, uint32_t *flags) {
+  if (!snap->data || snap->size < sizeof(SnapshotHeader)) {
+    printf("Failed to read snapshot - buffer too small: %zu\n", snap->size);
+    return 1;
+  }
+
+  memcpy(header, snap->data, sizeof(*header));
+  if (header->magic != SNAPSHOT_MAGIC) {
+    printf("Failed to read snapshot - bad magic: %08x\n", header->magic);
+    return 1;
+  }
+  if (header->version != SNAPSHOT_VERSION) {
+    printf("Failed to read snapshot - unsupported version: %d\n", header->version);
+    return 1;
+  }
+  if (header->size != snap->size || header->section_count != SECTION_COUNT) {
+    printf("Failed to read snapshot - corrupt header\n");
+    return 1;
+  }
+
+  // Every section must appear exactly once, or views and flags would be
+  // left holding stale stack data.
+  uint8_t seen[SECTION_COUNT] = {0};
+  size_t offset = sizeof(SnapshotHeader);
+  for (uint32_t i = 0; i < header->section_count; i++) {
+    SectionHeader section;
+    if (offset + sizeof(section) > snap->size) {
+      printf("Failed to read snapshot - truncated at section: %u\n", i);
+      return 1;
+    }
+    memcpy(&section, snap->data + offset, sizeof(section));
+    offset += sizeof(section);
+
+    if (section.id >= SECTION_COUNT) {
+      printf("Failed to read snapshot - unknown section: %u\n", section.id);
+      return 1;
+    }
+    if (seen[section.id]) {
+      printf("Failed to read snapshot - duplicate section: %u\n", section.id);
+      return 1;
+    }
+    seen[section.id] = 1;
+
+    flags[section.id] = section.flags;
+    if (section.flags & SECTION_UNCHANGED) {
+      views[section.id] = (SectionView){ NULL, section.size };
+      continue;
+    }
+
+    if (section.size > snap->size - offset) {
+      printf("Failed to read snapshot - truncated at section: %u\n", i);
+      return 1;
+    }
+    views[section.id] = (SectionView){ snap->data + offset, section.size };
+    offset += align8(section.size);
+  }
+  return 0;
+}
+
+static int capture(World *world, Snapshot *out, const Snapshot *base) {
+  SnapshotState state;
+  SectionView views[SECTION_COUNT];
+  describe_world(world, &state, views);
+
+  SnapshotHeader base_header = {0};
+  SectionView base_views[SECTION_COUNT];
+  uint32_t base_flags[SECTION_COUNT];
+  if (base) {
+    if (read_sections(base, &base_header, base_views, base_flags)) return 1;
+    if (base_header.flags & SNAPSHOT_DELTA) {
+      printf("Failed to take delta snapshot - base must be a full snapshot\n");
+      return 1;
+    }
+  }
+
+  size_t size = sizeof(SnapshotHeader);
+  for (int i = 0; i < SECTION_COUNT; i++) {
+    size += sizeof(SectionHeader) + align8(views[i].size);
+  }
+  reserve_bytes(out, size);
+
+  SnapshotHeader header = {
+    .magic          = SNAPSHOT_MAGIC,
+    .version        = SNAPSHOT_VERSION,
+    .flags          = base ? SNAPSHOT_DELTA : 0,
+    .section_count  = SECTION_COUNT,
+    .id             = next_snapshot_id++,
+    .base_id        = base ? base_header.id : 0,
+  };
+
+  size_t offset = sizeof(SnapshotHeader);
+  for (int i = 0; i < SECTION_COUNT; i++) {
+    SectionHeader section = { .id = i, .flags = 0, .size = views[i].size };
+
+    if (base && base_views[i].size == views[i].size &&
+        (views[i].size == 0 || memcmp(base_views[i].data, views[i].data, views[i].size) == 0)) {
+      section.flags = SECTION_UNCHANGED;
+    }
+
+    memcpy(out->data + offset, &section, sizeof(section));
+    offset += sizeof(section);
+    if (section.flags & SECTION_UNCHANGED) continue;
+
+    size_t padded = align8(views[i].size);
+    if (views[i].size) memcpy(out->data + offset, views[i].data, views[i].size);
+    memset(out->data + offset + views[i].size, 0, padded - views[i].size);
+    offset += padded;
+  }
+
+  header.size = offset;
+  memcpy(out->data, &header, sizeof(header));
+  out->size = offset;
+  return 0;
+}
+
+void snapshot_init(Snapshot *snap) {
+  snap->data      = NULL;
+  snap->size      = 0;
+  snap->capacity  = 0;
+}
+
+int world_snapshot(World *world, Snapshot *out) {
+  TRACE_FN();
+  return capture(world, out, NULL);
+}
+
+int world_snapshot_delta(World *world, Snapshot *out, const Snapshot *base) {
+  TRACE_FN();
+  return capture(world, out, base);
+}
+
+static int check_size(const SectionView *views, int id, size_t expected) {
+  if (views[id].size == expected) return 0;
+  printf("Failed to restore snapshot - section %d has %zu bytes, expected %zu\n", id, views[id].size, expected);
+  return 1;
+}
+
+// Every stored handle must name a slot the snapshot has, since restore
+// indexes the sparse map and slot arrays with it.
+static int check_entities(const Entity *entities, int count, int slot_count, int section) {
+  for (int i = 0; i < count; i++) {
+    if (entities[i] < 0 || entity_index(entities[i]) >= slot_count) {
+      printf("Failed to restore snapshot - section %d holds entity %d outside %d slots\n", section, entities[i], slot_count);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+// When the store still holds the same entities in the same order (the
+// usual case when rolling back a few frames) the sparse map is already
+// right and only the component data is copied.
+static void restore_store(SparseSet *set, int type, const SectionView *entities, const SectionView *data, int count) {
+  int same_layout = set->count == count &&
+                    (count == 0 || memcmp(set->entities, entities->data, entities->size) == 0);
+
+  if (!same_layout) {
+    sparse_set_clear(set);
+    sparse_set_reserve(set, count, 0);
+    if (count > 0) memcpy(set->entities, entities->data, entities->size);
+    set->count = count;
+    for (int i = 0; i < count; i++) {
+      set->sparse[entity_index(set->entities[i])] = i;
+    }
+  }
+  if (data->size) memcpy(set->data, data->data, data->size);
+
+  if (type != COMPONENT_TRANSFORM) return;
+  for (int i = 0; i < count; i++) {
+    TransformComponent *tc = sparse_set_at(set, TransformComponent, i);
+    tc->entity = set->entities[i];
+    tc->dirty  = 1;
+  }
+}
+
+int world_restore(World *world, const Snapshot *snap, const Snapshot *base) {
+  TRACE_FN();
+  SnapshotHeader header;
+  SectionView views[SECTION_COUNT];
+  uint32_t flags[SECTION_COUNT];
+  if (read_sections(snap, &header, views, flags)) return 1;
+
+  if (header.flags & SNAPSHOT_DELTA) {
+    SnapshotHeader base_header;
+    SectionView base_views[SECTION_COUNT];
+    uint32_t base_flags[SECTION_COUNT];
+    if (!base || read_sections(base, &base_header, base_views, base_flags)) {
+      printf("Failed to restore snapshot - delta needs its base snapshot\n");
+      return 1;
+    }
+    if (base_header.id != header.base_id) {
+      printf("Failed to restore snapshot - delta was taken against snapshot %llu, not %llu\n",
+             (unsigned long long)header.base_id, (unsigned long long)base_header.id);
+      return 1;
+    }
+    for (int i = 0; i < SECTION_COUNT; i++) {
+      if (flags[i] & SECTION_UNCHANGED) views[i] = base_views[i];
+    }
+  }
+
+  SnapshotState state;
+  if (check_size(views, SECTION_STATE, sizeof(state))) return 1;
+  memcpy(&state, views[SECTION_STATE].data, sizeof(state));
+
+  if (state.component_count != COMPONENT_COUNT) {
+    printf("Failed to restore snapshot - component count mismatch: %d\n", state.component_count);
+    return 1;
+  }
+  for (int t = 0; t < COMPONENT_COUNT; t++) {
+    if (state.strides[t] != world->components[t].stride) {
+      printf("Failed to restore snapshot - component %d layout changed\n", t);
+      return 1;
+    }
+  }
+  if (state.mesh_count != world->mesh_registry.count || state.material_count != world->material_registry.count) {
+    printf("Failed to restore snapshot - registries hold %d meshes/%d materials, snapshot expects %d/%d\n",
+           world->mesh_registry.count, world->material_registry.count, state.mesh_count, state.material_count);
+    return 1;
+  }
+  if (state.slot_count < 0 || state.slot_count > ENTITY_MAX_INDEX + 1 ||
+      state.free_count < 0 || state.free_count > state.slot_count) {
+    printf("Failed to restore snapshot - corrupt slot counts: %d slots, %d free\n", state.slot_count, state.free_count);
+    return 1;
+  }
+  for (int t = 0; t < COMPONENT_COUNT; t++) {
+    if (state.counts[t] < 0 || state.counts[t] > state.slot_count) {
+      printf("Failed to restore snapshot - component %d holds %d entries for %d slots\n", t, state.counts[t], state.slot_count);
+      return 1;
+    }
+  }
+
+  if (check_size(views, SECTION_GENERATIONS, state.slot_count * sizeof(int)) ||
+      check_size(views, SECTION_ALIVE, alive_words(state.slot_count) * sizeof(uint64_t)) ||
+      check_size(views, SECTION_SIGNATURES, state.slot_count * sizeof(ComponentMask)) ||
+      check_size(views, SECTION_FREE_SLOTS, state.free_count * sizeof(int)) ||
+      check_size(views, SECTION_COLLIDER_MESHES, state.collider_mesh_count * sizeof(uint32_t))) {
+    return 1;
+  }
+  for (int t = 0; t < COMPONENT_COUNT; t++) {
+    if (check_size(views, SECTION_ENTITIES(t), state.counts[t] * sizeof(Entity)) ||
+        check_size(views, SECTION_DATA(t), state.counts[t] * stored_stride(t, &world->components[t])) ||
+        check_entities(views[SECTION_ENTITIES(t)].data, state.counts[t], state.slot_count, SECTION_ENTITIES(t))) {
+      return 1;
+    }
+  }
+  // BVHs are not copied either: every mesh a stored collider names must
+  // still be the same build. Meshes freed or rebuilt since are refused,
+  // while ones added since are left in place.
+  const ColliderComponent *colliders = views[SECTION_DATA(COMPONENT_COLLIDER)].data;
+  const uint32_t *mesh_ids = views[SECTION_COLLIDER_MESHES].data;
+  const ColliderMeshes *cm = &world->collider_meshes;
+  for (int i = 0; i < state.counts[COMPONENT_COLLIDER]; i++) {
+    int mesh = colliders[i].mesh;
+    if (mesh < 0) continue;
+    if (mesh >= state.collider_mesh_count || mesh >= cm->count || cm->ids[mesh] != mesh_ids[mesh]) {
+      printf("Failed to restore snapshot - collider mesh %d was freed or rebuilt since the snapshot\n", mesh);
+      return 1;
+    }
+  }
+  const int *free_slots = views[SECTION_FREE_SLOTS].data;
+  for (int i = 0; i < state.free_count; i++) {
+    if (free_slots[i] < 0 || free_slots[i] >= state.slot_count) {
+      printf("Failed to restore snapshot - free slot %d outside %d slots\n", free_slots[i], state.slot_count);
+      return 1;
+    }
+  }
+
+  world_reserve(world, state.slot_count);
+  if (state.slot_count > 0) {
+    memcpy(world->generations, views[SECTION_GENERATIONS].data, views[SECTION_GENERATIONS].size);
+    memcpy(world->signatures, views[SECTION_SIGNATURES].data, views[SECTION_SIGNATURES].size);
+    memset(world->alive, 0, alive_words(world->slot_capacity) * sizeof(uint64_t));
+    memcpy(world->alive, views[SECTION_ALIVE].data, views[SECTION_ALIVE].size);
+  }
+  if (state.free_count > 0) {
+    memcpy(world->free_slots, views[SECTION_FREE_SLOTS].data, views[SECTION_FREE_SLOTS].size);
+  }
+  world->slot_count = state.slot_count;
+  world->free_count = state.free_count;
+
+  for (int t = 0; t < COMPONENT_COUNT; t++) {
+    restore_store(&world->components[t], t, &views[SECTION_ENTITIES(t)], &views[SECTION_DATA(t)], state.counts[t]);
+  }
+  for (int i = 0; i < world->query_count; i++) {
+    world->queries[i].dirty = 1;
+  }
+  for (int i = 0; i < MAX_COMMAND_BUFFERS; i++) {
+    command_buffer_clear(&world->commands[i]);
+  }
+
+  world->hierarchy_unsorted = state.hierarchy_unsorted;
+  world->player = state.player;
+
+  // Mouse tracking belongs to the live input, not the simulation.
+  Camera camera = state.camera;
+  camera.last_mx      = world->camera.last_mx;
+  camera.last_my      = world->camera.last_my;
+  camera.initialized  = world->camera.initialized;
+  world->camera = camera;
+  return 0;
+}
+
+int snapshot_save(const Snapshot *snap, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    printf("Failed to open snapshot file: %s\n", path);
+    return 1;
+  }
+
+  size_t written = fwrite(snap->data, 1, snap->size, file);
+  fclose(file);
+  if (written != snap->size) {
+    printf("Failed to write snapshot file: %s\n", path);
+    return 1;
+  }
+  return 0;
+}
+
+int snapshot_load(Snapshot *snap, const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    printf("Failed to open snapshot file: %s\n", path);
+    return 1;
+  }
+
+  fseek(file, 0, SEEK_END);
+  long size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  if (size <= 0) {
+    printf("Failed to read snapshot file: %s\n", path);
+    fclose(file);
+    return 1;
+  }
+
+  reserve_bytes(snap, (size_t)size);
+  snap->size = fread(snap->data, 1, (size_t)size, file);
+  fclose(file);
+
+  SnapshotHeader header;
+  SectionView views[SECTION_COUNT];
+  uint32_t flags[SECTION_COUNT];
+  if (snap->size != (size_t)size || read_sections(snap, &header, views, flags)) {
+    printf("Failed to read snapshot file: %s\n", path);
+    snap->size = 0;
+    return 1;
+  }
+  return 0;
+}
+
+void snapshot_destroy(Snapshot *snap) {
+  free(snap->data);
+  snapshot_init(snap);
+}
+
+
+// RING
+
+void snapshot_ring_init(SnapshotRing *ring, int capacity) {
+  ring->slots     = malloc(capacity * sizeof(Snapshot));
+  ring->capacity  = capacity;
+  ring->head      = 0;
+  ring->count     = 0;
+  for (int i = 0; i < capacity; i++) {
+    snapshot_init(&ring->slots[i]);
+  }
+}
+
+Snapshot* snapshot_ring_push(SnapshotRing *ring, World *world) {
+  Snapshot *snap = &ring->slots[ring->head];
+  if (world_snapshot(world, snap)) return NULL;
+
+  ring->head = (ring->head + 1) % ring->capacity;
+  if (ring->count < ring->capacity) ring->count++;
+  return snap;
+}
+
+// 0 is the most recent snapshot.
+Snapshot* snapshot_ring_get(SnapshotRing *ring, int frames_back) {
+  if (frames_back < 0 || frames_back >= ring->count) return NULL;
+  int index = (ring->head - 1 - frames_back + ring->capacity) % ring->capacity;
+  return &ring->slots[index];
+}
+
+// Restores the most recent snapshot and drops it, stepping history back
+// one frame. Returns 1 once the history is exhausted.
+int snapshot_ring_pop(SnapshotRing *ring, World *world) {
+  Snapshot *snap = snapshot_ring_get(ring, 0);
+  if (!snap || world_restore(world, snap, NULL)) return 1;
+
+  ring->head = (ring->head - 1 + ring->capacity) % ring->capacity;
+  ring->count--;
+  return 0;
+}
+
+void snapshot_ring_destroy(SnapshotRing *ring) {
+  for (int i = 0; i < ring->capacity; i++) {
+    snapshot_destroy(&ring->slots[i]);
+  }
+  free(ring->slots);
+  ring->slots     = NULL;
+  ring->capacity  = 0;
+  ring->head      = 0;
+  ring->count     = 0;
+}
@@ -0,0 +1,49 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ecs/World.h"
+
+#define SNAPSHOT_MAGIC    0x50414E53u  // "SNAP"
+#define SNAPSHOT_VERSION  3
+
+// A snapshot is one contiguous, versioned buffer: a header followed by
+// sections, each a raw copy of one World array (the entity slot arrays,
+// or a component store's dense entities/data). Restoring is a memcpy per
+// section plus rebuilding the sparse maps. Meshes, materials and collider
+// BVHs are not copied; component ids are checked against the current
+// registry sizes, and collider meshes against their build ids.
+//
+// A delta snapshot leaves out every section that is byte-identical to its
+// base and can only be restored together with that base.
+typedef struct {
+  unsigned char *data;
+  size_t        size;
+  size_t        capacity;
+} Snapshot;
+
+// Fixed-size history of full snapshots. Slots keep their buffers, so
+// pushing every frame stops allocating once the ring has wrapped.
+typedef struct {
+  Snapshot  *slots;
+  int       capacity;
+  int       head;
+  int       count;
+} SnapshotRing;
+
+void snapshot_init(Snapshot *snap);
+int  world_snapshot(World *world, Snapshot *out);
+int  world_snapshot_delta(World *world, Snapshot *out, const Snapshot *base);
+int  world_restore(World *world, const Snapshot *snap, const Snapshot *base);
+int  snapshot_save(const Snapshot *snap, const char *path);
+int  snapshot_load(Snapshot *snap, const char *path);
+void snapshot_destroy(Snapshot *snap);
+
+void      snapshot_ring_init(SnapshotRing *ring, int capacity);
+Snapshot* snapshot_ring_push(SnapshotRing *ring, World *world);
+Snapshot* snapshot_ring_get(SnapshotRing *ring, int frames_back);
+int       snapshot_ring_pop(SnapshotRing *ring, World *world);
+void      snapshot_ring_destroy(SnapshotRing *ring);
+
+#endif
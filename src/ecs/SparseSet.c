@@ -0,0 +1,125 @@
+#include "SparseSet.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_CAPACITY 16
+
+void sparse_set_init(SparseSet *set, size_t stride) {
+  set->sparse           = NULL;
+  set->sparse_capacity  = 0;
+  set->entities         = NULL;
+  set->data             = NULL;
+  set->stride           = stride;
+  set->count            = 0;
+  set->capacity         = 0;
+}
+
+static void grow_sparse(SparseSet *set, int index) {
+  int capacity = set->sparse_capacity ? set->sparse_capacity : MIN_CAPACITY;
+  while (capacity <= index) capacity *= 2;
+
+  set->sparse = realloc(set->sparse, capacity * sizeof(int));
+  for (int i = set->sparse_capacity; i < capacity; i++) {
+    set->sparse[i] = -1;
+  }
+  set->sparse_capacity = capacity;
+}
+
+static void grow_dense(SparseSet *set, int min_capacity) {
+  int capacity = set->capacity ? set->capacity : MIN_CAPACITY;
+  while (capacity < min_capacity) capacity *= 2;
+  set->entities = realloc(set->entities, capacity * sizeof(Entity));
+  set->data     = realloc(set->data, capacity * set->stride);
+  set->capacity = capacity;
+}
+
+int sparse_set_index(SparseSet *set, Entity e) {
+  if (e < 0) return -1;
+  int index = entity_index(e);
+  if (index >= set->sparse_capacity) return -1;
+
+  // The dense entity check rejects stale handles whose slot was recycled.
+  int idx = set->sparse[index];
+  if (idx < 0 || set->entities[idx] != e) return -1;
+  return idx;
+}
+
+void* sparse_set_add(SparseSet *set, Entity e) {
+  int idx = sparse_set_index(set, e);
+  if (idx >= 0) return (char *)set->data + idx * set->stride;
+
+  int index = entity_index(e);
+  if (index >= set->sparse_capacity) grow_sparse(set, index);
+  if (set->count == set->capacity) grow_dense(set, set->count + 1);
+
+  idx = set->count++;
+  set->sparse[index] = idx;
+  set->entities[idx] = e;
+  return (char *)set->data + idx * set->stride;
+}
+
+void* sparse_set_get(SparseSet *set, Entity e) {
+  int idx = sparse_set_index(set, e);
+  if (idx < 0) return NULL;
+  return (char *)set->data + idx * set->stride;
+}
+
+void sparse_set_remove(SparseSet *set, Entity e) {
+  int idx = sparse_set_index(set, e);
+  if (idx < 0) return;
+
+  int last = set->count - 1;
+  if (idx != last) {
+    Entity moved = set->entities[last];
+    set->entities[idx] = moved;
+    memcpy((char *)set->data + idx * set->stride,
+           (char *)set->data + last * set->stride,
+           set->stride);
+    set->sparse[entity_index(moved)] = idx;
+  }
+
+  set->sparse[entity_index(e)] = -1;
+  set->count--;
+}
+
+// Exchanges two dense slots, keeping the sparse mapping in step. Used to
+// keep a store in a particular iteration order.
+void sparse_set_swap(SparseSet *set, int a, int b) {
+  if (a == b) return;
+
+  Entity ea = set->entities[a];
+  Entity eb = set->entities[b];
+  set->entities[a] = eb;
+  set->entities[b] = ea;
+  set->sparse[entity_index(ea)] = b;
+  set->sparse[entity_index(eb)] = a;
+
+  unsigned char *pa = (unsigned char *)set->data + a * set->stride;
+  unsigned char *pb = (unsigned char *)set->data + b * set->stride;
+  for (size_t i = 0; i < set->stride; i++) {
+    unsigned char t = pa[i];
+    pa[i] = pb[i];
+    pb[i] = t;
+  }
+}
+
+void sparse_set_reserve(SparseSet *set, int capacity, int max_index) {
+  if (max_index >= set->sparse_capacity) grow_sparse(set, max_index);
+  if (capacity > set->capacity) grow_dense(set, capacity);
+}
+
+// Empties the set but keeps its allocations for reuse. Only slots that are
+// actually mapped get reset, so this is O(count) rather than O(capacity).
+void sparse_set_clear(SparseSet *set) {
+  for (int i = 0; i < set->count; i++) {
+    set->sparse[entity_index(set->entities[i])] = -1;
+  }
+  set->count = 0;
+}
+
+void sparse_set_destroy(SparseSet *set) {
+  free(set->sparse);
+  free(set->entities);
+  free(set->data);
+  sparse_set_init(set, set->stride);
+}
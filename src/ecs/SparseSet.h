@@ -0,0 +1,33 @@
+#ifndef SPARSE_SET_H
+#define SPARSE_SET_H
+
+#include <stddef.h>
+#include "ecs/Entity.h"
+
+// Sparse set component storage: `sparse` maps an entity index to its slot in
+// the densely packed `entities`/`data` arrays. Removal swaps the last slot
+// into the hole, so pointers into `data` are only stable until the next
+// add/remove.
+typedef struct {
+  int     *sparse;
+  int     sparse_capacity;
+  Entity  *entities;
+  void    *data;
+  size_t  stride;
+  int     count;
+  int     capacity;
+} SparseSet;
+
+#define sparse_set_at(set, type, i) (&((type *)(set)->data)[i])
+
+void  sparse_set_init(SparseSet *set, size_t stride);
+void* sparse_set_add(SparseSet *set, Entity e);
+void* sparse_set_get(SparseSet *set, Entity e);
+int   sparse_set_index(SparseSet *set, Entity e);
+void  sparse_set_remove(SparseSet *set, Entity e);
+void  sparse_set_swap(SparseSet *set, int a, int b);
+void  sparse_set_reserve(SparseSet *set, int capacity, int max_index);
+void  sparse_set_clear(SparseSet *set);
+void  sparse_set_destroy(SparseSet *set);
+
+#endif
@@ -1,22 +1,147 @@
 #include "System.h"
 #include "ecs/World.h"
+#include "ecs/Scheduler.h"
+#include "core/JobSystem.h"
+#include "core/Trace.h"
 #include "maths/Maths3D.h"
-#include "vendor/uthash.h"
+#include "physics/Broadphase.h"
+#include "physics/Integrate.h"
+#include "physics/Narrowphase.h"
+#include "physics/RigidBodies.h"
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
-#define DOWN (Vec3f){0.0f, -1.0f, 0.0f}
 #define GRAVITY 9.8f
+#define INTEGRATE_BLOCK 256
+#define COLLISION_MARGIN 0.1f
+#define NARROWPHASE_CHUNK 256
+#define NARROWPHASE_BLOCK 64
+#define NARROWPHASE_MIN_BATCH 16
+// A body that stays within SLEEP_DISTANCE of where it came to rest for
+// SLEEP_TIME seconds may sleep.
+#define SLEEP_DISTANCE 0.01f
+#define SLEEP_TIME 0.5f
 
-static void apply_paths(World *world) {
-  PathComponent *p, *tmp1;
-  HASH_ITER(hh, world->paths, p, tmp1) {
-    SpeedComponent *sc = world_get_speed(world, p->entity);
-    if (!sc) continue;
-    PositionComponent *pc = world_get_position(world, p->entity);
-    if (!pc) {
-      world_add_position(world, p->entity, p->path.starting_pos);
-      continue;
-    }
+#define PATH_QUERY      (COMPONENT_BIT(COMPONENT_PATH) | COMPONENT_BIT(COMPONENT_SPEED) | \
+                         COMPONENT_BIT(COMPONENT_POSITION) | COMPONENT_BIT(COMPONENT_VELOCITY))
+#define MOTION_QUERY    (COMPONENT_BIT(COMPONENT_VELOCITY))
+#define COLLIDER_QUERY  (COMPONENT_BIT(COMPONENT_COLLIDER) | COMPONENT_BIT(COMPONENT_POSITION))
+#define MASS_QUERY      (COMPONENT_BIT(COMPONENT_MASS))
+
+// One overlapping pair found by the narrowphase: pushing `a` by `depth`
+// along `normal` (a signed unit axis) separates it from `b`. `slot` is the
+// pair's position in the partner lists, which is the order contacts are
+// resolved in.
+typedef struct {
+  int     slot;
+  int     body;
+  Entity  a;
+  Entity  b;
+  Vec3f   normal;
+  float   depth;
+} Contact;
+
+typedef struct {
+  Contact *items;
+  int     count;
+  int     capacity;
+} ContactBuffer;
+
+#define PARTNER_LANES (NARROWPHASE_BLOCK + NARROWPHASE_PADDING)
+
+// Up to NARROWPHASE_BLOCK partners of one body from slot `first` on,
+// gathered into SoA form for narrowphase_next().
+typedef struct {
+  float             px[PARTNER_LANES], py[PARTNER_LANES], pz[PARTNER_LANES];
+  float             hx[PARTNER_LANES], hy[PARTNER_LANES], hz[PARTNER_LANES];
+  int               first;
+  NarrowphaseBatch  batch;
+} PartnerBlock;
+
+// Where one chunk of the narrowphase left its contacts.
+typedef struct {
+  int thread;
+  int start;
+  int count;
+} NarrowChunk;
+
+// The physics step's state, kept across ticks so a steady scene never
+// allocates. `bodies` holds every body the step touches; load_bodies copies
+// them in from their components and store_bodies copies them back, and
+// everything in between works on the store alone. Its layout (and the
+// component pointers it syncs through) is only redone when the collider,
+// motion or mass query is rebuilt. The first `moving_count` rows are the
+// moving bodies (every collider not baked into the world's static BVH), so
+// a row is also the body's index in the broadphase. Sleeping bodies stay
+// among them but are flagged in `moving_static`, so the broadphase treats
+// them like statics and nothing resolves them.
+typedef struct {
+  Broadphase          broadphase;
+  PairList            pairs;
+  RigidBodies         bodies;
+  ColliderComponent   **colliders;
+  PositionComponent   **positions;
+  MassComponent       **masses;
+  VelocityComponent   **velocities;
+  int                 *query_row;
+  int                 *row_of_slot;
+  int                 slot_capacity;
+  int                 body_count;
+  Aabb                *moving_bounds;
+  unsigned char       *moving_static;
+  int                 moving_count;
+  Aabb                *hit_bounds;
+  int                 *hit_start;
+  int                 *hits;
+  int                 hit_count;
+  int                 hit_capacity;
+  int                 *mesh_hits;
+  int                 mesh_hit_count;
+  int                 mesh_hit_capacity;
+  int                 *triangles;
+  int                 triangle_count;
+  int                 triangle_capacity;
+  int                 *last_hit_start;
+  int                 *last_hits;
+  int                 last_hit_capacity;
+  int                 hits_valid;
+  int                 *partner_start;
+  int                 *partners;
+  int                 capacity;
+  int                 partner_capacity;
+  ContactBuffer       thread_contacts[MAX_JOB_THREADS];
+  NarrowChunk         *chunks;
+  int                 chunk_capacity;
+  unsigned char       *moved;
+  int                 *island_parent;
+  int                 *island_size;
+  float               *island_time;
+  int                 *island_tally;
+  int                 tally_capacity;
+  int                 islands_dirty;
+  int                 wake_all;
+  unsigned int        collider_version;
+  unsigned int        motion_version;
+  unsigned int        mass_version;
+  unsigned int        layout_version;
+} CollisionState;
+
+static Scheduler scheduler;
+static CollisionState collision;
+static BroadphaseType broadphase_type = BROADPHASE_SPATIAL_HASH;
+static int sleeping_enabled = 1;
+static int systems_ready = 0;
+
+static void apply_paths(World *world, SystemContext *ctx) {
+  CommandBuffer *cmd = ctx->commands;
+
+  QueryIter it = query_iter_range(world, PATH_QUERY, ctx->begin, ctx->end);
+  while (query_next(&it)) {
+    PathComponent  *p  = it.components[COMPONENT_PATH];
+    SpeedComponent *sc = it.components[COMPONENT_SPEED];
+    PositionComponent *pc = it.components[COMPONENT_POSITION];
+    VelocityComponent *vc = it.components[COMPONENT_VELOCITY];
 
     int prev = p->path.current_waypoint == 0
       ? p->path.waypoint_count - 1
@@ -47,9 +172,8 @@ static void apply_paths(World *world) {
         if (p->path.is_loop) {
           p->path.current_waypoint = 0;
         } else {
-          VelocityComponent *vc = world_get_velocity(world, p->entity);
-          if (vc) vc->velocity = vec3f_identity();
-          world_destroy_path(world, p);
+          vc->velocity = vec3f_identity();
+          command_remove(cmd, p->entity, COMPONENT_PATH);
           continue;
         }
       }
@@ -59,72 +183,897 @@ static void apply_paths(World *world) {
       direction = vec3f_normalize(to_target);
     }
 
-    Vec3f velocity = vec3f_scale(direction, sc->speed);
-    VelocityComponent *vc = world_get_velocity(world, p->entity);
-    if (!vc) {
-      world_add_velocity(world, p->entity, velocity);
+    vc->velocity = vec3f_scale(direction, sc->speed);
+  }
+}
+
+static void update_player(World *world, SystemContext *ctx) {
+  (void)ctx;
+
+  PositionComponent *player_pos = world_get_position(world, world->player.entity);
+  if (player_pos) world->camera.pos = player_pos->position;
+}
+
+static void grow_collision_state(int count, int partner_count) {
+  CollisionState *cs = &collision;
+  if (count > cs->capacity) {
+    cs->capacity       = count;
+    cs->colliders      = realloc(cs->colliders, count * sizeof(ColliderComponent *));
+    cs->positions      = realloc(cs->positions, count * sizeof(PositionComponent *));
+    cs->masses         = realloc(cs->masses, count * sizeof(MassComponent *));
+    cs->velocities     = realloc(cs->velocities, count * sizeof(VelocityComponent *));
+    cs->query_row      = realloc(cs->query_row, count * sizeof(int));
+    cs->moving_bounds  = realloc(cs->moving_bounds, count * sizeof(Aabb));
+    cs->moving_static  = realloc(cs->moving_static, count);
+    cs->hit_bounds     = realloc(cs->hit_bounds, count * sizeof(Aabb));
+    cs->hit_start      = realloc(cs->hit_start, (count + 1) * sizeof(int));
+    cs->last_hit_start = realloc(cs->last_hit_start, (count + 1) * sizeof(int));
+    cs->partner_start  = realloc(cs->partner_start, (count + 1) * sizeof(int));
+    cs->moved          = realloc(cs->moved, count);
+    cs->island_parent  = realloc(cs->island_parent, count * sizeof(int));
+    cs->island_size    = realloc(cs->island_size, count * sizeof(int));
+    cs->island_time    = realloc(cs->island_time, count * sizeof(float));
+    rigid_bodies_reserve(&cs->bodies, count);
+    // Statics that move are handed over as dynamic bodies, so the only
+    // statics the broadphase sees are sleeping bodies.
+    memset(cs->moving_static, 0, count);
+  }
+  if (partner_count > cs->partner_capacity) {
+    cs->partner_capacity = partner_count;
+    cs->partners = realloc(cs->partners, cs->partner_capacity * sizeof(int));
+  }
+}
+
+// Dynamic bodies that are awake get pushed out of their partners.
+static int resolves(const CollisionState *cs, int k) {
+  return !cs->moving_static[k] && !(cs->bodies.flags[k] & BODY_STATIC);
+}
+
+// Turns the broadphase pairs and static hits into, for every awake dynamic
+// moving body, its candidate partners as rows. Each list is sorted by the
+// partners' collider query rows, the order they have always resolved in.
+static void build_partner_lists(void) {
+  CollisionState *cs = &collision;
+  int count = cs->moving_count;
+  int *start = cs->partner_start;
+  const int *order = cs->query_row;
+
+  memset(start, 0, (count + 1) * sizeof(int));
+  for (int p = 0; p < cs->pairs.count; p++) {
+    BodyPair pair = cs->pairs.pairs[p];
+    if (resolves(cs, pair.a)) start[pair.a + 1]++;
+    if (resolves(cs, pair.b)) start[pair.b + 1]++;
+  }
+  for (int k = 0; k < count; k++) start[k + 1] += start[k] + cs->hit_start[k + 1] - cs->hit_start[k];
+
+  for (int p = 0; p < cs->pairs.count; p++) {
+    BodyPair pair = cs->pairs.pairs[p];
+    if (resolves(cs, pair.a)) cs->partners[start[pair.a]++] = pair.b;
+    if (resolves(cs, pair.b)) cs->partners[start[pair.b]++] = pair.a;
+  }
+  for (int k = 0; k < count; k++) {
+    for (int h = cs->hit_start[k]; h < cs->hit_start[k + 1]; h++) cs->partners[start[k]++] = cs->hits[h];
+  }
+  for (int k = count; k > 0; k--) start[k] = start[k - 1];
+  start[0] = 0;
+
+  for (int k = 0; k < count; k++) {
+    int *list = cs->partners + start[k];
+    int n = start[k + 1] - start[k];
+    for (int m = 1; m < n; m++) {
+      int v = list[m], j = m - 1;
+      for (; j >= 0 && order[list[j]] > order[v]; j--) list[j + 1] = list[j];
+      list[j + 1] = v;
+    }
+  }
+}
+
+// STATIC COLLIDERS
+
+typedef struct {
+  Entity  entity;
+  Aabb    bounds;
+} BakeEntry;
+
+static int compare_bake_entries(const void *x, const void *y) {
+  Entity a = ((const BakeEntry *)x)->entity, b = ((const BakeEntry *)y)->entity;
+  return (a > b) - (a < b);
+}
+
+static Aabb collider_bounds(const ColliderComponent *c, const PositionComponent *p) {
+  Vec3f half = vec3f_add(c->half_extents, (Vec3f){COLLISION_MARGIN, COLLISION_MARGIN, COLLISION_MARGIN});
+  return (Aabb){ vec3f_sub(p->position, half), vec3f_add(p->position, half) };
+}
+
+// Statics that can move (they have a velocity) are treated like dynamic
+// bodies instead of being baked. Mesh colliders are always baked: only the
+// static BVH leads to them.
+static int is_baked_static(World *world, const ColliderComponent *c) {
+  if (c->mesh >= 0) return 1;
+  return c->is_static && !(world_signature(world, c->entity) & COMPONENT_BIT(COMPONENT_VELOCITY));
+}
+
+// Collects the static colliders of the current collider query and rebuilds
+// the BVH only if they differ from the last bake, so only adding, removing
+// or moving a static costs a rebuild. Returns whether it rebuilt.
+static int bake_statics(World *world, Query *q) {
+  TRACE_FN();
+  StaticColliders *sc = &world->static_colliders;
+  sc->layout_version = q->version;
+
+  BakeEntry *entries = malloc((q->count ? q->count : 1) * sizeof(BakeEntry));
+  int count = 0;
+  QueryIter it = query_iter(world, COLLIDER_QUERY);
+  while (query_next(&it)) {
+    ColliderComponent *c = it.components[COMPONENT_COLLIDER];
+    PositionComponent *p = it.components[COMPONENT_POSITION];
+    if (!is_baked_static(world, c)) continue;
+    entries[count++] = (BakeEntry){ it.entity, collider_bounds(c, p) };
+  }
+  qsort(entries, count, sizeof(BakeEntry), compare_bake_entries);
+
+  int same = count == sc->count;
+  for (int i = 0; same && i < count; i++) {
+    same = entries[i].entity == sc->entities[i] &&
+           memcmp(&entries[i].bounds, &sc->bounds[i], sizeof(Aabb)) == 0;
+  }
+
+  if (!same) {
+    if (count > sc->capacity) {
+      sc->capacity = count;
+      sc->entities = realloc(sc->entities, count * sizeof(Entity));
+      sc->bounds   = realloc(sc->bounds, count * sizeof(Aabb));
+    }
+    for (int i = 0; i < count; i++) {
+      sc->entities[i] = entries[i].entity;
+      sc->bounds[i]   = entries[i].bounds;
+    }
+    sc->count = count;
+    static_bvh_build(&sc->bvh, sc->bounds, sc->entities, count);
+    sc->build_count++;
+  }
+  free(entries);
+  return !same;
+}
+
+// Appends a row for entity e, which is row `query_row` of the collider
+// query or -1 if it has no collider row.
+static int add_body(World *world, Entity e, int query_row) {
+  CollisionState *cs = &collision;
+  RigidBodies *b = &cs->bodies;
+  int row = b->count++;
+  cs->colliders[row]  = world_get_collider(world, e);
+  cs->positions[row]  = world_get_position(world, e);
+  cs->masses[row]     = world_get_mass(world, e);
+  cs->velocities[row] = world_get_velocity(world, e);
+  cs->query_row[row]  = query_row;
+  b->ids[row]   = e;
+  b->flags[row] = (cs->positions[row] ? BODY_POSITION : 0) | (cs->velocities[row] ? BODY_VELOCITY : 0) |
+                  (cs->masses[row] ? BODY_MASS : 0) | (query_row >= 0 ? BODY_COLLIDER : 0);
+  if (query_row >= 0) cs->row_of_slot[entity_index(e)] = row;
+  return row;
+}
+
+// Copies row i in from its components.
+static void load_body(CollisionState *cs, int i) {
+  RigidBodies       *b  = &cs->bodies;
+  ColliderComponent *c  = cs->colliders[i];
+  PositionComponent *p  = cs->positions[i];
+  VelocityComponent *v  = cs->velocities[i];
+  MassComponent     *mc = cs->masses[i];
+  unsigned char flags = (b->flags[i] & BODY_LAYOUT) | BODY_LOADED;
+
+  rigid_body_set_position(b, i, p ? p->position : vec3f_identity());
+  rigid_body_set_velocity(b, i, v ? v->velocity : vec3f_identity());
+
+  if (c) {
+    b->hx[i] = c->half_extents.x;
+    b->hy[i] = c->half_extents.y;
+    b->hz[i] = c->half_extents.z;
+    b->friction[i]    = c->friction;
+    b->restitution[i] = c->restitution;
+    b->mesh[i]        = c->mesh;
+    if (c->is_static) flags |= BODY_STATIC;
+  } else {
+    b->hx[i] = b->hy[i] = b->hz[i] = 0.0f;
+    b->friction[i]    = 0.8f;   // what a body without a collider slides with
+    b->restitution[i] = 0.0f;
+    b->mesh[i]        = -1;
+  }
+
+  if (mc) {
+    b->inv_mass[i]    = mc->mass > 0.0f ? 1.0f / mc->mass : 0.0f;
+    b->grounded[i]    = mc->grounded_entity;
+    b->sleep_time[i]  = mc->sleep_time;
+    b->rx[i] = mc->rest_position.x;
+    b->ry[i] = mc->rest_position.y;
+    b->rz[i] = mc->rest_position.z;
+    b->island[i]      = mc->island;
+    b->island_size[i] = mc->island_size;
+    if (mc->sleeping) flags |= BODY_SLEEPING;
+  } else {
+    b->inv_mass[i]    = 0.0f;
+    b->grounded[i]    = ENTITY_NONE;
+    b->sleep_time[i]  = 0.0f;
+    b->rx[i] = b->ry[i] = b->rz[i] = 0.0f;
+    b->island[i]      = ENTITY_NONE;
+    b->island_size[i] = 0;
+  }
+  b->flags[i] = flags;
+}
+
+static int has_motion(World *world, Entity e) {
+  return (world_signature(world, e) & (COMPONENT_BIT(COMPONENT_VELOCITY) | COMPONENT_BIT(COMPONENT_MASS))) != 0;
+}
+
+// Lays the store out again after the collider, motion or mass query was
+// rebuilt. Moving colliders come first, in query order; then every other
+// body the step integrates or may wake (baked colliders with a velocity or
+// mass, and bodies without a collider row), which are copied in each tick
+// like the moving ones; then the remaining baked statics, copied in here
+// once. Also rebuilds the slot-to-row map used for BVH hits and checks
+// whether the baked statics are still current.
+static void refresh_layout(World *world, Query *q, Query *motion, Query *mass) {
+  CollisionState *cs = &collision;
+  RigidBodies *b = &cs->bodies;
+  StaticColliders *sc = &world->static_colliders;
+  grow_collision_state(q->count + motion->count + mass->count, 0);
+
+  if (world->slot_count > cs->slot_capacity) {
+    cs->slot_capacity = world->slot_count;
+    cs->row_of_slot = realloc(cs->row_of_slot, cs->slot_capacity * sizeof(int));
+  }
+
+  int baked_count = 0;
+  b->count = 0;
+  QueryIter it = query_iter(world, COLLIDER_QUERY);
+  for (int i = 0; query_next(&it); i++) {
+    if (is_baked_static(world, it.components[COMPONENT_COLLIDER])) {
+      baked_count++;
+      continue;
+    }
+    add_body(world, it.entity, i);
+  }
+  cs->moving_count = b->count;
+
+  it = query_iter(world, COLLIDER_QUERY);
+  for (int i = 0; query_next(&it); i++) {
+    if (is_baked_static(world, it.components[COMPONENT_COLLIDER]) && has_motion(world, it.entity)) {
+      add_body(world, it.entity, i);
+    }
+  }
+  it = query_iter(world, MOTION_QUERY);
+  while (query_next(&it)) {
+    if ((world_signature(world, it.entity) & COLLIDER_QUERY) != COLLIDER_QUERY) add_body(world, it.entity, -1);
+  }
+  it = query_iter(world, MASS_QUERY);
+  while (query_next(&it)) {
+    ComponentMask signature = world_signature(world, it.entity);
+    if ((signature & COLLIDER_QUERY) == COLLIDER_QUERY || (signature & MOTION_QUERY)) continue;
+    add_body(world, it.entity, -1);
+  }
+  cs->body_count = b->count;
+
+  it = query_iter(world, COLLIDER_QUERY);
+  for (int i = 0; query_next(&it); i++) {
+    if (is_baked_static(world, it.components[COMPONENT_COLLIDER]) && !has_motion(world, it.entity)) {
+      load_body(cs, add_body(world, it.entity, i));
+    }
+  }
+
+  // Anything resting on a static that was removed or moved has to fall.
+  if (sc->layout_version != q->version || sc->count != baked_count) {
+    if (bake_statics(world, q)) cs->wake_all = 1;
+  }
+
+  cs->collider_version = q->version;
+  cs->motion_version   = motion->version;
+  cs->mass_version     = mass->version;
+  cs->hits_valid       = 0;
+  cs->islands_dirty    = 1;
+  // The moving set can change without the collider query being rebuilt,
+  // so the broadphase gets its own layout counter.
+  cs->layout_version++;
+}
+
+// Copies the bodies in at the start of the step, after laying the store
+// out again if a query it follows was rebuilt. A sleeping body cannot have
+// changed since it was last copied in unless it was woken, which marks the
+// islands dirty, so while they are clean sleeping rows are left as they are.
+static void load_bodies(World *world, SystemContext *ctx) {
+  (void)ctx;
+  TRACE_FN();
+  CollisionState *cs = &collision;
+  RigidBodies *b = &cs->bodies;
+
+  Query *q      = world_query(world, COLLIDER_QUERY);
+  Query *motion = world_query(world, MOTION_QUERY);
+  Query *mass   = world_query(world, MASS_QUERY);
+  if (!q || !motion || !mass) {
+    // Out of query slots: nothing steps until the layout can be read.
+    b->count = cs->body_count = cs->moving_count = 0;
+    cs->pairs.count      = 0;
+    cs->collider_version = 0;
+    cs->layout_version++;
+    return;
+  }
+  if (cs->collider_version != q->version || cs->motion_version != motion->version ||
+      cs->mass_version != mass->version) {
+    refresh_layout(world, q, motion, mass);
+  }
+
+  for (int i = 0; i < cs->body_count; i++) {
+    if ((b->flags[i] & BODY_SLEEPING) && !cs->islands_dirty) continue;
+    load_body(cs, i);
+  }
+}
+
+// Copies back every row that was copied in this tick, and the sleep state
+// of any other row that was woken. Only a position that changed marks the
+// transform dirty.
+static void store_bodies(World *world, SystemContext *ctx) {
+  (void)ctx;
+  TRACE_FN();
+  CollisionState *cs = &collision;
+  RigidBodies *b = &cs->bodies;
+
+  for (int i = 0; i < cs->body_count; i++) {
+    unsigned char flags = b->flags[i];
+    if (!(flags & (BODY_LOADED | BODY_WOKEN))) continue;
+    b->flags[i] = flags & ~(BODY_LOADED | BODY_WOKEN);
+
+    if (flags & BODY_LOADED) {
+      PositionComponent *p = cs->positions[i];
+      if (p && (p->position.x != b->px[i] || p->position.y != b->py[i] || p->position.z != b->pz[i])) {
+        p->position = rigid_body_position(b, i);
+        world_mark_transform_dirty(world, b->ids[i]);
+      }
+      if (cs->velocities[i]) cs->velocities[i]->velocity = rigid_body_velocity(b, i);
+    }
+
+    MassComponent *mc = cs->masses[i];
+    if (!mc) continue;
+    mc->grounded_entity = b->grounded[i];
+    mc->sleeping        = (flags & BODY_SLEEPING) != 0;
+    mc->sleep_time      = b->sleep_time[i];
+    mc->rest_position   = (Vec3f){ b->rx[i], b->ry[i], b->rz[i] };
+    mc->island          = b->island[i];
+    mc->island_size     = b->island_size[i];
+  }
+}
+
+static void push_hit(CollisionState *cs, int row) {
+  if (cs->hit_count == cs->hit_capacity) {
+    cs->hit_capacity = cs->hit_capacity ? cs->hit_capacity * 2 : 256;
+    cs->hits = realloc(cs->hits, cs->hit_capacity * sizeof(int));
+  }
+  cs->hits[cs->hit_count++] = row;
+}
+
+// Mesh colliders are left to resolve_meshes(); their bounds are not a box
+// to be pushed out of.
+static int collect_static(void *ctx, int entity) {
+  CollisionState *cs = ctx;
+  int row = cs->row_of_slot[entity_index(entity)];
+  if (cs->bodies.mesh[row] < 0) push_hit(cs, row);
+  return 1;
+}
+
+// Static candidates (as rows) of every dynamic moving body, in CSR form by
+// moving index. A body whose bounds are bit-for-bit those of its last query
+// (anything at rest) reuses last tick's hits instead of walking the BVH.
+static void find_static_hits(World *world) {
+  CollisionState *cs = &collision;
+  StaticBvh *bvh = &world->static_colliders.bvh;
+
+  int *t = cs->last_hit_start;
+  cs->last_hit_start = cs->hit_start;
+  cs->hit_start = t;
+  t = cs->last_hits;
+  cs->last_hits = cs->hits;
+  cs->hits = t;
+  int capacity = cs->last_hit_capacity;
+  cs->last_hit_capacity = cs->hit_capacity;
+  cs->hit_capacity = capacity;
+
+  cs->hit_count = 0;
+  for (int k = 0; k < cs->moving_count; k++) {
+    cs->hit_start[k] = cs->hit_count;
+    if (!resolves(cs, k)) continue;
+
+    if (cs->hits_valid && memcmp(&cs->hit_bounds[k], &cs->moving_bounds[k], sizeof(Aabb)) == 0) {
+      for (int h = cs->last_hit_start[k]; h < cs->last_hit_start[k + 1]; h++) push_hit(cs, cs->last_hits[h]);
     } else {
-      vc->velocity = velocity;
+      cs->hit_bounds[k] = cs->moving_bounds[k];
+      static_bvh_query(bvh, &cs->moving_bounds[k], collect_static, cs);
     }
   }
+  cs->hit_start[cs->moving_count] = cs->hit_count;
+  cs->hits_valid = 1;
+}
+
+// SLEEPING
+
+static void wake_body(RigidBodies *b, int i) {
+  b->flags[i]      = (b->flags[i] & ~BODY_SLEEPING) | BODY_WOKEN;
+  b->sleep_time[i] = 0.0f;
+}
+
+// Awake bodies with mass and a dynamic collider are the ones that can
+// fall asleep.
+static int sleeper(const CollisionState *cs, int k) {
+  return !cs->moving_static[k] && (cs->bodies.flags[k] & (BODY_MASS | BODY_STATIC)) == BODY_MASS;
+}
+
+// Whether moving body k moved this tick: a body with mass that is not at
+// rest, or anything else with a non-zero velocity.
+static int is_moving(const CollisionState *cs, int k) {
+  const RigidBodies *b = &cs->bodies;
+  if (b->flags[k] & BODY_MASS) return b->sleep_time[k] == 0.0f;
+  return b->vx[k] != 0.0f || b->vy[k] != 0.0f || b->vz[k] != 0.0f;
 }
 
-static void apply_velocities(World *world, float dt) {
-  VelocityComponent *v, *tmp1;
-  HASH_ITER(hh, world->velocities, v, tmp1) {
-    PositionComponent *pc = world_get_position(world, v->entity);
-    if (!pc) continue;
+// Wakes every island that has lost a sleeping member since it fell asleep
+// (the member was woken, destroyed or lost its collider), then brings
+// `moving_static` in line with the sleep flags. Only runs after something
+// may have changed, so a settled scene never pays for it.
+static void propagate_wakes(World *world) {
+  CollisionState *cs = &collision;
+  RigidBodies *b = &cs->bodies;
+  const unsigned char member = BODY_SLEEPING | BODY_COLLIDER;
+  cs->islands_dirty = 0;
+
+  if (world->slot_count > cs->tally_capacity) {
+    cs->tally_capacity = world->slot_count;
+    cs->island_tally = realloc(cs->island_tally, cs->tally_capacity * sizeof(int));
+  }
+  memset(cs->island_tally, 0, world->slot_count * sizeof(int));
 
-    Vec3f distance = vec3f_scale(v->velocity, dt);
+  // Only rows with mass sleep, and every one of them is below body_count.
+  for (int i = 0; i < cs->body_count; i++) {
+    if ((b->flags[i] & member) == member) cs->island_tally[entity_index(b->island[i])]++;
+  }
+  for (int i = 0; i < cs->body_count; i++) {
+    if (!(b->flags[i] & BODY_SLEEPING)) continue;
+    if (cs->wake_all || !sleeping_enabled || !(b->flags[i] & BODY_COLLIDER) ||
+        cs->island_tally[entity_index(b->island[i])] != b->island_size[i]) {
+      wake_body(b, i);
+    }
+  }
+  cs->wake_all = 0;
 
-    pc->position = vec3f_add(pc->position, distance);
+  int changed = 0, woke = 0;
+  for (int k = 0; k < cs->moving_count; k++) {
+    unsigned char asleep = (b->flags[k] & BODY_SLEEPING) != 0;
+    if (asleep == cs->moving_static[k]) continue;
+    cs->moving_static[k] = asleep;
+    changed = 1;
+    woke |= !asleep;
   }
+  // Sleeping bodies are statics to the broadphase, and a woken body has
+  // no static hits from its last query.
+  if (changed) cs->layout_version++;
+  if (woke) cs->hits_valid = 0;
 }
 
-static void update_player(World *world) {
-  PositionComponent *player_pos = world_get_position(world, world->player.entity);
-  if (player_pos) world->camera.pos = player_pos->position;
+static int island_find(int *parent, int k) {
+  while (parent[k] != k) {
+    parent[k] = parent[parent[k]];
+    k = parent[k];
+  }
+  return k;
+}
+
+static void island_union(CollisionState *cs, int a, int b) {
+  a = island_find(cs->island_parent, a);
+  b = island_find(cs->island_parent, b);
+  if (a == b) return;
+  if (b < a) {
+    int t = a;
+    a = b;
+    b = t;
+  }
+  cs->island_parent[b] = a;
+  cs->island_size[a] += cs->island_size[b];
+  if (cs->island_time[b] < cs->island_time[a]) cs->island_time[a] = cs->island_time[b];
+}
+
+// NARROWPHASE
+
+// Gathers the partners in slots [m, end) of the partner lists, up to a
+// block's worth.
+static void gather_partners(const CollisionState *cs, PartnerBlock *pb, int m, int end) {
+  const RigidBodies *b = &cs->bodies;
+  int n = end - m < NARROWPHASE_BLOCK ? end - m : NARROWPHASE_BLOCK;
+  for (int i = 0; i < n; i++) {
+    int row = cs->partners[m + i];
+    pb->px[i] = b->px[row];
+    pb->py[i] = b->py[row];
+    pb->pz[i] = b->pz[row];
+    pb->hx[i] = b->hx[row];
+    pb->hy[i] = b->hy[row];
+    pb->hz[i] = b->hz[row];
+  }
+  pb->first = m;
+  pb->batch = (NarrowphaseBatch){ pb->px, pb->py, pb->pz, pb->hx, pb->hy, pb->hz, n };
 }
 
-static int aabb_overlap(Vec3f pos_a, Vec3f half_a, Vec3f pos_b, Vec3f half_b) {
-  return fabsf(pos_a.x - pos_b.x) < half_a.x + half_b.x &&
-         fabsf(pos_a.y - pos_b.y) < half_a.y + half_b.y &&
-         fabsf(pos_a.z - pos_b.z) < half_a.z + half_b.z;
+// The first slot in [m, end) whose partner overlaps the body at `row`, or
+// end. Runs shorter than NARROWPHASE_MIN_BATCH are tested pair by pair, as
+// a call into the batched kernel costs more than they do; longer ones are
+// gathered into `pb` a block at a time and kept while m stays inside it.
+// Only the body moves between calls, so a gathered block stays current.
+static int next_contact(const CollisionState *cs, PartnerBlock *pb, int row, int m, int end,
+                        int *axis, float *push) {
+  const RigidBodies *b = &cs->bodies;
+  Vec3f position = rigid_body_position(b, row), half_extents = rigid_body_half_extents(b, row);
+  while (m < end) {
+    if (m < pb->first || m >= pb->first + pb->batch.count) {
+      if (end - m < NARROWPHASE_MIN_BATCH) break;
+      gather_partners(cs, pb, m, end);
+    }
+    int i = narrowphase_next(&pb->batch, m - pb->first, position, half_extents, axis, push);
+    if (i < pb->batch.count) return pb->first + i;
+    m = pb->first + pb->batch.count;
+  }
+  for (; m < end; m++) {
+    int other = cs->partners[m];
+    if (narrowphase_pair(position, half_extents, rigid_body_position(b, other), rigid_body_half_extents(b, other),
+                         axis, push)) {
+      return m;
+    }
+  }
+  return end;
 }
 
-static void resolve_collisions(World *world) {
-  ColliderComponent *a, *tmp1;
-  HASH_ITER(hh, world->colliders, a, tmp1) {
-    if (a->is_static) continue;
+// The contact pushing the body at `row` out of its partner in `slot`.
+static Contact slot_contact(const CollisionState *cs, int row, int slot, int axis, float push) {
+  Contact c = {
+    .slot   = slot,
+    .a      = cs->bodies.ids[row],
+    .b      = cs->bodies.ids[cs->partners[slot]],
+    .normal = vec3f_identity(),
+    .depth  = fabsf(push),
+  };
+  float sign = push < 0.0f ? -1.0f : 1.0f;
+  if (axis == 0)      c.normal.x = sign;
+  else if (axis == 1) c.normal.y = sign;
+  else                c.normal.z = sign;
+  return c;
+}
 
-    PositionComponent *ap = world_get_position(world, a->entity);
-    if (!ap) continue;
+// Moves the body at `row` by the contact. A push along y leaves it
+// standing on the other body.
+static void apply_contact(CollisionState *cs, int row, const Contact *c) {
+  RigidBodies *b = &cs->bodies;
+  if (c->normal.x != 0.0f) {
+    b->px[row] += c->normal.x * c->depth;
+  } else if (c->normal.y != 0.0f) {
+    b->py[row] += c->normal.y * c->depth;
+    if (b->flags[row] & BODY_MASS) b->grounded[row] = c->b;
+  } else {
+    b->pz[row] += c->normal.z * c->depth;
+  }
+}
 
-    ColliderComponent *b, *tmp2;
-    HASH_ITER(hh, world->colliders, b, tmp2) {
-      if (a->entity == b->entity) continue;
+static void push_contact(ContactBuffer *buf, const Contact *c) {
+  if (buf->count == buf->capacity) {
+    buf->capacity = buf->capacity ? buf->capacity * 2 : 256;
+    buf->items = realloc(buf->items, buf->capacity * sizeof(Contact));
+  }
+  buf->items[buf->count++] = *c;
+}
+
+static void narrowphase_range(void *ctx, int begin, int end) {
+  CollisionState *cs = ctx;
+  int thread = job_thread_index();
+  ContactBuffer *buf = &cs->thread_contacts[thread];
+  PartnerBlock pb;
+
+  for (int n = begin; n < end; n++) {
+    NarrowChunk *chunk = &cs->chunks[n];
+    chunk->thread = thread;
+    chunk->start  = buf->count;
+
+    int last = (n + 1) * NARROWPHASE_CHUNK < cs->moving_count ? (n + 1) * NARROWPHASE_CHUNK : cs->moving_count;
+    // Only bodies that resolve have partners.
+    for (int k = n * NARROWPHASE_CHUNK; k < last; k++) {
+      if (cs->partner_start[k] == cs->partner_start[k + 1]) continue;
+      int end = cs->partner_start[k + 1];
+      int axis;
+      float push;
 
-      PositionComponent *bp = world_get_position(world, b->entity);
-      if (!bp) continue;
+      pb.first = pb.batch.count = 0;
+      for (int m = next_contact(cs, &pb, k, cs->partner_start[k], end, &axis, &push); m < end;
+           m = next_contact(cs, &pb, k, m + 1, end, &axis, &push)) {
+        Contact c = slot_contact(cs, k, m, axis, push);
+        c.body = k;
+        push_contact(buf, &c);
+      }
+    }
+    chunk->count = buf->count - chunk->start;
+  }
+}
 
-      if (!aabb_overlap(ap->position, a->half_extents, bp->position, b->half_extents))
+// Tests every candidate pair against the positions at the start of the
+// pass, in parallel, with each thread writing its own buffer. Chunks are
+// fixed slices of `moving`, so walking them in chunk order gives the
+// contacts sorted by slot however the chunks were spread over threads.
+// With a single thread there is nothing to overlap the tests with, so it
+// returns 0 and the resolution pass makes the same decisions on its own.
+static int find_contacts(void) {
+  TRACE_FN();
+  CollisionState *cs = &collision;
+  if (job_thread_count() == 1) return 0;
+
+  int chunks = (cs->moving_count + NARROWPHASE_CHUNK - 1) / NARROWPHASE_CHUNK;
+  if (chunks > cs->chunk_capacity) {
+    cs->chunk_capacity = chunks;
+    cs->chunks = realloc(cs->chunks, chunks * sizeof(NarrowChunk));
+  }
+  for (int t = 0; t < MAX_JOB_THREADS; t++) cs->thread_contacts[t].count = 0;
+
+  job_parallel_for(0, chunks, 1, narrowphase_range, cs);
+  return 1;
+}
+
+// Merges the contact records in slot order and applies them. Only the
+// body being resolved moves, so a record is exact while neither the body
+// nor its partner has moved yet this pass, and is applied as it stands.
+// A pair is tested again only once one of its bodies has moved: every
+// partner that moved earlier in the pass, and, after the body's own first
+// push, the partners it had records for. A pair that was apart at the
+// start of the pass and whose partner has not moved is not tested again;
+// a push that closes such a gap is resolved on the next tick.
+//
+// Without `found` records the same decisions are made in this pass: a
+// pair has a record exactly when it overlaps at the body's start position,
+// so the results match at any thread count.
+static void resolve_contacts(int found) {
+  TRACE_FN();
+  CollisionState *cs = &collision;
+  RigidBodies *b = &cs->bodies;
+  memset(cs->moved, 0, b->count);
+
+  const Contact *next = NULL, *end = NULL;
+  for (int k = 0; k < cs->moving_count; k++) {
+    if (found && k % NARROWPHASE_CHUNK == 0) {
+      NarrowChunk *chunk = &cs->chunks[k / NARROWPHASE_CHUNK];
+      next = cs->thread_contacts[chunk->thread].items + chunk->start;
+      end  = next + chunk->count;
+    }
+
+    Vec3f start = rigid_body_position(b, k), half_extents = rigid_body_half_extents(b, k);
+    int pushed = 0, last = cs->partner_start[k + 1];
+    for (int m = cs->partner_start[k]; m < last; m++) {
+      int axis;
+      float push;
+      if (!found && !pushed) {
+        // Until its first push the body is where it started, so a live
+        // test is also the record test: scan for it a block at a time.
+        PartnerBlock pb;
+        pb.first = pb.batch.count = 0;
+        m = next_contact(cs, &pb, k, m, last, &axis, &push);
+        if (m == last) break;
+        Contact c = slot_contact(cs, k, m, axis, push);
+        apply_contact(cs, k, &c);
+        pushed = 1;
         continue;
+      }
+
+      int other = cs->partners[m];
+      Vec3f position = rigid_body_position(b, other), other_half = rigid_body_half_extents(b, other);
+      if (found) {
+        const Contact *record = next < end && next->slot == m ? next++ : NULL;
+        if (!cs->moved[other] && (!pushed || !record)) {
+          if (record) {
+            apply_contact(cs, k, record);
+            pushed = 1;
+          }
+          continue;
+        }
+      } else if (!cs->moved[other] &&
+                 !narrowphase_pair(start, half_extents, position, other_half, &axis, &push)) {
+        continue;
+      }
 
-      float dx = (a->half_extents.x + b->half_extents.x) - fabsf(ap->position.x - bp->position.x);
-      float dy = (a->half_extents.y + b->half_extents.y) - fabsf(ap->position.y - bp->position.y);
-      float dz = (a->half_extents.z + b->half_extents.z) - fabsf(ap->position.z - bp->position.z);
-
-      if (dx < dy && dx < dz) {
-        ap->position.x += ap->position.x < bp->position.x ? -dx : dx;
-      } else if (dy < dx && dy < dz) {
-        ap->position.y += ap->position.y < bp->position.y ? -dy : dy;
-        MassComponent *mc = world_get_mass(world, a->entity);
-        if (mc) mc->grounded_entity = b->entity;
-      } else {
-        ap->position.z += ap->position.z < bp->position.z ? -dz : dz;
+      if (narrowphase_pair(rigid_body_position(b, k), half_extents, position, other_half, &axis, &push)) {
+        Contact c = slot_contact(cs, k, m, axis, push);
+        apply_contact(cs, k, &c);
+        pushed = 1;
       }
     }
+    if (pushed) cs->moved[k] = 1;
+  }
+}
+
+// MESH COLLIDERS
+
+// Removes the part of v going into a face. Components the normal does not
+// have are left exactly as they are, so an axis normal only zeroes its axis.
+static void remove_normal(Vec3f *v, Vec3f normal) {
+  float d = v->x * normal.x + v->y * normal.y + v->z * normal.z;
+  if (normal.x != 0.0f) v->x -= normal.x * d;
+  if (normal.y != 0.0f) v->y -= normal.y * d;
+  if (normal.z != 0.0f) v->z -= normal.z * d;
+}
+
+static int collect_mesh(void *ctx, int entity) {
+  CollisionState *cs = ctx;
+  int row = cs->row_of_slot[entity_index(entity)];
+  if (cs->bodies.mesh[row] < 0) return 1;
+  if (cs->mesh_hit_count == cs->mesh_hit_capacity) {
+    cs->mesh_hit_capacity = cs->mesh_hit_capacity ? cs->mesh_hit_capacity * 2 : 16;
+    cs->mesh_hits = realloc(cs->mesh_hits, cs->mesh_hit_capacity * sizeof(int));
+  }
+  cs->mesh_hits[cs->mesh_hit_count++] = row;
+  return 1;
+}
+
+static int collect_triangle(void *ctx, int triangle) {
+  CollisionState *cs = ctx;
+  if (cs->triangle_count == cs->triangle_capacity) {
+    cs->triangle_capacity = cs->triangle_capacity ? cs->triangle_capacity * 2 : 64;
+    cs->triangles = realloc(cs->triangles, cs->triangle_capacity * sizeof(int));
+  }
+  cs->triangles[cs->triangle_count++] = triangle;
+  return 1;
+}
+
+// Pushes body k out of the triangles of every mesh collider its bounds
+// reach, one triangle at a time with live positions, in BVH order. Unlike
+// box contacts, which only ever push along an axis that gravity is then
+// switched off for, a push along a slope also takes away the velocity going
+// into the face; otherwise a body on a steep slope would sink a little
+// further every tick. A push that is mostly upward leaves it standing on
+// the mesh.
+static void resolve_mesh_body(World *world, CollisionState *cs, int k) {
+  RigidBodies *b = &cs->bodies;
+  Vec3f half_extents = rigid_body_half_extents(b, k);
+  Aabb bounds = rigid_body_bounds(b, k, COLLISION_MARGIN);
+
+  cs->mesh_hit_count = 0;
+  static_bvh_query(&world->static_colliders.bvh, &bounds, collect_mesh, cs);
+
+  for (int h = 0; h < cs->mesh_hit_count; h++) {
+    int row = cs->mesh_hits[h];
+    const MeshBvh *mesh = &world->collider_meshes.items[b->mesh[row]];
+    Vec3f origin = rigid_body_position(b, row);
+    Vec3f center = vec3f_sub(rigid_body_position(b, k), origin);
+    Aabb local = { vec3f_sub(center, half_extents), vec3f_add(center, half_extents) };
+
+    cs->triangle_count = 0;
+    mesh_bvh_query(mesh, &local, collect_triangle, cs);
+    for (int t = 0; t < cs->triangle_count; t++) {
+      Vec3f normal;
+      float depth;
+      if (!box_triangle_penetration(center, half_extents, mesh_bvh_triangle(mesh, cs->triangles[t]),
+                                    &normal, &depth)) {
+        continue;
+      }
+      center = vec3f_add(center, vec3f_scale(normal, depth));
+      rigid_body_set_position(b, k, vec3f_add(center, origin));
+      Vec3f velocity = rigid_body_velocity(b, k);
+      if ((b->flags[k] & BODY_VELOCITY) && vec3f_dot(velocity, normal) < 0.0f) {
+        remove_normal(&velocity, normal);
+        rigid_body_set_velocity(b, k, velocity);
+      }
+      if ((b->flags[k] & BODY_MASS) && normal.y > fabsf(normal.x) && normal.y > fabsf(normal.z)) {
+        b->grounded[k] = b->ids[row];
+      }
+    }
+  }
+}
+
+// Runs after the box contacts, so a body pushed into a mesh by another
+// body this tick still ends up on top of it.
+static void resolve_meshes(World *world) {
+  TRACE_FN();
+  CollisionState *cs = &collision;
+  for (int k = 0; k < cs->moving_count; k++) {
+    if (resolves(cs, k)) resolve_mesh_body(world, cs, k);
+  }
+}
+
+// The broadphase finds candidates among moving bodies, and every dynamic
+// body queries the baked static BVH, both from bounds padded by
+// COLLISION_MARGIN. The narrowphase turns candidates into contact records
+// in parallel, then a serial pass applies them in query order, testing a
+// pair again only when one of its bodies has already been pushed. Static
+// level geometry costs nothing per tick beyond the queries. Mesh colliders
+// are resolved against their triangles in a serial pass after that.
+static void resolve_collisions(World *world, SystemContext *ctx) {
+  (void)ctx;
+  CollisionState *cs = &collision;
+  RigidBodies *b = &cs->bodies;
+  if (cs->islands_dirty) propagate_wakes(world);
+
+  // Sleeping bodies do not move, so their bounds from the last tick still
+  // hold unless the layout was just refreshed.
+  for (int k = 0; k < cs->moving_count; k++) {
+    if (cs->moving_static[k] && cs->hits_valid) continue;
+    cs->moving_bounds[k] = rigid_body_bounds(b, k, COLLISION_MARGIN);
+  }
+
+  BroadphaseInput input = {
+    .bounds         = cs->moving_bounds,
+    .is_static      = cs->moving_static,
+    .ids            = b->ids,
+    .count          = cs->moving_count,
+    .layout_version = cs->layout_version,
+  };
+  broadphase_find_pairs(&cs->broadphase, &input, &cs->pairs);
+
+  find_static_hits(world);
+
+  grow_collision_state(0, cs->pairs.count * 2 + cs->hit_count);
+  build_partner_lists();
+
+  resolve_contacts(find_contacts());
+  if (world->collider_meshes.count > 0) resolve_meshes(world);
+}
+
+// Resting is judged by how far a body moved, not by its velocity: a body
+// resting on another keeps the vertical speed gravity gave it, since
+// separating only corrects its position. Bodies linked by overlapping
+// bounds form an island that falls asleep once all of them have rested for
+// SLEEP_TIME; a body that moves into a sleeping one wakes it, and with it
+// its island on the next pass.
+static void update_sleep(World *world, SystemContext *ctx) {
+  CollisionState *cs = &collision;
+  RigidBodies *b = &cs->bodies;
+  if (!sleeping_enabled) return;
+
+  for (int k = 0; k < cs->moving_count; k++) {
+    cs->island_parent[k] = k;
+    if (!sleeper(cs, k)) continue;
+
+    Vec3f p = rigid_body_position(b, k);
+    Vec3f d = vec3f_sub(p, (Vec3f){ b->rx[k], b->ry[k], b->rz[k] });
+    if (vec3f_dot(d, d) > SLEEP_DISTANCE * SLEEP_DISTANCE) {
+      b->sleep_time[k] = 0.0f;
+      b->rx[k] = p.x;
+      b->ry[k] = p.y;
+      b->rz[k] = p.z;
+    } else {
+      b->sleep_time[k] += ctx->dt;
+    }
+    cs->island_size[k] = 1;
+    cs->island_time[k] = b->sleep_time[k];
   }
+
+  int woke = 0;
+  for (int p = 0; p < cs->pairs.count; p++) {
+    BodyPair pair = cs->pairs.pairs[p];
+    if (!aabb_overlaps(&cs->moving_bounds[pair.a], &cs->moving_bounds[pair.b])) continue;
+
+    if (!cs->moving_static[pair.a] && !cs->moving_static[pair.b]) {
+      if (sleeper(cs, pair.a) && sleeper(cs, pair.b)) island_union(cs, pair.a, pair.b);
+      continue;
+    }
+    int asleep = cs->moving_static[pair.a] ? pair.a : pair.b;
+    int other  = asleep == pair.a ? pair.b : pair.a;
+    if ((b->flags[asleep] & BODY_SLEEPING) && is_moving(cs, other)) {
+      wake_body(b, asleep);
+      woke = 1;
+    }
+  }
+
+  int slept = 0;
+  for (int k = 0; k < cs->moving_count; k++) {
+    if (!sleeper(cs, k)) continue;
+    int root = island_find(cs->island_parent, k);
+    if (cs->island_time[root] < SLEEP_TIME) continue;
+
+    rigid_body_set_velocity(b, k, vec3f_identity());
+    cs->moving_bounds[k] = rigid_body_bounds(b, k, COLLISION_MARGIN);
+    b->flags[k]      |= BODY_SLEEPING;
+    b->island[k]      = b->ids[root];
+    b->island_size[k] = cs->island_size[root];
+    slept = 1;
+  }
+
+  if (woke || slept) propagate_wakes(world);
 }
 
 static void apply_acceleration(World *world, Entity e, Vec3f dir, float accelleration, float dt) {
@@ -145,49 +1094,195 @@ static void apply_acceleration(World *world, Entity e, Vec3f dir, float acceller
   }
 }
 
-static void apply_friction(World *world, MassComponent *mc, float dt) {
-  VelocityComponent *vc = world_get_velocity(world, mc->entity);
-  if (!vc) return;
+// CONTINUOUS COLLISION
 
-  ColliderComponent *ca = world_get_collider(world, mc->entity);
-  ColliderComponent *cb = world_get_collider(world, mc->entity);
+// Impacts handled per body per tick; whatever step is left after the last
+// one is dropped.
+#define SWEEP_ITERATIONS 3
 
-  float friction_a = ca ? ca->friction : 0.8f;
-  float friction_b = cb ? cb->friction : 0.8f;
-  float friction   = friction_a * friction_b;
+typedef struct {
+  World   *world;
+  Vec3f   position;
+  Vec3f   half_extents;
+  Vec3f   delta;
+  float   toi;
+  Vec3f   normal;
+  int     hit;
+} StaticSweep;
 
-  float threshold = friction * 0.1f;
+static int sweep_static(void *ctx, int entity) {
+  StaticSweep       *s = ctx;
+  const RigidBodies *b = &collision.bodies;
+  int row = collision.row_of_slot[entity_index(entity)];
+  Vec3f position = rigid_body_position(b, row);
+  float toi;
+  Vec3f normal = vec3f_identity();
+  int hit;
+  if (b->mesh[row] >= 0) {
+    hit = mesh_bvh_sweep(&s->world->collider_meshes.items[b->mesh[row]], vec3f_sub(s->position, position),
+                         s->half_extents, s->delta, &toi, &normal);
+  } else {
+    int axis;
+    hit = narrowphase_sweep(s->position, s->half_extents, s->delta, position, rigid_body_half_extents(b, row),
+                            &toi, &axis);
+    if (hit) {
+      float d = axis == 0 ? s->delta.x : axis == 1 ? s->delta.y : s->delta.z;
+      float side = d > 0.0f ? -1.0f : 1.0f;
+      if (axis == 0)      normal.x = side;
+      else if (axis == 1) normal.y = side;
+      else                normal.z = side;
+    }
+  }
+  if (hit && toi < s->toi) {
+    s->toi    = toi;
+    s->normal = normal;
+    s->hit    = 1;
+  }
+  return 1;
+}
+
+// A step no longer than the body's half extent on every axis cannot carry
+// it through anything it would not end up overlapping, so only longer ones
+// are swept.
+static int needs_sweep(Vec3f half_extents, Vec3f delta) {
+  return fabsf(delta.x) > half_extents.x || fabsf(delta.y) > half_extents.y || fabsf(delta.z) > half_extents.z;
+}
 
-  float decel = friction * dt;
-  vc->velocity.x *= fmaxf(0.0f, 1.0f - decel);
-  vc->velocity.z *= fmaxf(0.0f, 1.0f - decel);
+// Conservative advancement against the baked statics: the body moves to its
+// first impact along the step, loses its velocity into the face it hit and
+// slides along that face with the rest of the step. Returns where it ends up.
+static Vec3f sweep_body(World *world, Vec3f half_extents, Vec3f from, Vec3f delta, Vec3f *velocity) {
+  for (int n = 0; n < SWEEP_ITERATIONS; n++) {
+    Vec3f to = vec3f_add(from, delta);
+    Aabb swept = {
+      { fminf(from.x, to.x), fminf(from.y, to.y), fminf(from.z, to.z) },
+      { fmaxf(from.x, to.x), fmaxf(from.y, to.y), fmaxf(from.z, to.z) }
+    };
+    swept.min = vec3f_sub(swept.min, half_extents);
+    swept.max = vec3f_add(swept.max, half_extents);
 
-  if (fabsf(vc->velocity.x) < threshold) vc->velocity.x = 0;
-  if (fabsf(vc->velocity.y) < threshold) vc->velocity.y = 0;
+    StaticSweep s = { world, from, half_extents, delta, INFINITY, vec3f_identity(), 0 };
+    static_bvh_query(&world->static_colliders.bvh, &swept, sweep_static, &s);
+    if (!s.hit) return to;
+
+    from  = vec3f_add(from, vec3f_scale(delta, s.toi));
+    delta = vec3f_scale(delta, 1.0f - s.toi);
+    remove_normal(&delta, s.normal);
+    remove_normal(velocity, s.normal);
+  }
+  return from;
 }
 
-static void apply_gravity_and_friction(World *world, float dt) {
-  MassComponent *mc, *tmp1;
-  HASH_ITER(hh, world->masses, mc, tmp1) {
-    if (mc->grounded_entity == -1) {
-      apply_acceleration(world, mc->entity, DOWN, GRAVITY, dt);
-    } else {
-      mc->grounded_entity = -1;
-      apply_friction(world, mc, dt);
+typedef struct {
+  World *world;
+  float dt;
+  int   sweeping;
+} IntegrateJob;
+
+// Rows with a velocity that were awake when copied in.
+static int integrates(const RigidBodies *b, int i) {
+  return (b->flags[i] & (BODY_VELOCITY | BODY_SLEEPING)) == BODY_VELOCITY;
+}
+
+// Runs integrate_batch() in place over the store a block of rows at a
+// time. Rows that do not integrate ride along with neutral parameters and
+// are put back afterwards, so the kernel never needs a gather; a block
+// with none that do is skipped.
+static void integrate_range(void *ctx, int begin, int end) {
+  IntegrateJob   *job = ctx;
+  CollisionState *cs  = &collision;
+  RigidBodies    *b   = &cs->bodies;
+  float dt = job->dt;
+
+  float gravity_scale[INTEGRATE_BLOCK], damping[INTEGRATE_BLOCK], threshold[INTEGRATE_BLOCK];
+  float px[INTEGRATE_BLOCK], py[INTEGRATE_BLOCK], pz[INTEGRATE_BLOCK];
+  float vx[INTEGRATE_BLOCK], vy[INTEGRATE_BLOCK], vz[INTEGRATE_BLOCK];
+
+  for (int first = begin; first < end; first += INTEGRATE_BLOCK) {
+    int n = end - first < INTEGRATE_BLOCK ? end - first : INTEGRATE_BLOCK;
+    int held = 0;
+    for (int i = 0; i < n; i++) {
+      int row = first + i;
+      gravity_scale[i] = 0.0f;
+      damping[i]       = 1.0f;
+      threshold[i]     = 0.0f;
+      if (!integrates(b, row)) {
+        held++;
+        continue;
+      }
+      if (!(b->flags[row] & BODY_MASS)) continue;
+
+      if (b->grounded[row] == ENTITY_NONE) {
+        gravity_scale[i] = 1.0f;
+        continue;
+      }
+      b->grounded[row] = ENTITY_NONE;
+      // Contact friction has always paired the body's collider with itself.
+      float friction = b->friction[row] * b->friction[row];
+      damping[i]   = fmaxf(0.0f, 1.0f - friction * dt);
+      threshold[i] = friction * 0.1f;
+    }
+    if (held == n) continue;
+
+    memcpy(px, b->px + first, n * sizeof(float));
+    memcpy(py, b->py + first, n * sizeof(float));
+    memcpy(pz, b->pz + first, n * sizeof(float));
+    if (held) {
+      memcpy(vx, b->vx + first, n * sizeof(float));
+      memcpy(vy, b->vy + first, n * sizeof(float));
+      memcpy(vz, b->vz + first, n * sizeof(float));
+    }
+
+    IntegrateBatch batch = {
+      b->px + first, b->py + first, b->pz + first, b->vx + first, b->vy + first, b->vz + first,
+      gravity_scale, damping, threshold, n
+    };
+    integrate_batch(&batch, GRAVITY, dt);
+
+    for (int i = 0; i < n; i++) {
+      int row = first + i;
+      if (!integrates(b, row)) {
+        rigid_body_set_position(b, row, (Vec3f){ px[i], py[i], pz[i] });
+        rigid_body_set_velocity(b, row, (Vec3f){ vx[i], vy[i], vz[i] });
+        continue;
+      }
+      if (!job->sweeping || row >= cs->moving_count || (b->flags[row] & BODY_STATIC)) continue;
+
+      Vec3f from  = { px[i], py[i], pz[i] };
+      Vec3f delta = vec3f_sub(rigid_body_position(b, row), from);
+      Vec3f half_extents = rigid_body_half_extents(b, row);
+      if (!needs_sweep(half_extents, delta)) continue;
+      Vec3f velocity = rigid_body_velocity(b, row);
+      rigid_body_set_position(b, row, sweep_body(job->world, half_extents, from, delta, &velocity));
+      rigid_body_set_velocity(b, row, velocity);
     }
   }
 }
 
+// Gravity, friction and position integration fused into one pass over the
+// store, so integrate_batch() runs 4/8 bodies wide straight out of it:
+// airborne bodies get gravity_scale 1, grounded ones a damping factor and
+// snap threshold, and bodies without mass pass through both untouched.
+// Dynamic colliders stepping further than their half extent are then swept
+// against the baked statics so they cannot tunnel through them at large
+// timesteps. Sleeping bodies are skipped.
+static void integrate_bodies(World *world, SystemContext *ctx) {
+  IntegrateJob job = { world, ctx->dt, world->static_colliders.bvh.count > 0 };
+  job_parallel_for(0, collision.body_count, INTEGRATE_BLOCK, integrate_range, &job);
+}
+
 void apply_thrust(World *world, Entity e, Vec3f dir, float dt) {
   LocomotionComponent *lc = world_get_locomotion(world, e);
   if (!lc) return;
+  systems_wake(world, e);
   apply_acceleration(world, e, dir, lc->thrust, dt);
 }
 
 void jump(World *world, Entity e) {
   MassComponent *mc = world_get_mass(world, e);
   JumpComponent *jc = world_get_jump(world, e);
-  if (!jc || !mc || mc->grounded_entity == -1) return;
+  if (!jc || !mc || mc->grounded_entity == ENTITY_NONE) return;
+  systems_wake(world, e);
   VelocityComponent *vc = world_get_velocity(world, e);
   if (vc) {
     vc->velocity.y += jc->jump_force;
@@ -196,10 +1291,155 @@ void jump(World *world, Entity e) {
   }
 }
 
+// Registration order is the serial order; the scheduler only runs systems
+// side by side when their declared access sets do not conflict. Systems
+// never add or remove components while iterating: structural changes go
+// through the per-task command buffer and are applied after the tick.
+void systems_init(int deterministic) {
+  if (systems_ready) systems_shutdown();
+  scheduler_init(&scheduler, deterministic);
+  memset(&collision, 0, sizeof(CollisionState));
+  broadphase_init(&collision.broadphase, broadphase_type);
+  pair_list_init(&collision.pairs);
+  rigid_bodies_init(&collision.bodies);
+
+  scheduler_add(&scheduler, (SystemDesc){
+    .name     = "apply_paths",
+    .run      = apply_paths,
+    .reads    = COMPONENT_BIT(COMPONENT_SPEED) | COMPONENT_BIT(COMPONENT_POSITION),
+    .writes   = COMPONENT_BIT(COMPONENT_PATH) | COMPONENT_BIT(COMPONENT_VELOCITY),
+    .iterate  = PATH_QUERY,
+  });
+  // The physics step: only load_bodies and store_bodies touch components,
+  // everything between them works on the rigid-body store.
+  scheduler_add(&scheduler, (SystemDesc){
+    .name     = "load_bodies",
+    .run      = load_bodies,
+    .reads    = COMPONENT_BIT(COMPONENT_COLLIDER) | COMPONENT_BIT(COMPONENT_POSITION) |
+                COMPONENT_BIT(COMPONENT_VELOCITY) | COMPONENT_BIT(COMPONENT_MASS),
+    .writes   = ACCESS_BODIES,
+  });
+  scheduler_add(&scheduler, (SystemDesc){
+    .name     = "integrate_bodies",
+    .run      = integrate_bodies,
+    .writes   = ACCESS_BODIES,
+  });
+  scheduler_add(&scheduler, (SystemDesc){
+    .name     = "resolve_collisions",
+    .run      = resolve_collisions,
+    .writes   = ACCESS_BODIES,
+  });
+  scheduler_add(&scheduler, (SystemDesc){
+    .name     = "update_sleep",
+    .run      = update_sleep,
+    .writes   = ACCESS_BODIES,
+  });
+  scheduler_add(&scheduler, (SystemDesc){
+    .name     = "store_bodies",
+    .run      = store_bodies,
+    .reads    = ACCESS_BODIES,
+    .writes   = COMPONENT_BIT(COMPONENT_POSITION) | COMPONENT_BIT(COMPONENT_VELOCITY) |
+                COMPONENT_BIT(COMPONENT_MASS) | COMPONENT_BIT(COMPONENT_TRANSFORM),
+  });
+  scheduler_add(&scheduler, (SystemDesc){
+    .name     = "update_player",
+    .run      = update_player,
+    .reads    = COMPONENT_BIT(COMPONENT_POSITION),
+    .writes   = ACCESS_CAMERA,
+  });
+
+  systems_ready = 1;
+}
+
+void systems_shutdown(void) {
+  if (!systems_ready) return;
+  scheduler_destroy(&scheduler);
+
+  CollisionState *cs = &collision;
+  broadphase_destroy(&cs->broadphase);
+  pair_list_destroy(&cs->pairs);
+  rigid_bodies_destroy(&cs->bodies);
+  free(cs->colliders);
+  free(cs->positions);
+  free(cs->masses);
+  free(cs->velocities);
+  free(cs->query_row);
+  free(cs->row_of_slot);
+  free(cs->moving_bounds);
+  free(cs->moving_static);
+  free(cs->hit_bounds);
+  free(cs->hit_start);
+  free(cs->hits);
+  free(cs->last_hit_start);
+  free(cs->last_hits);
+  free(cs->mesh_hits);
+  free(cs->triangles);
+  free(cs->partner_start);
+  free(cs->partners);
+  for (int t = 0; t < MAX_JOB_THREADS; t++) free(cs->thread_contacts[t].items);
+  free(cs->chunks);
+  free(cs->moved);
+  free(cs->island_parent);
+  free(cs->island_size);
+  free(cs->island_time);
+  free(cs->island_tally);
+  memset(cs, 0, sizeof(CollisionState));
+  systems_ready = 0;
+}
+
 void update_systems(World *world, float dt) {
-  apply_paths(world);
-  apply_gravity_and_friction(world, dt);
-  apply_velocities(world, dt);
-  resolve_collisions(world);
-  update_player(world);
+  TRACE_FN();
+  if (!systems_ready) systems_init(0);
+  scheduler_run(&scheduler, world, dt);
+  world->query_colliders.stale = 1;
+}
+
+// Per-system timings of the last update_systems() call live in
+// timings_ms, in registration order.
+const Scheduler* systems_scheduler(void) {
+  return systems_ready ? &scheduler : NULL;
+}
+
+// Takes effect for the next tick; the new broadphase starts cold.
+void systems_set_broadphase(BroadphaseType type) {
+  broadphase_type = type;
+  if (!systems_ready) return;
+  broadphase_destroy(&collision.broadphase);
+  broadphase_init(&collision.broadphase, type);
+}
+
+// Collider pairs (as entities) whose bounds, padded by COLLISION_MARGIN,
+// started or stopped overlapping during the last tick. Only the
+// sweep-and-prune broadphase tracks pairs over time; with the others this
+// returns 0 and empty lists. Contacts with baked statics are not included,
+// and pairs of sleeping bodies end when they fall asleep.
+int systems_pair_events(const PairList **began, const PairList **ended) {
+  return broadphase_events(&collision.broadphase, began, ended);
+}
+
+// Bakes the world's static colliders now rather than on the first tick.
+// load_bodies re-checks whenever the collider query is rebuilt and
+// only rebuilds the BVH if the statics actually changed.
+void systems_bake_statics(World *world) {
+  Query *q = world_query(world, COLLIDER_QUERY);
+  if (q && bake_statics(world, q)) {
+    collision.wake_all      = 1;
+    collision.islands_dirty = 1;
+  }
+}
+
+// Takes effect for the next tick; turning sleeping off wakes every body.
+void systems_set_sleeping(int enabled) {
+  sleeping_enabled = enabled;
+  collision.islands_dirty = 1;
+}
+
+// Wakes a sleeping body now and the rest of its island on the next tick.
+// Needed after moving a sleeping body by writing its position directly.
+void systems_wake(World *world, Entity e) {
+  MassComponent *mc = world_get_mass(world, e);
+  if (!mc || !mc->sleeping) return;
+  mc->sleeping   = 0;
+  mc->sleep_time = 0.0f;
+  collision.islands_dirty = 1;
 }
@@ -2,9 +2,19 @@
 #define SYSTEM_H
 
 #include "ecs/World.h"
+#include "ecs/Scheduler.h"
 #include "maths/Maths3D.h"
+#include "physics/Broadphase.h"
 
+void systems_init(int deterministic);
+void systems_shutdown(void);
 void update_systems(World *world, float dt);
+const Scheduler* systems_scheduler(void);
+void systems_set_broadphase(BroadphaseType type);
+int  systems_pair_events(const PairList **began, const PairList **ended);
+void systems_bake_statics(World *world);
+void systems_set_sleeping(int enabled);
+void systems_wake(World *world, Entity e);
 void apply_thrust(World *world, Entity e, Vec3f dir, float dt);
 void jump(World *world, Entity e);
 
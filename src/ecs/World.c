@@ -1,6 +1,10 @@
 #include "World.h"
+#include "core/Trace.h"
 #include "maths/Maths3D.h"
 #include "scene/camera.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
 
 static void init_player(World *world) {
   Entity e = world_create_entity(world);
@@ -19,20 +23,46 @@ static void init_player(World *world) {
   world_add_speed(world, e, 5.0f);
 }
 
+static const size_t component_sizes[COMPONENT_COUNT] = {
+  [COMPONENT_POSITION]    = sizeof(PositionComponent),
+  [COMPONENT_ROTATION]    = sizeof(RotationComponent),
+  [COMPONENT_SCALE]       = sizeof(ScaleComponent),
+  [COMPONENT_MESH]        = sizeof(MeshComponent),
+  [COMPONENT_MATERIAL]    = sizeof(MaterialComponent),
+  [COMPONENT_VELOCITY]    = sizeof(VelocityComponent),
+  [COMPONENT_PATH]        = sizeof(PathComponent),
+  [COMPONENT_SPEED]       = sizeof(SpeedComponent),
+  [COMPONENT_COLLIDER]    = sizeof(ColliderComponent),
+  [COMPONENT_MASS]        = sizeof(MassComponent),
+  [COMPONENT_LOCOMOTION]  = sizeof(LocomotionComponent),
+  [COMPONENT_JUMP]        = sizeof(JumpComponent),
+  [COMPONENT_TRANSFORM]   = sizeof(TransformComponent),
+  [COMPONENT_HIERARCHY]   = sizeof(HierarchyComponent),
+};
+
 void world_init(World *world) {
-  world->next_id      = 0;
-  world->positions    = NULL;
-  world->rotations    = NULL;
-  world->scales       = NULL;
-  world->meshes       = NULL;
-  world->materials    = NULL;
-  world->velocities   = NULL;
-  world->paths        = NULL;
-  world->speeds       = NULL;
-  world->colliders    = NULL;
-  world->masses       = NULL;
-  world->locomotions  = NULL;
-  world->jumps        = NULL;
+  world->generations    = NULL;
+  world->alive          = NULL;
+  world->signatures     = NULL;
+  world->free_slots     = NULL;
+  world->free_count     = 0;
+  world->slot_count     = 0;
+  world->slot_capacity  = 0;
+
+  for (int i = 0; i < COMPONENT_COUNT; i++) {
+    sparse_set_init(&world->components[i], component_sizes[i]);
+  }
+  world->query_count = 0;
+  world->hierarchy_unsorted = 0;
+  for (int i = 0; i < MAX_COMMAND_BUFFERS; i++) {
+    command_buffer_init(&world->commands[i]);
+  }
+  memset(&world->static_colliders, 0, sizeof(StaticColliders));
+  static_bvh_init(&world->static_colliders.bvh);
+  memset(&world->query_colliders, 0, sizeof(QueryColliders));
+  tree_init(&world->query_colliders.tree);
+  world->query_colliders.stale = 1;
+  memset(&world->collider_meshes, 0, sizeof(ColliderMeshes));
 
   init_player(world);
 
@@ -42,175 +72,589 @@ void world_init(World *world) {
   world->camera = init_camera();
 }
 
+static void grow_slots(World *world, int min_capacity) {
+  int capacity = world->slot_capacity ? world->slot_capacity : 64;
+  while (capacity < min_capacity) capacity *= 2;
+  if (capacity > ENTITY_MAX_INDEX + 1) capacity = ENTITY_MAX_INDEX + 1;
+
+  world->generations  = realloc(world->generations, capacity * sizeof(int));
+  world->signatures   = realloc(world->signatures, capacity * sizeof(ComponentMask));
+  world->free_slots   = realloc(world->free_slots, capacity * sizeof(int));
+  world->alive        = realloc(world->alive, ((capacity + 63) / 64) * sizeof(uint64_t));
+
+  for (int i = world->slot_capacity / 64; i < (capacity + 63) / 64; i++) {
+    world->alive[i] = 0;
+  }
+  world->slot_capacity = capacity;
+}
+
+// Pre-sizes the entity slots and every store's sparse array so that creating
+// up to `entity_count` entities never reallocates.
+void world_reserve(World *world, int entity_count) {
+  if (entity_count > ENTITY_MAX_INDEX + 1) entity_count = ENTITY_MAX_INDEX + 1;
+  if (entity_count > world->slot_capacity) grow_slots(world, entity_count);
+  for (int i = 0; i < COMPONENT_COUNT; i++) {
+    sparse_set_reserve(&world->components[i], 0, entity_count - 1);
+  }
+}
+
+void world_reserve_component(World *world, ComponentType type, int count) {
+  sparse_set_reserve(&world->components[type], count, 0);
+}
+
+// Resets the world to the state world_init leaves it in while keeping every
+// allocation, so reloading a scene of the same size never touches the heap.
+// Live slots are recycled with their generation bumped so handles from
+// before the clear stay dead.
+void world_clear(World *world) {
+  for (int i = 0; i < COMPONENT_COUNT; i++) {
+    sparse_set_clear(&world->components[i]);
+  }
+  for (int i = 0; i < world->query_count; i++) {
+    world->queries[i].dirty = 1;
+  }
+  world->hierarchy_unsorted = 0;
+  for (int i = 0; i < MAX_COMMAND_BUFFERS; i++) {
+    command_buffer_clear(&world->commands[i]);
+  }
+
+  world->free_count = 0;
+  for (int index = world->slot_count - 1; index >= 0; index--) {
+    world->generations[index] = (world->generations[index] + 1) & ENTITY_GEN_MASK;
+    world->free_slots[world->free_count++] = index;
+  }
+  memset(world->alive, 0, ((world->slot_capacity + 63) / 64) * sizeof(uint64_t));
+
+  ColliderMeshes *cm = &world->collider_meshes;
+  for (int i = 0; i < cm->count; i++) mesh_bvh_destroy(&cm->items[i]);
+  cm->count      = 0;
+  cm->free_count = 0;
+  cm->next_id    = 0;
+
+  mesh_reg_destroy(&world->mesh_registry);
+  mat_reg_destroy(&world->material_registry);
+
+  init_player(world);
+
+  world->camera = init_camera();
+}
+
 Entity world_create_entity(World *world) {
-  return world->next_id++;
+  int index;
+  if (world->free_count > 0) {
+    index = world->free_slots[--world->free_count];
+  } else {
+    if (world->slot_count == ENTITY_MAX_INDEX + 1) {
+      printf("Failed to create entity - hit max entity count of: %d\n", world->slot_count);
+      return ENTITY_NONE;
+    }
+    if (world->slot_count == world->slot_capacity) grow_slots(world, world->slot_count + 1);
+    index = world->slot_count++;
+    world->generations[index] = 0;
+  }
+
+  world->alive[index / 64] |= (uint64_t)1 << (index % 64);
+  world->signatures[index] = 0;
+
+  return entity_make(index, world->generations[index]);
+}
+
+int world_is_alive(World *world, Entity e) {
+  if (e < 0) return 0;
+  int index = entity_index(e);
+  return index < world->slot_count &&
+         (world->alive[index / 64] >> (index % 64) & 1) &&
+         world->generations[index] == entity_generation(e);
 }
 
+int world_entity_count(World *world) {
+  return world->slot_count - world->free_count;
+}
+
+ComponentMask world_signature(World *world, Entity e) {
+  if (!world_is_alive(world, e)) return 0;
+  return world->signatures[entity_index(e)];
+}
+
+static void invalidate_queries(World *world, ComponentMask changed) {
+  for (int i = 0; i < world->query_count; i++) {
+    if (world->queries[i].mask & changed) world->queries[i].dirty = 1;
+  }
+}
+
+static int has_parent(World *world, Entity e) {
+  if (!(world->signatures[entity_index(e)] & COMPONENT_BIT(COMPONENT_HIERARCHY))) return 0;
+  return world_get_hierarchy(world, e)->parent != ENTITY_NONE;
+}
+
+// Components the physics step simulates in world space. A child's position
+// is local to its parent, so children may not have them: a velocity alone
+// is fine and moves a child within its parent's space.
+#define PHYSICS_BODY (COMPONENT_BIT(COMPONENT_COLLIDER) | COMPONENT_BIT(COMPONENT_MASS))
+
+static void* add_component(World *world, ComponentType type, Entity e) {
+  if (!world_is_alive(world, e)) return NULL;
+  if ((COMPONENT_BIT(type) & PHYSICS_BODY) && has_parent(world, e)) {
+    printf("Failed to add component %d - entity %d has a parent, and physics runs in world space\n", type, e);
+    return NULL;
+  }
+
+  SparseSet *set = &world->components[type];
+  if (sparse_set_index(set, e) < 0) {
+    world->signatures[entity_index(e)] |= COMPONENT_BIT(type);
+    invalidate_queries(world, COMPONENT_BIT(type));
+  }
+  return sparse_set_add(set, e);
+}
+
+#define TRANSFORM_SOURCES (COMPONENT_BIT(COMPONENT_POSITION) | COMPONENT_BIT(COMPONENT_ROTATION) | COMPONENT_BIT(COMPONENT_SCALE))
+
+static void unlink_hierarchy(World *world, Entity e);
+
+// Frees the triangle BVH of the entity's mesh collider, if it has one, and
+// hands its slot to the next mesh collider.
+static void release_collider_mesh(World *world, Entity e) {
+  ColliderComponent *c = sparse_set_get(&world->components[COMPONENT_COLLIDER], e);
+  if (!c || c->mesh < 0) return;
+
+  ColliderMeshes *cm = &world->collider_meshes;
+  mesh_bvh_destroy(&cm->items[c->mesh]);
+  cm->ids[c->mesh] = 0;
+  cm->free_slots[cm->free_count++] = c->mesh;
+  c->mesh = -1;
+}
+
+static void remove_component(World *world, ComponentType type, Entity e) {
+  SparseSet *set = &world->components[type];
+  if (sparse_set_index(set, e) < 0) return;
+
+  if (type == COMPONENT_HIERARCHY) unlink_hierarchy(world, e);
+  if (type == COMPONENT_COLLIDER) release_collider_mesh(world, e);
+  sparse_set_remove(set, e);
+  world->signatures[entity_index(e)] &= ~COMPONENT_BIT(type);
+  invalidate_queries(world, COMPONENT_BIT(type));
+
+  if (COMPONENT_BIT(type) & TRANSFORM_SOURCES) world_mark_transform_dirty(world, e);
+}
+
+
+// Bodies with mass are always integrated, so give them a velocity up front
+// instead of adding one the first time gravity touches them mid-iteration.
+static void ensure_velocity(World *world, Entity e) {
+  if (!world_get_velocity(world, e)) world_add_velocity(world, e, vec3f_identity());
+}
+
+// Anything drawn gets a cached transform; it starts dirty so the first
+// world_update_transforms() fills it in.
+static void ensure_transform(World *world, Entity e) {
+  if (world_get_transform_component(world, e)) return;
+  TransformComponent *c = add_component(world, COMPONENT_TRANSFORM, e);
+  if (!c) return;
+  c->entity = e;
+  c->dirty = 1;
+}
 
 void world_add_position(World *world, Entity e, Vec3f position) {
-  PositionComponent *c = malloc(sizeof(PositionComponent));
+  PositionComponent *c = add_component(world, COMPONENT_POSITION, e);
+  if (!c) return;
   c->entity = e;
   c->position = position;
-  HASH_ADD_INT(world->positions, entity, c);
+
+  world_mark_transform_dirty(world, e);
 }
 
 void world_add_rotation(World *world, Entity e, Vec3f rotation) {
-  RotationComponent *c = malloc(sizeof(RotationComponent));
+  RotationComponent *c = add_component(world, COMPONENT_ROTATION, e);
+  if (!c) return;
   c->entity = e;
   c->rotation = rotation;
-  HASH_ADD_INT(world->rotations, entity, c);
+
+  world_mark_transform_dirty(world, e);
 }
 
 void world_add_scale(World *world, Entity e, Vec3f scale) {
-  ScaleComponent *c = malloc(sizeof(ScaleComponent));
+  ScaleComponent *c = add_component(world, COMPONENT_SCALE, e);
+  if (!c) return;
   c->entity = e;
   c->scale = scale;
-  HASH_ADD_INT(world->scales, entity, c);
+
+  world_mark_transform_dirty(world, e);
 }
 
 void world_add_material(World *world, Entity e, int mat_id) {
-  MaterialComponent *c = malloc(sizeof(MaterialComponent));
+  MaterialComponent *c = add_component(world, COMPONENT_MATERIAL, e);
+  if (!c) return;
   c->entity = e;
   c->mat_id = mat_id;
-  HASH_ADD_INT(world->materials, entity, c);
 }
 
 void world_add_mesh(World *world, Entity e, int mesh_id) {
-  MeshComponent *c = malloc(sizeof(MeshComponent));
+  MeshComponent *c = add_component(world, COMPONENT_MESH, e);
+  if (!c) return;
   c->entity = e;
   c->mesh_id = mesh_id;
-  HASH_ADD_INT(world->meshes, entity, c);
+
+  ensure_transform(world, e);
 }
 
 void world_add_velocity(World *world, Entity e, Vec3f velocity) {
-  VelocityComponent *c = malloc(sizeof(VelocityComponent));
+  VelocityComponent *c = add_component(world, COMPONENT_VELOCITY, e);
+  if (!c) return;
   c->entity = e;
   c->velocity = velocity;
-  HASH_ADD_INT(world->velocities, entity, c);
 }
 
 void world_add_path(World *world, Entity e, Path path) {
-  PathComponent *c = malloc(sizeof(PathComponent));
+  PathComponent *c = add_component(world, COMPONENT_PATH, e);
+  if (!c) return;
   c->entity = e;
   c->path = path;
-  HASH_ADD_INT(world->paths, entity, c);
+
+  // Paths steer through the velocity and are iterated together with the
+  // position, so a follower gets both up front.
+  if (!world_get_position(world, e)) world_add_position(world, e, path.starting_pos);
+  ensure_velocity(world, e);
 }
 
 void world_add_speed(World *world, Entity e, float speed) {
-  SpeedComponent *c = malloc(sizeof(SpeedComponent));
+  SpeedComponent *c = add_component(world, COMPONENT_SPEED, e);
+  if (!c) return;
   c->entity = e;
   c->speed = speed;
-  HASH_ADD_INT(world->speeds, entity, c);
 }
 
 void world_add_collider(World *world, Entity e, Vec3f half_extents, int is_static, float restitution, float friction) {
-  ColliderComponent *c = malloc(sizeof(ColliderComponent));
+  release_collider_mesh(world, e);
+  ColliderComponent *c = add_component(world, COMPONENT_COLLIDER, e);
+  if (!c) return;
   c->entity = e;
   c->half_extents = half_extents;
   c->is_static = is_static;
   c->restitution = restitution;
   c->friction = friction;
-  HASH_ADD_INT(world->colliders, entity, c);
+  c->mesh = -1;
+}
+
+// Builds the mesh's triangle BVH, rotated and scaled as it is drawn, and
+// adds a static collider for it centred on the entity's position. Its half extents cover the mesh
+// around that point, so the broadphase and the static bake see a box that
+// bounds it.
+void world_add_mesh_collider(World *world, Entity e, const Vec3f *positions, const int *indices, int index_count,
+                             Vec3f rotation, Vec3f scale, float restitution, float friction) {
+  if (!world_is_alive(world, e) || has_parent(world, e)) {
+    printf("Failed to add mesh collider - entity %d is not a live root entity\n", e);
+    return;
+  }
+  if (!positions || !indices || index_count < 3) {
+    printf("Failed to add mesh collider - entity %d was given an empty mesh\n", e);
+    return;
+  }
+  ColliderMeshes *cm = &world->collider_meshes;
+  int slot;
+  if (cm->free_count > 0) {
+    slot = cm->free_slots[--cm->free_count];
+  } else {
+    if (cm->count == cm->capacity) {
+      cm->capacity   = cm->capacity ? cm->capacity * 2 : 4;
+      cm->items      = realloc(cm->items, cm->capacity * sizeof(MeshBvh));
+      cm->ids        = realloc(cm->ids, cm->capacity * sizeof(uint32_t));
+      cm->free_slots = realloc(cm->free_slots, cm->capacity * sizeof(int));
+    }
+    slot = cm->count++;
+    memset(&cm->items[slot], 0, sizeof(MeshBvh));
+  }
+  MeshBvh *bvh = &cm->items[slot];
+  mesh_bvh_build(bvh, positions, indices, index_count, mat4_trs(vec3f_identity(), rotation, scale));
+
+  Vec3f half_extents = {
+    fmaxf(fabsf(bvh->bounds.min.x), fabsf(bvh->bounds.max.x)),
+    fmaxf(fabsf(bvh->bounds.min.y), fabsf(bvh->bounds.max.y)),
+    fmaxf(fabsf(bvh->bounds.min.z), fabsf(bvh->bounds.max.z))
+  };
+  world_add_collider(world, e, half_extents, 1, restitution, friction);
+  ColliderComponent *c = world_get_collider(world, e);
+  if (!c) {
+    mesh_bvh_destroy(bvh);
+    cm->ids[slot] = 0;
+    cm->free_slots[cm->free_count++] = slot;
+    return;
+  }
+  c->mesh = slot;
+  cm->ids[slot] = ++cm->next_id;
 }
 
 void world_add_mass(World *world, Entity e, float mass) {
-  MassComponent *c = malloc(sizeof(MassComponent));
+  MassComponent *c = add_component(world, COMPONENT_MASS, e);
+  if (!c) return;
   c->entity = e;
   c->mass = mass;
-  c->grounded_entity = -1;
-  HASH_ADD_INT(world->masses, entity, c);
+  c->grounded_entity = ENTITY_NONE;
+  c->sleep_time = 0.0f;
+  c->sleeping = 0;
+  c->island = ENTITY_NONE;
+  c->island_size = 0;
+
+  PositionComponent *pc = world_get_position(world, e);
+  c->rest_position = pc ? pc->position : vec3f_identity();
+
+  ensure_velocity(world, e);
 }
 
 void world_add_locomotion(World *world, Entity e, float thrust, float max_speed) {
-  LocomotionComponent *c = malloc(sizeof(LocomotionComponent));
+  LocomotionComponent *c = add_component(world, COMPONENT_LOCOMOTION, e);
+  if (!c) return;
   c->entity = e;
   c->thrust = thrust;
   c->max_speed = max_speed;
-  HASH_ADD_INT(world->locomotions, entity, c);
 }
 
 void world_add_jump(World *world, Entity e, float jump_force) {
-  JumpComponent *c = malloc(sizeof(JumpComponent));
+  JumpComponent *c = add_component(world, COMPONENT_JUMP, e);
+  if (!c) return;
   c->entity = e;
   c->jump_force = jump_force;
-  HASH_ADD_INT(world->jumps, entity, c);
+}
+
+
+// Generic add: `data` must be a fully initialised component of `type`,
+// including its entity field.
+void world_add_component(World *world, ComponentType type, Entity e, const void *data) {
+  // Hierarchy links have to stay consistent on both ends, so only the
+  // parent is taken from `data`.
+  if (type == COMPONENT_HIERARCHY) {
+    world_set_parent(world, e, ((const HierarchyComponent *)data)->parent);
+    return;
+  }
+
+  if (type == COMPONENT_COLLIDER) release_collider_mesh(world, e);
+  void *c = add_component(world, type, e);
+  if (!c) return;
+  memcpy(c, data, component_sizes[type]);
+  // A mesh slot belongs to the collider that built it (see
+  // world_add_mesh_collider), so a copied collider is a plain box.
+  if (type == COMPONENT_COLLIDER) ((ColliderComponent *)c)->mesh = -1;
+
+  if (type == COMPONENT_MASS) ensure_velocity(world, e);
+  if (type == COMPONENT_MESH) ensure_transform(world, e);
+  if (COMPONENT_BIT(type) & TRANSFORM_SOURCES) world_mark_transform_dirty(world, e);
+}
+
+void world_remove_component(World *world, ComponentType type, Entity e) {
+  remove_component(world, type, e);
+}
+
+void* world_get_component(World *world, ComponentType type, Entity e) {
+  return sparse_set_get(&world->components[type], e);
 }
 
 
 PositionComponent* world_get_position(World *world, Entity e) {
-  PositionComponent *c;
-  HASH_FIND_INT(world->positions, &e, c);
-  return c;
+  return sparse_set_get(&world->components[COMPONENT_POSITION], e);
 }
 
 RotationComponent* world_get_rotation(World *world, Entity e) {
-  RotationComponent *c;
-  HASH_FIND_INT(world->rotations, &e, c);
-  return c;
+  return sparse_set_get(&world->components[COMPONENT_ROTATION], e);
 }
 
 ScaleComponent* world_get_scale(World *world, Entity e) {
-  ScaleComponent *c;
-  HASH_FIND_INT(world->scales, &e, c);
-  return c;
+  return sparse_set_get(&world->components[COMPONENT_SCALE], e);
 }
 
 MaterialComponent* world_get_material(World *world, Entity e) {
-  MaterialComponent *c;
-  HASH_FIND_INT(world->materials, &e, c);
-  return c;
+  return sparse_set_get(&world->components[COMPONENT_MATERIAL], e);
 }
 
 MeshComponent* world_get_mesh(World *world, Entity e) {
-  MeshComponent *c;
-  HASH_FIND_INT(world->meshes, &e, c);
-  return c;
+  return sparse_set_get(&world->components[COMPONENT_MESH], e);
 }
 
 VelocityComponent* world_get_velocity(World *world, Entity e) {
-  VelocityComponent *c;
-  HASH_FIND_INT(world->velocities, &e, c);
-  return c;
+  return sparse_set_get(&world->components[COMPONENT_VELOCITY], e);
 }
 
 PathComponent* world_get_path(World *world, Entity e) {
-  PathComponent *c;
-  HASH_FIND_INT(world->paths, &e, c);
-  return c;
+  return sparse_set_get(&world->components[COMPONENT_PATH], e);
 }
 
 SpeedComponent* world_get_speed(World *world, Entity e) {
-  SpeedComponent *c;
-  HASH_FIND_INT(world->speeds, &e, c);
-  return c;
+  return sparse_set_get(&world->components[COMPONENT_SPEED], e);
 }
 
 ColliderComponent* world_get_collider(World *world, Entity e) {
-  ColliderComponent *c;
-  HASH_FIND_INT(world->colliders, &e, c);
-  return c;
+  return sparse_set_get(&world->components[COMPONENT_COLLIDER], e);
 }
 
 MassComponent* world_get_mass(World *world, Entity e) {
-  MassComponent *c;
-  HASH_FIND_INT(world->masses, &e, c);
-  return c;
+  return sparse_set_get(&world->components[COMPONENT_MASS], e);
 }
 
 JumpComponent* world_get_jump(World *world, Entity e) {
-  JumpComponent *c;
-  HASH_FIND_INT(world->jumps, &e, c);
-  return c;
+  return sparse_set_get(&world->components[COMPONENT_JUMP], e);
 }
 
 LocomotionComponent* world_get_locomotion(World *world, Entity e) {
-  LocomotionComponent *c;
-  HASH_FIND_INT(world->locomotions, &e, c);
-  return c;
-}
-
-
-Mat4 world_get_transform(World *world, Entity e) {
+  return sparse_set_get(&world->components[COMPONENT_LOCOMOTION], e);
+}
+
+TransformComponent* world_get_transform_component(World *world, Entity e) {
+  return sparse_set_get(&world->components[COMPONENT_TRANSFORM], e);
+}
+
+HierarchyComponent* world_get_hierarchy(World *world, Entity e) {
+  return sparse_set_get(&world->components[COMPONENT_HIERARCHY], e);
+}
+
+
+// HIERARCHY
+
+static HierarchyComponent* ensure_hierarchy(World *world, Entity e) {
+  HierarchyComponent *h = world_get_hierarchy(world, e);
+  if (h) return h;
+
+  h = add_component(world, COMPONENT_HIERARCHY, e);
+  if (!h) return NULL;
+  h->entity       = e;
+  h->parent       = ENTITY_NONE;
+  h->first_child  = ENTITY_NONE;
+  h->next_sibling = ENTITY_NONE;
+  h->depth        = 0;
+  world->hierarchy_unsorted = 1;
+
+  ensure_transform(world, e);
+  return world_get_hierarchy(world, e);
+}
+
+static void set_depths(World *world, Entity e, int depth) {
+  HierarchyComponent *h = world_get_hierarchy(world, e);
+  h->depth = depth;
+  for (Entity c = h->first_child; c != ENTITY_NONE; c = world_get_hierarchy(world, c)->next_sibling) {
+    set_depths(world, c, depth + 1);
+  }
+}
+
+static void unlink_parent(World *world, HierarchyComponent *h) {
+  if (h->parent == ENTITY_NONE) return;
+
+  HierarchyComponent *p = world_get_hierarchy(world, h->parent);
+  if (p->first_child == h->entity) {
+    p->first_child = h->next_sibling;
+  } else {
+    for (Entity s = p->first_child; s != ENTITY_NONE;) {
+      HierarchyComponent *sh = world_get_hierarchy(world, s);
+      if (sh->next_sibling == h->entity) {
+        sh->next_sibling = h->next_sibling;
+        break;
+      }
+      s = sh->next_sibling;
+    }
+  }
+  h->parent = ENTITY_NONE;
+  h->next_sibling = ENTITY_NONE;
+}
+
+// Detaches `e` from its parent and turns its children into roots. Their
+// local transforms are kept, so they become world-space as they are.
+static void unlink_hierarchy(World *world, Entity e) {
+  HierarchyComponent *h = world_get_hierarchy(world, e);
+  if (!h) return;
+
+  unlink_parent(world, h);
+
+  Entity c = h->first_child;
+  while (c != ENTITY_NONE) {
+    HierarchyComponent *ch = world_get_hierarchy(world, c);
+    Entity next = ch->next_sibling;
+    ch->parent = ENTITY_NONE;
+    ch->next_sibling = ENTITY_NONE;
+    set_depths(world, c, 0);
+    world_mark_transform_dirty(world, c);
+    c = next;
+  }
+  h->first_child = ENTITY_NONE;
+  world->hierarchy_unsorted = 1;
+}
+
+// Parents `child` under `parent`, or detaches it when parent is ENTITY_NONE.
+void world_set_parent(World *world, Entity child, Entity parent) {
+  if (!world_is_alive(world, child)) return;
+  if (parent != ENTITY_NONE && !world_is_alive(world, parent)) return;
+  if (parent != ENTITY_NONE && (world->signatures[entity_index(child)] & PHYSICS_BODY)) {
+    printf("Failed to set parent - entity %d has a collider or mass, and physics runs in world space\n", child);
+    return;
+  }
+
+  for (Entity a = parent; a != ENTITY_NONE;) {
+    if (a == child) {
+      printf("Failed to set parent - entity %d would become its own ancestor\n", child);
+      return;
+    }
+    HierarchyComponent *ah = world_get_hierarchy(world, a);
+    a = ah ? ah->parent : ENTITY_NONE;
+  }
+
+  if (!ensure_hierarchy(world, child)) return;
+  if (parent != ENTITY_NONE && !ensure_hierarchy(world, parent)) return;
+
+  HierarchyComponent *h = world_get_hierarchy(world, child);
+  unlink_parent(world, h);
+
+  int depth = 0;
+  if (parent != ENTITY_NONE) {
+    HierarchyComponent *p = world_get_hierarchy(world, parent);
+    h->parent = parent;
+    h->next_sibling = p->first_child;
+    p->first_child = child;
+    depth = p->depth + 1;
+  }
+  set_depths(world, child, depth);
+
+  world->hierarchy_unsorted = 1;
+  world_mark_transform_dirty(world, child);
+}
+
+// Counting sort of the hierarchy store by depth, applied in place by
+// following permutation cycles. Only runs after the tree changed shape.
+static void sort_hierarchy(World *world) {
+  TRACE_FN();
+  SparseSet *set = &world->components[COMPONENT_HIERARCHY];
+  int n = set->count;
+  world->hierarchy_unsorted = 0;
+  if (n <= 0) return;
+
+  int max_depth = 0;
+  for (int i = 0; i < n; i++) {
+    int depth = sparse_set_at(set, HierarchyComponent, i)->depth;
+    if (depth > max_depth) max_depth = depth;
+  }
+
+  int *offsets = calloc(max_depth + 2, sizeof(int));
+  int *target  = malloc((size_t)n * sizeof(int));
+  for (int i = 0; i < n; i++) {
+    offsets[sparse_set_at(set, HierarchyComponent, i)->depth + 1]++;
+  }
+  for (int d = 0; d <= max_depth; d++) {
+    offsets[d + 1] += offsets[d];
+  }
+  for (int i = 0; i < n; i++) {
+    target[i] = offsets[sparse_set_at(set, HierarchyComponent, i)->depth]++;
+  }
+
+  for (int i = 0; i < n; i++) {
+    while (target[i] != i) {
+      int j = target[i];
+      sparse_set_swap(set, i, j);
+      target[i] = target[j];
+      target[j] = j;
+    }
+  }
+
+  free(offsets);
+  free(target);
+  invalidate_queries(world, COMPONENT_BIT(COMPONENT_HIERARCHY));
+}
+
+
+static Mat4 local_transform(World *world, Entity e) {
   PositionComponent *pc = world_get_position(world, e);
   RotationComponent *rc = world_get_rotation(world, e);
   ScaleComponent    *sc = world_get_scale(world, e);
@@ -219,161 +663,194 @@ Mat4 world_get_transform(World *world, Entity e) {
   Vec3f rotation = rc ? rc->rotation : vec3f_identity();
   Vec3f scale    = sc ? sc->scale    : (Vec3f){1.0f, 1.0f, 1.0f};
 
-  Mat4 transform = mat4_mul(
-    mat4_translation(position.x, position.y, position.z),
-    mat4_mul(
-      mat4_rotation(rotation),
-      mat4_scale(scale.x, scale.y, scale.z)
-    )
-  );
-
-  return transform;
-}
-
-
-static void destroy_position(World *world, PositionComponent *c) {
-  HASH_DEL(world->positions, c);
-  free(c);
+  return mat4_trs(position, rotation, scale);
+}
+
+static Mat4 compute_transform(World *world, Entity e) {
+  Mat4 local = local_transform(world, e);
+  HierarchyComponent *h = world_get_hierarchy(world, e);
+  if (!h || h->parent == ENTITY_NONE) return local;
+  return mat4_mul(world_get_transform(world, h->parent), local);
+}
+
+// Safe to call from a system chunk for entities that chunk owns: it only
+// touches the entity's own transform.
+void world_mark_transform_dirty(World *world, Entity e) {
+  TransformComponent *tc = world_get_transform_component(world, e);
+  if (tc) tc->dirty = 1;
+}
+
+// Rebuilds every dirty cached transform. Static entities never get marked,
+// so after the first frame this is a linear scan of the dirty flags. The
+// hierarchy store is in depth order, so one walk pushes dirtiness down
+// whole subtrees and a second rebuilds children after their parents.
+void world_update_transforms(World *world) {
+  TRACE_FN();
+  SparseSet *transforms = &world->components[COMPONENT_TRANSFORM];
+  SparseSet *hierarchy  = &world->components[COMPONENT_HIERARCHY];
+  if (world->hierarchy_unsorted) sort_hierarchy(world);
+
+  for (int i = 0; i < hierarchy->count; i++) {
+    HierarchyComponent *h = sparse_set_at(hierarchy, HierarchyComponent, i);
+    if (h->parent == ENTITY_NONE) continue;
+    TransformComponent *pt = world_get_transform_component(world, h->parent);
+    if (pt && pt->dirty) world_mark_transform_dirty(world, h->entity);
+  }
+
+  for (int i = 0; i < transforms->count; i++) {
+    TransformComponent *tc = sparse_set_at(transforms, TransformComponent, i);
+    if (!tc->dirty || has_parent(world, tc->entity)) continue;
+    tc->world = local_transform(world, tc->entity);
+    tc->dirty = 0;
+  }
+
+  for (int i = 0; i < hierarchy->count; i++) {
+    HierarchyComponent *h = sparse_set_at(hierarchy, HierarchyComponent, i);
+    if (h->parent == ENTITY_NONE) continue;
+    TransformComponent *tc = world_get_transform_component(world, h->entity);
+    TransformComponent *pt = world_get_transform_component(world, h->parent);
+    if (!tc || !pt || !tc->dirty) continue;
+    tc->world = mat4_mul(pt->world, local_transform(world, h->entity));
+    tc->dirty = 0;
+  }
 }
 
-static void destroy_rotation(World *world, RotationComponent *c) {
-  HASH_DEL(world->rotations, c);
-  free(c);
-}
-
-static void destroy_scale(World *world, ScaleComponent *c) {
-  HASH_DEL(world->scales, c);
-  free(c);
-}
-
-static void destroy_mesh(World *world, MeshComponent *c) {
-  HASH_DEL(world->meshes, c);
-  free(c);
-}
-
-static void destroy_material(World *world, MaterialComponent *c) {
-  HASH_DEL(world->materials, c);
-  free(c);
-}
-
-static void destroy_velocity(World *world, VelocityComponent *c) {
-  HASH_DEL(world->velocities, c);
-  free(c);
-}
-
-static void destroy_path(World *world, PathComponent *c) {
-  HASH_DEL(world->paths, c);
-  free(c);
-}
-
-static void destroy_speed(World *world, SpeedComponent *c) {
-  HASH_DEL(world->speeds, c);
-  free(c);
-}
-
-static void destroy_collider(World *world, ColliderComponent *c) {
-  HASH_DEL(world->colliders, c);
-  free(c);
-}
+Mat4 world_get_transform(World *world, Entity e) {
+  TransformComponent *tc = world_get_transform_component(world, e);
+  if (!tc) return compute_transform(world, e);
 
-static void destroy_mass(World *world, MassComponent *c) {
-  HASH_DEL(world->masses, c);
-  free(c);
+  if (tc->dirty) {
+    tc->world = compute_transform(world, e);
+    tc->dirty = 0;
+  }
+  return tc->world;
 }
 
-static void destroy_jump(World *world, JumpComponent *c) {
-  HASH_DEL(world->jumps, c);
-  free(c);
-}
 
-static void destroy_locomotion(World *world, LocomotionComponent *c) {
-  HASH_DEL(world->locomotions, c);
-  free(c);
+void world_destroy_path(World *world, PathComponent *pc) {
+  remove_component(world, COMPONENT_PATH, pc->entity);
 }
 
 
-void world_destroy_path(World *world, PathComponent *pc) {
-  destroy_path(world, pc);
+static void release_slot(World *world, Entity e) {
+  int index = entity_index(e);
+  world->alive[index / 64] &= ~((uint64_t)1 << (index % 64));
+  world->generations[index] = (world->generations[index] + 1) & ENTITY_GEN_MASK;
+  world->signatures[index] = 0;
+  world->free_slots[world->free_count++] = index;
 }
 
-
 void world_destroy_entity(World *world, Entity e) {
-  PositionComponent *p = world_get_position(world, e);
-  if (p) destroy_position(world, p);
-
-  RotationComponent *r = world_get_rotation(world, e);
-  if (r) destroy_rotation(world, r);
-
-  ScaleComponent *s = world_get_scale(world, e);
-  if (s) destroy_scale(world, s);
-
-  MeshComponent *mesh = world_get_mesh(world, e);
-  if (mesh) destroy_mesh(world, mesh);
-
-  MaterialComponent *mat = world_get_material(world, e);
-  if (mat) destroy_material(world, mat);
-
-  VelocityComponent *v = world_get_velocity(world, e);
-  if (v) destroy_velocity(world, v);
-
-  PathComponent *path = world_get_path(world, e);
-  if (path) destroy_path(world, path);
-
-  SpeedComponent *speed = world_get_speed(world, e);
-  if (speed) destroy_speed(world, speed);
-
-  ColliderComponent *collider = world_get_collider(world, e);
-  if (collider) destroy_collider(world, collider);
-
-  MassComponent *mass = world_get_mass(world, e);
-  if (mass) destroy_mass(world, mass);
-
-  LocomotionComponent *locomotion = world_get_locomotion(world, e);
-  if (locomotion) destroy_locomotion(world, locomotion);
-
-  JumpComponent *jump = world_get_jump(world, e);
-  if (jump) destroy_jump(world, jump);
+  if (!world_is_alive(world, e)) return;
+
+  ComponentMask signature = world->signatures[entity_index(e)];
+  for (int i = 0; i < COMPONENT_COUNT; i++) {
+    if (signature & COMPONENT_BIT(i)) remove_component(world, i, e);
+  }
+  release_slot(world, e);
+}
+
+void world_destroy_entities(World *world, const Entity *entities, int count) {
+  // Store-major order keeps each sparse set hot while it drains, and the
+  // query cache is invalidated once per store rather than once per entity.
+  for (int i = 0; i < count; i++) {
+    ComponentMask signature = world_signature(world, entities[i]);
+    if (signature & COMPONENT_BIT(COMPONENT_HIERARCHY)) unlink_hierarchy(world, entities[i]);
+    if (signature & COMPONENT_BIT(COMPONENT_COLLIDER)) release_collider_mesh(world, entities[i]);
+  }
+
+  ComponentMask touched = 0;
+  for (int t = 0; t < COMPONENT_COUNT; t++) {
+    SparseSet *set = &world->components[t];
+    for (int i = 0; i < count; i++) {
+      Entity e = entities[i];
+      if (!world_is_alive(world, e) || !(world->signatures[entity_index(e)] & COMPONENT_BIT(t))) continue;
+      sparse_set_remove(set, e);
+      touched |= COMPONENT_BIT(t);
+    }
+  }
+  invalidate_queries(world, touched);
+
+  for (int i = 0; i < count; i++) {
+    if (world_is_alive(world, entities[i])) release_slot(world, entities[i]);
+  }
+}
+
+
+CommandBuffer* world_commands(World *world, int index) {
+  if (index < 0 || index >= MAX_COMMAND_BUFFERS) return NULL;
+  return &world->commands[index];
+}
+
+// Plays every buffer back in index order, then in record order within a
+// buffer. Give each job or chunk its own buffer index (not whatever thread
+// happens to run it) and the merged result is the same on every run.
+void world_flush_commands(World *world) {
+  TRACE_FN();
+  for (int i = 0; i < MAX_COMMAND_BUFFERS; i++) {
+    CommandBuffer *buf = &world->commands[i];
+    for (int j = 0; j < buf->count; j++) {
+      Command *c = &buf->commands[j];
+      switch (c->type) {
+        case COMMAND_ADD:
+          world_add_component(world, c->component, c->entity, buf->payload + c->offset);
+          break;
+        case COMMAND_REMOVE:
+          remove_component(world, c->component, c->entity);
+          break;
+        case COMMAND_DESTROY:
+          world_destroy_entity(world, c->entity);
+          break;
+      }
+    }
+    command_buffer_clear(buf);
+  }
 }
 
 
 void world_destroy(World *world) {
-  PositionComponent *p, *tmp1;
-  HASH_ITER(hh, world->positions, p, tmp1) { destroy_position(world, p); }
-
-  RotationComponent *r, *tmp2;
-  HASH_ITER(hh, world->rotations, r, tmp2) { destroy_rotation(world, r); }
-
-  ScaleComponent *s, *tmp3;
-  HASH_ITER(hh, world->scales, s, tmp3) { destroy_scale(world, s); }
-
-  MeshComponent *mesh, *tmp4;
-  HASH_ITER(hh, world->meshes, mesh, tmp4) { destroy_mesh(world, mesh); }
-
-  MaterialComponent *mat, *tmp5;
-  HASH_ITER(hh, world->materials, mat, tmp5) { destroy_material(world, mat); }
-
-  VelocityComponent *v, *tmp6;
-  HASH_ITER(hh, world->velocities, v, tmp6) { destroy_velocity(world, v); }
-
-  PathComponent *path, *tmp7;
-  HASH_ITER(hh, world->paths, path, tmp7) { destroy_path(world, path); }
-
-  SpeedComponent *speed, *tmp8;
-  HASH_ITER(hh, world->speeds, speed, tmp8) { destroy_speed(world, speed); }
-
-  ColliderComponent *collider, *tmp9;
-  HASH_ITER(hh, world->colliders, collider, tmp9) { destroy_collider(world, collider); }
-
-  MassComponent *mass, *tmp10;
-  HASH_ITER(hh, world->masses, mass, tmp10) { destroy_mass(world, mass); }
-
-  LocomotionComponent *locomotion, *tmp11;
-  HASH_ITER(hh, world->locomotions, locomotion, tmp11) { destroy_locomotion(world, locomotion); }
-
-  JumpComponent *jump, *tmp12;
-  HASH_ITER(hh, world->jumps, jump, tmp12) { destroy_jump(world, jump); }
-
-  world->next_id = 0;
+  for (int i = 0; i < COMPONENT_COUNT; i++) {
+    sparse_set_destroy(&world->components[i]);
+  }
+  for (int i = 0; i < world->query_count; i++) {
+    free(world->queries[i].entities);
+    free(world->queries[i].rows);
+  }
+  world->query_count = 0;
+
+  for (int i = 0; i < MAX_COMMAND_BUFFERS; i++) {
+    command_buffer_destroy(&world->commands[i]);
+  }
+
+  StaticColliders *sc = &world->static_colliders;
+  static_bvh_destroy(&sc->bvh);
+  free(sc->entities);
+  free(sc->bounds);
+  memset(sc, 0, sizeof(StaticColliders));
+
+  QueryColliders *qc = &world->query_colliders;
+  tree_destroy(&qc->tree);
+  free(qc->proxies);
+  memset(qc, 0, sizeof(QueryColliders));
+
+  ColliderMeshes *cm = &world->collider_meshes;
+  for (int i = 0; i < cm->count; i++) mesh_bvh_destroy(&cm->items[i]);
+  free(cm->items);
+  free(cm->ids);
+  free(cm->free_slots);
+  memset(cm, 0, sizeof(ColliderMeshes));
+
+  free(world->generations);
+  free(world->alive);
+  free(world->signatures);
+  free(world->free_slots);
+  world->generations    = NULL;
+  world->alive          = NULL;
+  world->signatures     = NULL;
+  world->free_slots     = NULL;
+  world->free_count     = 0;
+  world->slot_count     = 0;
+  world->slot_capacity  = 0;
 
   mesh_reg_destroy(&world->mesh_registry);
   mat_reg_destroy(&world->material_registry);
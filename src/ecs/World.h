@@ -4,46 +4,45 @@
 #include "maths/Maths3D.h"
 #include "scene/Registry.h"
 #include "scene/camera.h"
-#include "vendor/uthash.h"
+#include "ecs/Entity.h"
+#include "ecs/SparseSet.h"
+#include "ecs/Query.h"
+#include "ecs/CommandBuffer.h"
+#include "physics/DynamicTree.h"
+#include "physics/MeshBvh.h"
+#include "physics/StaticBvh.h"
+#include <stdint.h>
 
 #define MAX_WAYPOINTS 16
 
-typedef int Entity;
-
 typedef struct {
   Entity  entity;
   Vec3f   position;
-  UT_hash_handle hh;
 } PositionComponent;
 
 typedef struct {
   Entity  entity;
   Vec3f   rotation;
-  UT_hash_handle hh;
 } RotationComponent;
 
 typedef struct {
   Entity  entity;
   Vec3f   scale;
-  UT_hash_handle hh;
 } ScaleComponent;
 
 typedef struct {
   Entity  entity;
   int     mesh_id;
-  UT_hash_handle hh;
 } MeshComponent;
 
 typedef struct {
   Entity  entity;
   int     mat_id;
-  UT_hash_handle hh;
 } MaterialComponent;
 
 typedef struct {
   Entity  entity;
   Vec3f   velocity;
-  UT_hash_handle hh;
 } VelocityComponent;
 
 typedef struct {
@@ -58,13 +57,11 @@ typedef struct {
 typedef struct {
   Entity  entity;
   Path    path;
-  UT_hash_handle hh;
 } PathComponent;
 
 typedef struct {
   Entity  entity;
   float   speed;
-  UT_hash_handle hh;
 } SpeedComponent;
 
 typedef struct {
@@ -72,51 +69,142 @@ typedef struct {
   float   height;
 } PlayerComponent;
 
+// A box, or with `mesh` >= 0 a static triangle mesh from the world's
+// collider meshes, in which case `half_extents` only bounds it.
 typedef struct {
   Entity  entity;
   Vec3f   half_extents;
   int     is_static;
   float   restitution;
   float   friction;
-  UT_hash_handle hh;
+  int     mesh;
 } ColliderComponent;
 
+// Sleep state is kept by the physics systems: a body sleeps once it has
+// stayed near `rest_position` long enough, and only together with every
+// body of its contact island, which all share `island` (the handle of one
+// member) and `island_size` while asleep.
 typedef struct {
   Entity  entity;
   float   mass;
   Entity  grounded_entity;
-  UT_hash_handle hh;
+  Vec3f   rest_position;
+  float   sleep_time;
+  int     sleeping;
+  Entity  island;
+  int     island_size;
 } MassComponent;
 
 typedef struct {
   Entity  entity;
   float   thrust;
   float   max_speed;
-  UT_hash_handle hh;
 } LocomotionComponent;
 
 typedef struct {
   Entity  entity;
   float   jump_force;
-  UT_hash_handle hh;
 } JumpComponent;
 
+// Cached model matrix. `dirty` is set whenever the entity's position,
+// rotation or scale is written and cleared when `world` is rebuilt.
+typedef struct {
+  Entity  entity;
+  int     dirty;
+  Mat4    world;
+} TransformComponent;
+
+// Scene graph links. A parented entity's position/rotation/scale are local
+// to its parent; children form a list through next_sibling. The store is
+// kept sorted by depth so a parent always precedes its children.
+typedef struct {
+  Entity  entity;
+  Entity  parent;
+  Entity  first_child;
+  Entity  next_sibling;
+  int     depth;
+} HierarchyComponent;
+
+// Colliders that are static and have no velocity, baked into a BVH by
+// systems_bake_statics. `entities`/`bounds` list them sorted by entity so
+// a new bake can tell cheaply whether anything changed.
 typedef struct {
-  int next_id;
+  StaticBvh     bvh;
+  Entity        *entities;
+  Aabb          *bounds;
+  int           count;
+  int           capacity;
+  unsigned int  layout_version;
+  unsigned int  build_count;    // bumped whenever `bvh` is rebuilt
+} StaticColliders;
 
-  PositionComponent   *positions;
-  RotationComponent   *rotations;
-  ScaleComponent      *scales;
-  MeshComponent       *meshes;
-  MaterialComponent   *materials;
-  VelocityComponent   *velocities;
-  PathComponent       *paths;
-  SpeedComponent      *speeds;
+// Triangle BVHs of mesh colliders, indexed by ColliderComponent.mesh, in
+// the collider's local space (rotation and scale baked in, position not).
+// A slot is freed when its collider is removed or replaced, and the next
+// mesh collider reuses it. `ids` tells builds in one slot apart (0 while
+// the slot is free), so a snapshot is never restored onto the wrong mesh.
+typedef struct {
+  MeshBvh   *items;
+  uint32_t  *ids;
+  int       *free_slots;
+  int       count;          // slots handed out, free or not
+  int       free_count;
+  int       capacity;
+  uint32_t  next_id;
+} ColliderMeshes;
+
+// Every other collider, in a dynamic tree kept for the physics queries
+// (see PhysicsQuery.h). Refreshed lazily by the first query after a tick
+// or a layout change; `proxies` holds each collider query row's leaf, or
+// TREE_NULL for rows baked into `static_colliders`.
+typedef struct {
+  DynamicTree   tree;
+  int           *proxies;
+  int           capacity;
+  unsigned int  layout_version;
+  unsigned int  bake_count;
+  int           stale;
+} QueryColliders;
+
+typedef enum {
+  COMPONENT_POSITION,
+  COMPONENT_ROTATION,
+  COMPONENT_SCALE,
+  COMPONENT_MESH,
+  COMPONENT_MATERIAL,
+  COMPONENT_VELOCITY,
+  COMPONENT_PATH,
+  COMPONENT_SPEED,
+  COMPONENT_COLLIDER,
+  COMPONENT_MASS,
+  COMPONENT_LOCOMOTION,
+  COMPONENT_JUMP,
+  COMPONENT_TRANSFORM,
+  COMPONENT_HIERARCHY,
+  COMPONENT_COUNT
+} ComponentType;
+
+typedef struct {
+  // Entity slots, indexed by entity_index(). `slot_count` is the high-water
+  // mark; destroyed slots go on the free list and are handed out again with
+  // their generation bumped.
+  int                 *generations;
+  uint64_t            *alive;
+  ComponentMask       *signatures;
+  int                 *free_slots;
+  int                 free_count;
+  int                 slot_count;
+  int                 slot_capacity;
+
+  SparseSet           components[COMPONENT_COUNT];
+  Query               queries[MAX_QUERIES];
+  int                 query_count;
+  int                 hierarchy_unsorted;
+  CommandBuffer       commands[MAX_COMMAND_BUFFERS];
   PlayerComponent     player;
-  ColliderComponent   *colliders;
-  MassComponent       *masses;
-  LocomotionComponent *locomotions;
-  JumpComponent       *jumps;
+  StaticColliders     static_colliders;
+  QueryColliders      query_colliders;
+  ColliderMeshes      collider_meshes;
 
   MeshRegistry        mesh_registry;
   MaterialRegistry    material_registry;
@@ -124,8 +212,22 @@ typedef struct {
   Camera              camera;
 } World;
 
+typedef struct {
+  World   *world;
+  Query   *query;
+  int     index;
+  int     end;
+  Entity  entity;
+  void    *components[COMPONENT_COUNT];
+} QueryIter;
+
 void world_init(World *world);
+void world_reserve(World *world, int entity_count);
+void world_reserve_component(World *world, ComponentType type, int count);
+void world_clear(World *world);
 Entity world_create_entity(World *world);
+int world_is_alive(World *world, Entity e);
+int world_entity_count(World *world);
 
 void world_add_position(World *world, Entity e, Vec3f position);
 void world_add_rotation(World *world, Entity e, Vec3f rotation);
@@ -136,6 +238,8 @@ void world_add_velocity(World *world, Entity e, Vec3f velocity);
 void world_add_path(World *world, Entity e, Path path);
 void world_add_speed(World *world, Entity e, float speed);
 void world_add_collider(World *world, Entity e, Vec3f half_extents, int is_static, float restitution, float friction);
+void world_add_mesh_collider(World *world, Entity e, const Vec3f *positions, const int *indices, int index_count,
+                             Vec3f rotation, Vec3f scale, float restitution, float friction);
 void world_add_mass(World *world, Entity e, float mass);
 void world_add_locomotion(World *world, Entity e, float thrust, float max_speed);
 void world_add_jump(World *world, Entity e, float jump_force);
@@ -152,12 +256,52 @@ ColliderComponent* world_get_collider(World *world, Entity e);
 MassComponent* world_get_mass(World *world, Entity e);
 LocomotionComponent* world_get_locomotion(World *world, Entity e);
 JumpComponent* world_get_jump(World *world, Entity e);
+TransformComponent* world_get_transform_component(World *world, Entity e);
+HierarchyComponent* world_get_hierarchy(World *world, Entity e);
+
+// A child's position, rotation and scale are local to its parent. The
+// physics step works in world space, so an entity with a collider or mass
+// cannot be parented, and a parented entity cannot be given either.
+void world_set_parent(World *world, Entity child, Entity parent);
 
 void world_destroy_path(World *world, PathComponent *pc);
 
+void  world_add_component(World *world, ComponentType type, Entity e, const void *data);
+void  world_remove_component(World *world, ComponentType type, Entity e);
+void* world_get_component(World *world, ComponentType type, Entity e);
+
+CommandBuffer* world_commands(World *world, int index);
+void world_flush_commands(World *world);
+
+ComponentMask world_signature(World *world, Entity e);
+
+Query*    world_query(World *world, ComponentMask mask);
+QueryIter query_iter(World *world, ComponentMask mask);
+QueryIter query_iter_range(World *world, ComponentMask mask, int begin, int end);
+
+// Inline so system loops compile down to plain array walks.
+static inline int query_next(QueryIter *it) {
+  if (++it->index >= it->end) return 0;
+
+  Query *q = it->query;
+  int *row = &q->rows[it->index * q->width];
+  for (int col = 0; col < q->width; col++) {
+    SparseSet *set = &it->world->components[q->types[col]];
+    it->components[q->types[col]] = (char *)set->data + row[col] * set->stride;
+  }
+
+  it->entity = q->entities[it->index];
+  return 1;
+}
+
+// world_get_transform only refreshes the entity's own dirty matrix; call
+// world_update_transforms first when parents may have moved.
+void world_mark_transform_dirty(World *world, Entity e);
+void world_update_transforms(World *world);
 Mat4 world_get_transform(World *world, Entity e);
 
 void world_destroy_entity(World *world, Entity e);
+void world_destroy_entities(World *world, const Entity *entities, int count);
 void world_destroy(World *world);
 
 #endif
@@ -161,6 +161,36 @@ Mat4 mat4_rotation(Vec3f angles) {
     );
 }
 
+// Closed form of translation * mat4_rotation(rotation) * scale: six trig
+// calls and a handful of multiplies instead of four full matrix products.
+Mat4 mat4_trs(Vec3f translation, Vec3f rotation, Vec3f scale) {
+  float cx = cosf(rotation.x), sx = sinf(rotation.x);
+  float cy = cosf(rotation.y), sy = sinf(rotation.y);
+  float cz = cosf(rotation.z), sz = sinf(rotation.z);
+
+  Mat4 m;
+  m.m[0][0] = cz * cy * scale.x;
+  m.m[0][1] = (sz * cx - cz * sy * sx) * scale.y;
+  m.m[0][2] = (cz * sy * cx + sz * sx) * scale.z;
+  m.m[0][3] = translation.x;
+
+  m.m[1][0] = -sz * cy * scale.x;
+  m.m[1][1] = (cz * cx + sz * sy * sx) * scale.y;
+  m.m[1][2] = (cz * sx - sz * sy * cx) * scale.z;
+  m.m[1][3] = translation.y;
+
+  m.m[2][0] = -sy * scale.x;
+  m.m[2][1] = -cy * sx * scale.y;
+  m.m[2][2] = cy * cx * scale.z;
+  m.m[2][3] = translation.z;
+
+  m.m[3][0] = 0.0f;
+  m.m[3][1] = 0.0f;
+  m.m[3][2] = 0.0f;
+  m.m[3][3] = 1.0f;
+  return m;
+}
+
 int is_backface(Vec3f normal, Vec3f a, Vec3f camera_pos) {
   Vec3f view_dir = vec3f_sub(a, camera_pos);
   return vec3f_dot(normal, view_dir) >= 0;
@@ -49,6 +49,7 @@ Mat4 mat4_rotation_y(float angle);
 Mat4 mat4_rotation_x(float angle);
 Mat4 mat4_rotation_z(float angle);
 Mat4 mat4_rotation(Vec3f rotate);
+Mat4 mat4_trs(Vec3f translation, Vec3f rotation, Vec3f scale);
 Mat4 mat4_perspective(float fov, float aspect, float near, float far);
 Mat4 mat4_look_at(Vec3f eye, Vec3f target, Vec3f up);
 
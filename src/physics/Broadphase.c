@@ -0,0 +1,68 @@
+#include "Broadphase.h"
+
+void broadphase_init(Broadphase *bp, BroadphaseType type) {
+  bp->type = type;
+  spatial_hash_init(&bp->hash);
+  sweep_prune_init(&bp->sap);
+  tree_broadphase_init(&bp->tree);
+}
+
+// Reference broadphase: every pair with at least one dynamic body.
+static void brute_force_pairs(const BroadphaseInput *in, PairList *out) {
+  out->count = 0;
+  for (int i = 0; i < in->count; i++) {
+    for (int j = i + 1; j < in->count; j++) {
+      if (in->is_static[i] && in->is_static[j]) continue;
+      if (aabb_overlaps(&in->bounds[i], &in->bounds[j])) pair_list_push(out, i, j);
+    }
+  }
+}
+
+// The stateful broadphases always run, however few bodies there are, so
+// sweep-and-prune events stay continuous and the tree stays current.
+void broadphase_find_pairs(Broadphase *bp, const BroadphaseInput *in, PairList *out) {
+  switch (bp->type) {
+    case BROADPHASE_SPATIAL_HASH:
+      if (in->count < BROADPHASE_MIN_BODIES) brute_force_pairs(in, out);
+      else spatial_hash_pairs(&bp->hash, in, out);
+      break;
+    case BROADPHASE_SWEEP_AND_PRUNE:
+      sweep_prune_pairs(&bp->sap, in, out);
+      break;
+    case BROADPHASE_DYNAMIC_TREE:
+      tree_broadphase_pairs(&bp->tree, in, out);
+      break;
+    default:
+      brute_force_pairs(in, out);
+      break;
+  }
+}
+
+// Pairs (as ids) that began or ended overlapping in the last call. Returns
+// 0 and empty lists for broadphases that do not track pairs over time.
+int broadphase_events(const Broadphase *bp, const PairList **began, const PairList **ended) {
+  static const PairList none = { 0 };
+  if (bp->type != BROADPHASE_SWEEP_AND_PRUNE) {
+    *began = &none;
+    *ended = &none;
+    return 0;
+  }
+  *began = &bp->sap.began;
+  *ended = &bp->sap.ended;
+  return 1;
+}
+
+const char* broadphase_name(BroadphaseType type) {
+  switch (type) {
+    case BROADPHASE_SPATIAL_HASH:     return "spatial_hash";
+    case BROADPHASE_SWEEP_AND_PRUNE:  return "sweep_and_prune";
+    case BROADPHASE_DYNAMIC_TREE:     return "dynamic_tree";
+    default:                          return "brute_force";
+  }
+}
+
+void broadphase_destroy(Broadphase *bp) {
+  spatial_hash_destroy(&bp->hash);
+  sweep_prune_destroy(&bp->sap);
+  tree_broadphase_destroy(&bp->tree);
+}
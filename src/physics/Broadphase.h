@@ -0,0 +1,36 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include "physics/DynamicTree.h"
+#include "physics/PairList.h"
+#include "physics/SpatialHash.h"
+#include "physics/SweepAndPrune.h"
+
+// Below this many bodies the spatial hash falls back to testing all pairs,
+// which is cheaper than bucketing anything.
+#define BROADPHASE_MIN_BODIES 64
+
+typedef enum {
+  BROADPHASE_BRUTE_FORCE,
+  BROADPHASE_SPATIAL_HASH,
+  BROADPHASE_SWEEP_AND_PRUNE,
+  BROADPHASE_DYNAMIC_TREE
+} BroadphaseType;
+
+// Every broadphase reports each overlapping pair of bounds exactly once,
+// and may also report pairs that do not overlap. Only the state of the
+// selected type is used.
+typedef struct {
+  BroadphaseType  type;
+  SpatialHash     hash;
+  SweepAndPrune   sap;
+  TreeBroadphase  tree;
+} Broadphase;
+
+void        broadphase_init(Broadphase *bp, BroadphaseType type);
+void        broadphase_find_pairs(Broadphase *bp, const BroadphaseInput *in, PairList *out);
+int         broadphase_events(const Broadphase *bp, const PairList **began, const PairList **ended);
+const char* broadphase_name(BroadphaseType type);
+void        broadphase_destroy(Broadphase *bp);
+
+#endif
@@ -0,0 +1,572 @@
+#include "DynamicTree.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_NODES 16
+
+void tree_init(DynamicTree *tree) {
+  memset(tree, 0, sizeof(DynamicTree));
+  tree->root      = TREE_NULL;
+  tree->free_list = TREE_NULL;
+}
+
+// BOXES
+
+// Plain compares; fminf/fmaxf are library calls here because of their NaN
+// rules, and unions sit on every insert and rotation.
+static float min_f(float a, float b) { return a < b ? a : b; }
+static float max_f(float a, float b) { return a > b ? a : b; }
+
+static Aabb aabb_union(const Aabb *a, const Aabb *b) {
+  return (Aabb){
+    { min_f(a->min.x, b->min.x), min_f(a->min.y, b->min.y), min_f(a->min.z, b->min.z) },
+    { max_f(a->max.x, b->max.x), max_f(a->max.y, b->max.y), max_f(a->max.z, b->max.z) }
+  };
+}
+
+static float aabb_area(const Aabb *a) {
+  float dx = a->max.x - a->min.x, dy = a->max.y - a->min.y, dz = a->max.z - a->min.z;
+  return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+static int aabb_contains(const Aabb *outer, const Aabb *inner) {
+  return outer->min.x <= inner->min.x && outer->min.y <= inner->min.y && outer->min.z <= inner->min.z &&
+         inner->max.x <= outer->max.x && inner->max.y <= outer->max.y && inner->max.z <= outer->max.z;
+}
+
+static Aabb fatten(const Aabb *box) {
+  Vec3f m = { TREE_FAT_MARGIN, TREE_FAT_MARGIN, TREE_FAT_MARGIN };
+  return (Aabb){ vec3f_sub(box->min, m), vec3f_add(box->max, m) };
+}
+
+// Slab test. Returns the entry distance (0 when the origin is inside), or
+// -1 if the ray misses or only reaches the box beyond max_t.
+float aabb_ray(const Aabb *box, Vec3f origin, Vec3f dir, float max_t) {
+  float o[3]  = { origin.x, origin.y, origin.z };
+  float d[3]  = { dir.x, dir.y, dir.z };
+  float lo[3] = { box->min.x, box->min.y, box->min.z };
+  float hi[3] = { box->max.x, box->max.y, box->max.z };
+  float t0 = 0.0f, t1 = max_t;
+
+  for (int axis = 0; axis < 3; axis++) {
+    if (d[axis] == 0.0f) {
+      if (o[axis] < lo[axis] || o[axis] > hi[axis]) return -1.0f;
+      continue;
+    }
+    float inv = 1.0f / d[axis];
+    float near = (lo[axis] - o[axis]) * inv;
+    float far  = (hi[axis] - o[axis]) * inv;
+    if (near > far) {
+      float t = near;
+      near = far;
+      far = t;
+    }
+    if (near > t0) t0 = near;
+    if (far < t1) t1 = far;
+    if (t0 > t1) return -1.0f;
+  }
+  return t0;
+}
+
+float aabb_distance(const Aabb *box, Vec3f point) {
+  float dx = max_f(0.0f, max_f(box->min.x - point.x, point.x - box->max.x));
+  float dy = max_f(0.0f, max_f(box->min.y - point.y, point.y - box->max.y));
+  float dz = max_f(0.0f, max_f(box->min.z - point.z, point.z - box->max.z));
+  return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+// NODES
+
+static int is_leaf(const TreeNode *node) {
+  return node->child1 == TREE_NULL;
+}
+
+static int alloc_node(DynamicTree *tree) {
+  if (tree->free_list == TREE_NULL) {
+    int capacity = tree->node_capacity ? tree->node_capacity * 2 : MIN_NODES;
+    tree->nodes = realloc(tree->nodes, capacity * sizeof(TreeNode));
+    for (int i = tree->node_capacity; i < capacity; i++) {
+      tree->nodes[i].parent = i + 1 < capacity ? i + 1 : TREE_NULL;
+      tree->nodes[i].height = -1;
+    }
+    tree->free_list = tree->node_capacity;
+    tree->node_capacity = capacity;
+  }
+
+  int index = tree->free_list;
+  TreeNode *node = &tree->nodes[index];
+  tree->free_list = node->parent;
+  node->parent = TREE_NULL;
+  node->child1 = TREE_NULL;
+  node->child2 = TREE_NULL;
+  node->height = 0;
+  node->user   = -1;
+  tree->node_count++;
+  return index;
+}
+
+static void free_node(DynamicTree *tree, int index) {
+  tree->nodes[index].parent = tree->free_list;
+  tree->nodes[index].height = -1;
+  tree->free_list = index;
+  tree->node_count--;
+}
+
+static void push(DynamicTree *tree, int *top, int index) {
+  if (*top == tree->stack_capacity) {
+    tree->stack_capacity = tree->stack_capacity ? tree->stack_capacity * 2 : 64;
+    tree->stack = realloc(tree->stack, tree->stack_capacity * sizeof(int));
+  }
+  tree->stack[(*top)++] = index;
+}
+
+static void refit(DynamicTree *tree, int index) {
+  TreeNode *n = &tree->nodes[index];
+  TreeNode *c1 = &tree->nodes[n->child1], *c2 = &tree->nodes[n->child2];
+  n->box = aabb_union(&c1->box, &c2->box);
+  n->height = 1 + (c1->height > c2->height ? c1->height : c2->height);
+}
+
+static void replace_child(DynamicTree *tree, int parent, int old_child, int new_child) {
+  if (parent == TREE_NULL) {
+    tree->root = new_child;
+  } else if (tree->nodes[parent].child1 == old_child) {
+    tree->nodes[parent].child1 = new_child;
+  } else {
+    tree->nodes[parent].child2 = new_child;
+  }
+}
+
+// ROTATIONS
+
+static void set_child(DynamicTree *tree, int parent, int slot, int child) {
+  if (slot == 1) {
+    tree->nodes[parent].child1 = child;
+  } else {
+    tree->nodes[parent].child2 = child;
+  }
+  tree->nodes[child].parent = parent;
+}
+
+// Swaps `x` (a child of node `a`) with grandchild `y` under `a`'s other
+// child, then refits that child.
+static void swap_down(DynamicTree *tree, int a, int x, int y) {
+  int holder = tree->nodes[y].parent;
+  int x_slot = tree->nodes[a].child1 == x ? 1 : 2;
+  int y_slot = tree->nodes[holder].child1 == y ? 1 : 2;
+  set_child(tree, a, x_slot, y);
+  set_child(tree, holder, y_slot, x);
+  refit(tree, holder);
+}
+
+// Swaps grandchildren `x` and `y`, which sit under different children of
+// the same node, and refits both of those children.
+static void swap_across(DynamicTree *tree, int x, int y) {
+  int px = tree->nodes[x].parent, py = tree->nodes[y].parent;
+  int x_slot = tree->nodes[px].child1 == x ? 1 : 2;
+  int y_slot = tree->nodes[py].child1 == y ? 1 : 2;
+  set_child(tree, px, x_slot, y);
+  set_child(tree, py, y_slot, x);
+  refit(tree, px);
+  refit(tree, py);
+}
+
+static float union_area(DynamicTree *tree, int x, int y) {
+  Aabb u = aabb_union(&tree->nodes[x].box, &tree->nodes[y].box);
+  return aabb_area(&u);
+}
+
+// Tries every swap of a child of `a` with a grandchild on the other side
+// (and of two grandchildren across sides) and applies the one that shrinks
+// the surface area of the internal nodes below `a` the most. `a`'s own box
+// is unchanged by any of them. Rotating by area rather than by height keeps
+// odd boxes, like one huge static floor, from being pushed deep into the
+// tree where they would bloat every ancestor.
+static void rotate(DynamicTree *tree, int a) {
+  TreeNode *na = &tree->nodes[a];
+  int b = na->child1, c = na->child2;
+  TreeNode *nb = &tree->nodes[b], *nc = &tree->nodes[c];
+  if (is_leaf(nb) && is_leaf(nc)) return;
+
+  float area_b = is_leaf(nb) ? 0.0f : aabb_area(&nb->box);
+  float area_c = is_leaf(nc) ? 0.0f : aabb_area(&nc->box);
+  float best = 0.0f;
+  int x = TREE_NULL, y = TREE_NULL, across = 0;
+
+  if (!is_leaf(nc)) {
+    int f = nc->child1, g = nc->child2;
+    float cost_bf = union_area(tree, b, g) - area_c;
+    float cost_bg = union_area(tree, b, f) - area_c;
+    if (cost_bf < best) { best = cost_bf; x = b; y = f; }
+    if (cost_bg < best) { best = cost_bg; x = b; y = g; }
+  }
+  if (!is_leaf(nb)) {
+    int d = nb->child1, e = nb->child2;
+    float cost_cd = union_area(tree, c, e) - area_b;
+    float cost_ce = union_area(tree, c, d) - area_b;
+    if (cost_cd < best) { best = cost_cd; x = c; y = d; }
+    if (cost_ce < best) { best = cost_ce; x = c; y = e; }
+
+    if (!is_leaf(nc)) {
+      int f = nc->child1, g = nc->child2;
+      float cost_df = union_area(tree, f, e) + union_area(tree, d, g) - area_b - area_c;
+      float cost_dg = union_area(tree, g, e) + union_area(tree, f, d) - area_b - area_c;
+      if (cost_df < best) { best = cost_df; x = d; y = f; across = 1; }
+      if (cost_dg < best) { best = cost_dg; x = d; y = g; across = 1; }
+    }
+  }
+  if (x == TREE_NULL) return;
+
+  if (across) {
+    swap_across(tree, x, y);
+  } else {
+    swap_down(tree, a, x, y);
+  }
+  refit(tree, a);
+}
+
+static void refit_up(DynamicTree *tree, int index) {
+  while (index != TREE_NULL) {
+    refit(tree, index);
+    rotate(tree, index);
+    index = tree->nodes[index].parent;
+  }
+}
+
+// INSERT / REMOVE
+
+// Walks down choosing the child whose enlargement costs least; stops when
+// making a new parent here is cheaper than descending.
+static int find_sibling(DynamicTree *tree, const Aabb *box) {
+  int index = tree->root;
+  while (!is_leaf(&tree->nodes[index])) {
+    TreeNode *n = &tree->nodes[index];
+    Aabb combined = aabb_union(&n->box, box);
+    float combined_area = aabb_area(&combined);
+    float cost = 2.0f * combined_area;
+    float inherited = 2.0f * (combined_area - aabb_area(&n->box));
+
+    float child_cost[2];
+    int children[2] = { n->child1, n->child2 };
+    for (int k = 0; k < 2; k++) {
+      TreeNode *c = &tree->nodes[children[k]];
+      Aabb grown = aabb_union(box, &c->box);
+      child_cost[k] = aabb_area(&grown) + inherited;
+      if (!is_leaf(c)) child_cost[k] -= aabb_area(&c->box);
+    }
+
+    if (cost < child_cost[0] && cost < child_cost[1]) break;
+    index = child_cost[0] < child_cost[1] ? children[0] : children[1];
+  }
+  return index;
+}
+
+static void insert_leaf(DynamicTree *tree, int leaf) {
+  if (tree->root == TREE_NULL) {
+    tree->root = leaf;
+    tree->nodes[leaf].parent = TREE_NULL;
+    return;
+  }
+
+  int sibling = find_sibling(tree, &tree->nodes[leaf].box);
+  int old_parent = tree->nodes[sibling].parent;
+  int parent = alloc_node(tree);
+
+  TreeNode *np = &tree->nodes[parent];
+  np->parent = old_parent;
+  np->child1 = sibling;
+  np->child2 = leaf;
+  replace_child(tree, old_parent, sibling, parent);
+  tree->nodes[sibling].parent = parent;
+  tree->nodes[leaf].parent = parent;
+
+  refit_up(tree, parent);
+}
+
+static void remove_leaf(DynamicTree *tree, int leaf) {
+  if (leaf == tree->root) {
+    tree->root = TREE_NULL;
+    return;
+  }
+
+  int parent = tree->nodes[leaf].parent;
+  int grand = tree->nodes[parent].parent;
+  int sibling = tree->nodes[parent].child1 == leaf ? tree->nodes[parent].child2 : tree->nodes[parent].child1;
+
+  replace_child(tree, grand, parent, sibling);
+  tree->nodes[sibling].parent = grand;
+  free_node(tree, parent);
+
+  // Removal only shrinks boxes, so a plain refit is enough here.
+  for (int index = grand; index != TREE_NULL; index = tree->nodes[index].parent) {
+    refit(tree, index);
+  }
+}
+
+int tree_insert(DynamicTree *tree, const Aabb *box, int user) {
+  int leaf = alloc_node(tree);
+  tree->nodes[leaf].box  = fatten(box);
+  tree->nodes[leaf].user = user;
+  insert_leaf(tree, leaf);
+  return leaf;
+}
+
+void tree_remove(DynamicTree *tree, int proxy) {
+  remove_leaf(tree, proxy);
+  free_node(tree, proxy);
+}
+
+// Reinserts the leaf only when `box` has left its fat bounds. Returns 1 if
+// it did. The new fat box is also stretched along the way the body went
+// since its last insert, so a body moving steadily (falling, sliding) is
+// reinserted every few calls instead of every call.
+int tree_move(DynamicTree *tree, int proxy, const Aabb *box) {
+  Aabb *fat = &tree->nodes[proxy].box;
+  if (aabb_contains(fat, box)) return 0;
+
+  Vec3f moved = vec3f_scale(vec3f_sub(vec3f_add(box->min, box->max), vec3f_add(fat->min, fat->max)), 0.5f);
+  remove_leaf(tree, proxy);
+  *fat = fatten(box);
+  fat->min = vec3f_add(fat->min, (Vec3f){ min_f(moved.x, 0.0f), min_f(moved.y, 0.0f), min_f(moved.z, 0.0f) });
+  fat->max = vec3f_add(fat->max, (Vec3f){ max_f(moved.x, 0.0f), max_f(moved.y, 0.0f), max_f(moved.z, 0.0f) });
+  insert_leaf(tree, proxy);
+  return 1;
+}
+
+int tree_height(const DynamicTree *tree) {
+  return tree->root == TREE_NULL ? 0 : tree->nodes[tree->root].height;
+}
+
+void tree_clear(DynamicTree *tree) {
+  TreeNode *nodes = tree->nodes;
+  int capacity = tree->node_capacity;
+  int *stack = tree->stack;
+  int stack_capacity = tree->stack_capacity;
+
+  tree_init(tree);
+  tree->nodes = nodes;
+  tree->node_capacity = capacity;
+  tree->stack = stack;
+  tree->stack_capacity = stack_capacity;
+
+  for (int i = 0; i < capacity; i++) {
+    nodes[i].parent = i + 1 < capacity ? i + 1 : TREE_NULL;
+    nodes[i].height = -1;
+  }
+  tree->free_list = capacity ? 0 : TREE_NULL;
+}
+
+void tree_destroy(DynamicTree *tree) {
+  free(tree->nodes);
+  free(tree->stack);
+  tree_init(tree);
+}
+
+// QUERIES
+
+// Callbacks must not modify the tree.
+void tree_query(DynamicTree *tree, const Aabb *box, TreeQueryFn fn, void *ctx) {
+  if (tree->root == TREE_NULL) return;
+
+  int top = 0;
+  push(tree, &top, tree->root);
+  while (top > 0) {
+    TreeNode *n = &tree->nodes[tree->stack[--top]];
+    if (!aabb_overlaps(&n->box, box)) continue;
+
+    if (is_leaf(n)) {
+      if (!fn(ctx, n->user)) return;
+    } else {
+      push(tree, &top, n->child1);
+      push(tree, &top, n->child2);
+    }
+  }
+}
+
+// Closest hit along origin + t * dir for t in [0, max_t]. Returns the
+// leaf's user value (and t in t_out), or -1 if nothing was hit.
+int tree_raycast(DynamicTree *tree, Vec3f origin, Vec3f dir, float max_t,
+                 TreeRayFn fn, void *ctx, float *t_out) {
+  int hit = -1;
+  if (tree->root == TREE_NULL) return hit;
+
+  int top = 0;
+  push(tree, &top, tree->root);
+  while (top > 0) {
+    TreeNode *n = &tree->nodes[tree->stack[--top]];
+    if (aabb_ray(&n->box, origin, dir, max_t) < 0.0f) continue;
+
+    if (is_leaf(n)) {
+      float t = fn(ctx, n->user, origin, dir, max_t);
+      if (t >= 0.0f && t <= max_t) {
+        max_t = t;
+        hit = n->user;
+      }
+      continue;
+    }
+
+    // Nearer child on top of the stack, so early hits prune the far one.
+    float t1 = aabb_ray(&tree->nodes[n->child1].box, origin, dir, max_t);
+    float t2 = aabb_ray(&tree->nodes[n->child2].box, origin, dir, max_t);
+    int first = n->child1, second = n->child2;
+    if (t2 >= 0.0f && (t1 < 0.0f || t2 < t1)) {
+      first = n->child2;
+      second = n->child1;
+      float t = t1;
+      t1 = t2;
+      t2 = t;
+    }
+    if (t2 >= 0.0f) push(tree, &top, second);
+    if (t1 >= 0.0f) push(tree, &top, first);
+  }
+
+  if (hit >= 0 && t_out) *t_out = max_t;
+  return hit;
+}
+
+// Closest hits of every lane of the packet. Stack entries are pairs of a
+// node and the lanes that reached its parent; a node keeps only the lanes
+// that reach it too, so shortened lanes drop out of far subtrees.
+void tree_raycast_packet(DynamicTree *tree, RayPacket *packet, RayHitFn fn, void *ctx) {
+  if (tree->root == TREE_NULL || packet->count == 0) return;
+
+  int top = 0;
+  push(tree, &top, tree->root);
+  push(tree, &top, (int)ray_packet_all(packet));
+  while (top > 0) {
+    unsigned int lanes = (unsigned int)tree->stack[--top];
+    TreeNode *n = &tree->nodes[tree->stack[--top]];
+    lanes = ray_packet_test(packet, &n->box, lanes);
+    if (!lanes) continue;
+
+    if (is_leaf(n)) {
+      ray_packet_hit(packet, lanes, n->user, fn, ctx);
+      continue;
+    }
+
+    int first = n->child1, second = n->child2;
+    if (ray_packet_prefers(packet, lanes, &tree->nodes[first].box, &tree->nodes[second].box)) {
+      first = n->child2;
+      second = n->child1;
+    }
+    push(tree, &top, second);
+    push(tree, &top, (int)lanes);
+    push(tree, &top, first);
+    push(tree, &top, (int)lanes);
+  }
+}
+
+// Leaf whose shape is closest to `point` within max_dist. Returns its user
+// value (and the distance in dist_out), or -1 if none is in range.
+int tree_nearest(DynamicTree *tree, Vec3f point, float max_dist,
+                 TreeDistanceFn fn, void *ctx, float *dist_out) {
+  int best = -1;
+  if (tree->root == TREE_NULL) return best;
+
+  int top = 0;
+  push(tree, &top, tree->root);
+  while (top > 0) {
+    TreeNode *n = &tree->nodes[tree->stack[--top]];
+    if (aabb_distance(&n->box, point) > max_dist) continue;
+
+    if (is_leaf(n)) {
+      float d = fn(ctx, n->user, point);
+      if (d <= max_dist) {
+        max_dist = d;
+        best = n->user;
+      }
+      continue;
+    }
+
+    float d1 = aabb_distance(&tree->nodes[n->child1].box, point);
+    float d2 = aabb_distance(&tree->nodes[n->child2].box, point);
+    if (d1 <= d2) {
+      push(tree, &top, n->child2);
+      push(tree, &top, n->child1);
+    } else {
+      push(tree, &top, n->child1);
+      push(tree, &top, n->child2);
+    }
+  }
+
+  if (best >= 0 && dist_out) *dist_out = max_dist;
+  return best;
+}
+
+// BROADPHASE
+
+void tree_broadphase_init(TreeBroadphase *tb) {
+  memset(tb, 0, sizeof(TreeBroadphase));
+  tree_init(&tb->statics);
+  tree_init(&tb->dynamics);
+}
+
+typedef struct {
+  const BroadphaseInput *in;
+  PairList              *out;
+  int                   body;
+  int                   dynamic_tree;
+} PairQuery;
+
+static int collect_pair(void *ctx, int other) {
+  PairQuery *q = ctx;
+  // Both bodies of a dynamic pair query each other; the lower index keeps it.
+  if (q->dynamic_tree && other <= q->body) return 1;
+  if (aabb_overlaps(&q->in->bounds[q->body], &q->in->bounds[other])) {
+    pair_list_push(q->out, q->body, other);
+  }
+  return 1;
+}
+
+static void rebuild_trees(TreeBroadphase *tb, const BroadphaseInput *in, int static_count) {
+  if (in->count > tb->capacity) {
+    tb->capacity = in->count;
+    tb->proxies = realloc(tb->proxies, tb->capacity * sizeof(int));
+  }
+  tree_clear(&tb->statics);
+  tree_clear(&tb->dynamics);
+
+  for (int i = 0; i < in->count; i++) {
+    DynamicTree *tree = in->is_static[i] ? &tb->statics : &tb->dynamics;
+    tb->proxies[i] = tree_insert(tree, &in->bounds[i], i);
+  }
+
+  tb->count          = in->count;
+  tb->static_count   = static_count;
+  tb->layout_version = in->layout_version;
+  tb->ready          = 1;
+}
+
+void tree_broadphase_pairs(TreeBroadphase *tb, const BroadphaseInput *in, PairList *out) {
+  out->count = 0;
+
+  int static_count = 0;
+  for (int i = 0; i < in->count; i++) static_count += in->is_static[i] != 0;
+
+  if (!tb->ready || tb->layout_version != in->layout_version ||
+      tb->count != in->count || tb->static_count != static_count) {
+    rebuild_trees(tb, in, static_count);
+  } else {
+    for (int i = 0; i < in->count; i++) {
+      if (!in->is_static[i]) tree_move(&tb->dynamics, tb->proxies[i], &in->bounds[i]);
+    }
+  }
+
+  PairQuery q = { in, out, 0, 0 };
+  for (int i = 0; i < in->count; i++) {
+    if (in->is_static[i]) continue;
+    q.body = i;
+    q.dynamic_tree = 0;
+    tree_query(&tb->statics, &in->bounds[i], collect_pair, &q);
+    q.dynamic_tree = 1;
+    tree_query(&tb->dynamics, &in->bounds[i], collect_pair, &q);
+  }
+}
+
+void tree_broadphase_destroy(TreeBroadphase *tb) {
+  tree_destroy(&tb->statics);
+  tree_destroy(&tb->dynamics);
+  free(tb->proxies);
+  tree_broadphase_init(tb);
+}
@@ -0,0 +1,80 @@
+#ifndef DYNAMIC_TREE_H
+#define DYNAMIC_TREE_H
+
+#include "physics/PairList.h"
+#include "physics/RayPacket.h"
+
+// Leaves store bounds fattened by this much, so a body can move that far
+// before it has to be reinserted.
+#define TREE_FAT_MARGIN 0.2f
+
+#define TREE_NULL (-1)
+
+typedef struct {
+  Aabb  box;
+  int   parent;     // next free node while on the free list
+  int   child1;
+  int   child2;
+  int   height;     // 0 for leaves, -1 for free nodes
+  int   user;
+} TreeNode;
+
+// Dynamic bounding-volume tree. Leaves are inserted next to the sibling
+// that grows the tree's surface area least, and ancestors are rotated on
+// the way back up whenever swapping a child with a grandchild shrinks the
+// nodes below them, so the tree stays tight without periodic rebuilds.
+typedef struct {
+  TreeNode  *nodes;
+  int       root;
+  int       node_count;
+  int       node_capacity;
+  int       free_list;
+  int       *stack;
+  int       stack_capacity;
+} DynamicTree;
+
+// Returns 0 to stop the query.
+typedef int   (*TreeQueryFn)(void *ctx, int user);
+// Returns the distance along the ray to the leaf's shape, or a negative
+// value on a miss. Hits shorten the ray for the rest of the traversal.
+typedef float (*TreeRayFn)(void *ctx, int user, Vec3f origin, Vec3f dir, float max_t);
+// Returns the distance from the point to the leaf's shape.
+typedef float (*TreeDistanceFn)(void *ctx, int user, Vec3f point);
+
+void tree_init(DynamicTree *tree);
+void tree_clear(DynamicTree *tree);
+void tree_destroy(DynamicTree *tree);
+
+int  tree_insert(DynamicTree *tree, const Aabb *box, int user);
+void tree_remove(DynamicTree *tree, int proxy);
+int  tree_move(DynamicTree *tree, int proxy, const Aabb *box);
+int  tree_height(const DynamicTree *tree);
+
+void  tree_query(DynamicTree *tree, const Aabb *box, TreeQueryFn fn, void *ctx);
+int   tree_raycast(DynamicTree *tree, Vec3f origin, Vec3f dir, float max_t,
+                   TreeRayFn fn, void *ctx, float *t_out);
+void  tree_raycast_packet(DynamicTree *tree, RayPacket *packet, RayHitFn fn, void *ctx);
+int   tree_nearest(DynamicTree *tree, Vec3f point, float max_dist,
+                   TreeDistanceFn fn, void *ctx, float *dist_out);
+
+float aabb_ray(const Aabb *box, Vec3f origin, Vec3f dir, float max_t);
+float aabb_distance(const Aabb *box, Vec3f point);
+
+// Broadphase over two trees: statics are inserted once per layout,
+// dynamic leaves are only reinserted once they leave their fat bounds.
+typedef struct {
+  DynamicTree   statics;
+  DynamicTree   dynamics;
+  int           *proxies;
+  int           capacity;
+  int           count;
+  int           static_count;
+  unsigned int  layout_version;
+  int           ready;
+} TreeBroadphase;
+
+void tree_broadphase_init(TreeBroadphase *tb);
+void tree_broadphase_pairs(TreeBroadphase *tb, const BroadphaseInput *in, PairList *out);
+void tree_broadphase_destroy(TreeBroadphase *tb);
+
+#endif
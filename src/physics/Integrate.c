@@ -0,0 +1,149 @@
+#include "Integrate.h"
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef void (*IntegrateKernel)(IntegrateBatch *b, int begin, float gravity, float dt);
+
+static void integrate_scalar(IntegrateBatch *b, int begin, float gravity, float dt) {
+  for (int i = begin; i < b->count; i++) {
+    float vx = b->vx[i] * b->damping[i];
+    float vy = b->vy[i] - b->gravity_scale[i] * (gravity * dt);
+    float vz = b->vz[i] * b->damping[i];
+
+    if (fabsf(vx) < b->threshold[i]) vx = 0.0f;
+    if (fabsf(vy) < b->threshold[i]) vy = 0.0f;
+
+    b->vx[i] = vx;
+    b->vy[i] = vy;
+    b->vz[i] = vz;
+    b->px[i] += vx * dt;
+    b->py[i] += vy * dt;
+    b->pz[i] += vz * dt;
+  }
+}
+
+#ifdef HAVE_X86
+static void integrate_sse(IntegrateBatch *b, int begin, float gravity, float dt) {
+  __m128 g     = _mm_set1_ps(gravity * dt);
+  __m128 step  = _mm_set1_ps(dt);
+  __m128 sign  = _mm_set1_ps(-0.0f);
+
+  int i = begin;
+  for (; i + 4 <= b->count; i += 4) {
+    __m128 damp = _mm_loadu_ps(b->damping + i);
+    __m128 thr  = _mm_loadu_ps(b->threshold + i);
+    __m128 vx   = _mm_mul_ps(_mm_loadu_ps(b->vx + i), damp);
+    __m128 vy   = _mm_sub_ps(_mm_loadu_ps(b->vy + i), _mm_mul_ps(_mm_loadu_ps(b->gravity_scale + i), g));
+    __m128 vz   = _mm_mul_ps(_mm_loadu_ps(b->vz + i), damp);
+
+    vx = _mm_andnot_ps(_mm_cmplt_ps(_mm_andnot_ps(sign, vx), thr), vx);
+    vy = _mm_andnot_ps(_mm_cmplt_ps(_mm_andnot_ps(sign, vy), thr), vy);
+
+    _mm_storeu_ps(b->vx + i, vx);
+    _mm_storeu_ps(b->vy + i, vy);
+    _mm_storeu_ps(b->vz + i, vz);
+    _mm_storeu_ps(b->px + i, _mm_add_ps(_mm_loadu_ps(b->px + i), _mm_mul_ps(vx, step)));
+    _mm_storeu_ps(b->py + i, _mm_add_ps(_mm_loadu_ps(b->py + i), _mm_mul_ps(vy, step)));
+    _mm_storeu_ps(b->pz + i, _mm_add_ps(_mm_loadu_ps(b->pz + i), _mm_mul_ps(vz, step)));
+  }
+  integrate_scalar(b, i, gravity, dt);
+}
+
+__attribute__((target("avx2")))
+static void integrate_avx2(IntegrateBatch *b, int begin, float gravity, float dt) {
+  __m256 g     = _mm256_set1_ps(gravity * dt);
+  __m256 step  = _mm256_set1_ps(dt);
+  __m256 sign  = _mm256_set1_ps(-0.0f);
+
+  int i = begin;
+  for (; i + 8 <= b->count; i += 8) {
+    __m256 damp = _mm256_loadu_ps(b->damping + i);
+    __m256 thr  = _mm256_loadu_ps(b->threshold + i);
+    __m256 vx   = _mm256_mul_ps(_mm256_loadu_ps(b->vx + i), damp);
+    __m256 vy   = _mm256_sub_ps(_mm256_loadu_ps(b->vy + i), _mm256_mul_ps(_mm256_loadu_ps(b->gravity_scale + i), g));
+    __m256 vz   = _mm256_mul_ps(_mm256_loadu_ps(b->vz + i), damp);
+
+    vx = _mm256_andnot_ps(_mm256_cmp_ps(_mm256_andnot_ps(sign, vx), thr, _CMP_LT_OQ), vx);
+    vy = _mm256_andnot_ps(_mm256_cmp_ps(_mm256_andnot_ps(sign, vy), thr, _CMP_LT_OQ), vy);
+
+    _mm256_storeu_ps(b->vx + i, vx);
+    _mm256_storeu_ps(b->vy + i, vy);
+    _mm256_storeu_ps(b->vz + i, vz);
+    _mm256_storeu_ps(b->px + i, _mm256_add_ps(_mm256_loadu_ps(b->px + i), _mm256_mul_ps(vx, step)));
+    _mm256_storeu_ps(b->py + i, _mm256_add_ps(_mm256_loadu_ps(b->py + i), _mm256_mul_ps(vy, step)));
+    _mm256_storeu_ps(b->pz + i, _mm256_add_ps(_mm256_loadu_ps(b->pz + i), _mm256_mul_ps(vz, step)));
+  }
+  integrate_sse(b, i, gravity, dt);
+}
+#endif
+
+#ifdef HAVE_NEON
+static void integrate_neon(IntegrateBatch *b, int begin, float gravity, float dt) {
+  float32x4_t g    = vdupq_n_f32(gravity * dt);
+  float32x4_t step = vdupq_n_f32(dt);
+
+  int i = begin;
+  for (; i + 4 <= b->count; i += 4) {
+    float32x4_t damp = vld1q_f32(b->damping + i);
+    float32x4_t thr  = vld1q_f32(b->threshold + i);
+    float32x4_t vx   = vmulq_f32(vld1q_f32(b->vx + i), damp);
+    float32x4_t vy   = vsubq_f32(vld1q_f32(b->vy + i), vmulq_f32(vld1q_f32(b->gravity_scale + i), g));
+    float32x4_t vz   = vmulq_f32(vld1q_f32(b->vz + i), damp);
+
+    vx = vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(vx), vcltq_f32(vabsq_f32(vx), thr)));
+    vy = vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(vy), vcltq_f32(vabsq_f32(vy), thr)));
+
+    vst1q_f32(b->vx + i, vx);
+    vst1q_f32(b->vy + i, vy);
+    vst1q_f32(b->vz + i, vz);
+    vst1q_f32(b->px + i, vaddq_f32(vld1q_f32(b->px + i), vmulq_f32(vx, step)));
+    vst1q_f32(b->py + i, vaddq_f32(vld1q_f32(b->py + i), vmulq_f32(vy, step)));
+    vst1q_f32(b->pz + i, vaddq_f32(vld1q_f32(b->pz + i), vmulq_f32(vz, step)));
+  }
+  integrate_scalar(b, i, gravity, dt);
+}
+#endif
+
+static IntegrateKernel kernel = NULL;
+static const char *kernel_name = "scalar";
+
+static void select_kernel(IntegrateBackend backend) {
+  kernel = integrate_scalar;
+  kernel_name = "scalar";
+  if (backend == INTEGRATE_SCALAR) return;
+
+#ifdef HAVE_X86
+  __builtin_cpu_init();
+  if ((backend == INTEGRATE_AUTO || backend == INTEGRATE_AVX2) && __builtin_cpu_supports("avx2")) {
+    kernel = integrate_avx2;
+    kernel_name = "avx2";
+  } else if (__builtin_cpu_supports("sse2")) {
+    kernel = integrate_sse;
+    kernel_name = "sse";
+  }
+#elif defined(HAVE_NEON)
+  kernel = integrate_neon;
+  kernel_name = "neon";
+#endif
+}
+
+void integrate_set_backend(IntegrateBackend backend) {
+  select_kernel(backend);
+}
+
+const char* integrate_backend_name(void) {
+  if (!kernel) select_kernel(INTEGRATE_AUTO);
+  return kernel_name;
+}
+
+void integrate_batch(IntegrateBatch *b, float gravity, float dt) {
+  if (!kernel) select_kernel(INTEGRATE_AUTO);
+  kernel(b, 0, gravity, dt);
+}
@@ -0,0 +1,32 @@
+#ifndef INTEGRATE_H
+#define INTEGRATE_H
+
+// Batched body integration over SoA arrays. One pass applies, per body:
+//   vy -= gravity_scale * gravity * dt
+//   vx, vz *= damping
+//   vx, vy snap to zero when |v| < threshold
+//   p += v * dt
+// gravity_scale/damping/threshold encode airborne vs grounded bodies, so the
+// kernel itself is branch-free and vectorises 4 or 8 bodies at a time.
+typedef struct {
+  float *px, *py, *pz;
+  float *vx, *vy, *vz;
+  float *gravity_scale;
+  float *damping;
+  float *threshold;
+  int   count;
+} IntegrateBatch;
+
+typedef enum {
+  INTEGRATE_AUTO,
+  INTEGRATE_SCALAR,
+  INTEGRATE_SSE,
+  INTEGRATE_AVX2,
+  INTEGRATE_NEON
+} IntegrateBackend;
+
+void        integrate_batch(IntegrateBatch *b, float gravity, float dt);
+void        integrate_set_backend(IntegrateBackend backend);
+const char* integrate_backend_name(void);
+
+#endif
@@ -0,0 +1,466 @@
+#include "MeshBvh.h"
+#include "core/Trace.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define QUANT_MAX 65535.0f
+// Edge axes only beat face axes when this much shallower.
+#define EDGE_BIAS 1.05f
+
+static Vec3f sub3(Vec3f a, Vec3f b) { return (Vec3f){ a.x - b.x, a.y - b.y, a.z - b.z }; }
+static float dot3(Vec3f a, Vec3f b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static Vec3f neg3(Vec3f a) { return (Vec3f){ -a.x, -a.y, -a.z }; }
+
+static Vec3f cross3(Vec3f a, Vec3f b) {
+  return (Vec3f){ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+static Vec3f min3(Vec3f a, Vec3f b) {
+  return (Vec3f){ a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z };
+}
+
+static Vec3f max3(Vec3f a, Vec3f b) {
+  return (Vec3f){ a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z };
+}
+
+static float axis_value(Vec3f v, int axis) {
+  return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+// QUANTIZATION
+
+static uint16_t quantize(float v, float min, float inv_step, int round_up) {
+  float q = (v - min) * inv_step;
+  q = round_up ? ceilf(q) + 1.0f : floorf(q) - 1.0f;
+  if (q < 0.0f) q = 0.0f;
+  if (q > QUANT_MAX) q = QUANT_MAX;
+  return (uint16_t)q;
+}
+
+static void quantize_box(const MeshBvh *bvh, const Aabb *box, uint16_t *lo, uint16_t *hi) {
+  lo[0] = quantize(box->min.x, bvh->bounds.min.x, bvh->inv_step.x, 0);
+  lo[1] = quantize(box->min.y, bvh->bounds.min.y, bvh->inv_step.y, 0);
+  lo[2] = quantize(box->min.z, bvh->bounds.min.z, bvh->inv_step.z, 0);
+  hi[0] = quantize(box->max.x, bvh->bounds.min.x, bvh->inv_step.x, 1);
+  hi[1] = quantize(box->max.y, bvh->bounds.min.y, bvh->inv_step.y, 1);
+  hi[2] = quantize(box->max.z, bvh->bounds.min.z, bvh->inv_step.z, 1);
+}
+
+static Aabb node_box(const MeshBvh *bvh, const MeshNode *n) {
+  const Vec3f *m = &bvh->bounds.min, *s = &bvh->step;
+  return (Aabb){
+    { m->x + n->lo[0] * s->x, m->y + n->lo[1] * s->y, m->z + n->lo[2] * s->z },
+    { m->x + n->hi[0] * s->x, m->y + n->hi[1] * s->y, m->z + n->hi[2] * s->z }
+  };
+}
+
+// BUILD
+
+typedef struct {
+  const Vec3f *triangles;   // scaled, three vertices each, in input order
+  Vec3f       *centers;
+  int         *order;
+} BuildState;
+
+// Partially sorts order[lo, hi) so order[nth] holds the triangle whose
+// centre would be there if fully sorted along `axis`.
+static void select_nth(const Vec3f *centers, int *order, int lo, int hi, int nth, int axis) {
+  while (hi - lo > 1) {
+    float pivot = axis_value(centers[order[lo + (hi - lo) / 2]], axis);
+    int i = lo, j = hi - 1;
+    while (i <= j) {
+      while (axis_value(centers[order[i]], axis) < pivot) i++;
+      while (axis_value(centers[order[j]], axis) > pivot) j--;
+      if (i <= j) {
+        int t = order[i];
+        order[i++] = order[j];
+        order[j--] = t;
+      }
+    }
+    if (nth <= j) {
+      hi = j + 1;
+    } else if (nth >= i) {
+      lo = i;
+    } else {
+      return;
+    }
+  }
+}
+
+static int build_node(MeshBvh *bvh, BuildState *b, int begin, int end) {
+  int index = bvh->node_count++;
+
+  const Vec3f *t = b->triangles + b->order[begin] * 3;
+  Aabb box = { min3(min3(t[0], t[1]), t[2]), max3(max3(t[0], t[1]), t[2]) };
+  Vec3f lo = b->centers[b->order[begin]], hi = lo;
+  for (int i = begin + 1; i < end; i++) {
+    t = b->triangles + b->order[i] * 3;
+    box.min = min3(box.min, min3(min3(t[0], t[1]), t[2]));
+    box.max = max3(box.max, max3(max3(t[0], t[1]), t[2]));
+    lo = min3(lo, b->centers[b->order[i]]);
+    hi = max3(hi, b->centers[b->order[i]]);
+  }
+  quantize_box(bvh, &box, bvh->nodes[index].lo, bvh->nodes[index].hi);
+
+  if (end - begin <= MESH_LEAF_SIZE) {
+    bvh->nodes[index].data = ~(begin * 8 + (end - begin));
+    return index;
+  }
+
+  Vec3f extent = sub3(hi, lo);
+  int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+  int mid = begin + (end - begin) / 2;
+  select_nth(b->centers, b->order, begin, end, mid, axis);
+
+  build_node(bvh, b, begin, mid);
+  int second = build_node(bvh, b, mid, end);
+  bvh->nodes[index].data = second;
+  return index;
+}
+
+// `bvh` must be zeroed or hold an earlier build, which is released.
+void mesh_bvh_build(MeshBvh *bvh, const Vec3f *positions, const int *indices, int index_count, Mat4 transform) {
+  TRACE_FN();
+  mesh_bvh_destroy(bvh);
+  int count = index_count / 3;
+  if (count <= 0) return;
+
+  Vec3f *triangles = malloc(count * 3 * sizeof(Vec3f));
+  BuildState b = { triangles, malloc(count * sizeof(Vec3f)), malloc(count * sizeof(int)) };
+
+  for (int i = 0; i < count * 3; i++) {
+    Vec3f p = positions[indices[i]];
+    Vec4f t = mat4_mul_vec4(transform, (Vec4f){ p.x, p.y, p.z, 1.0f });
+    triangles[i] = (Vec3f){ t.x, t.y, t.z };
+  }
+  bvh->bounds = (Aabb){ triangles[0], triangles[0] };
+  for (int i = 0; i < count; i++) {
+    const Vec3f *t = triangles + i * 3;
+    bvh->bounds.min = min3(bvh->bounds.min, min3(min3(t[0], t[1]), t[2]));
+    bvh->bounds.max = max3(bvh->bounds.max, max3(max3(t[0], t[1]), t[2]));
+    b.centers[i] = (Vec3f){
+      (t[0].x + t[1].x + t[2].x) / 3.0f, (t[0].y + t[1].y + t[2].y) / 3.0f, (t[0].z + t[1].z + t[2].z) / 3.0f
+    };
+    b.order[i] = i;
+  }
+
+  Vec3f extent = sub3(bvh->bounds.max, bvh->bounds.min);
+  bvh->step     = (Vec3f){ extent.x / QUANT_MAX, extent.y / QUANT_MAX, extent.z / QUANT_MAX };
+  bvh->inv_step = (Vec3f){
+    extent.x > 0.0f ? QUANT_MAX / extent.x : 0.0f,
+    extent.y > 0.0f ? QUANT_MAX / extent.y : 0.0f,
+    extent.z > 0.0f ? QUANT_MAX / extent.z : 0.0f
+  };
+
+  // A subtree over m triangles has at most 2m - 1 nodes.
+  bvh->nodes = malloc(count * 2 * sizeof(MeshNode));
+  build_node(bvh, &b, 0, count);
+
+  bvh->vertices = malloc(count * 3 * sizeof(Vec3f));
+  for (int i = 0; i < count; i++) {
+    memcpy(bvh->vertices + i * 3, triangles + b.order[i] * 3, 3 * sizeof(Vec3f));
+  }
+  bvh->triangle_count = count;
+
+  free(triangles);
+  free(b.centers);
+  free(b.order);
+}
+
+void mesh_bvh_destroy(MeshBvh *bvh) {
+  free(bvh->nodes);
+  free(bvh->vertices);
+  memset(bvh, 0, sizeof(MeshBvh));
+}
+
+// QUERIES
+
+static int box_outside(const Aabb *a, const Aabb *b) {
+  return a->max.x < b->min.x || b->max.x < a->min.x ||
+         a->max.y < b->min.y || b->max.y < a->min.y ||
+         a->max.z < b->min.z || b->max.z < a->min.z;
+}
+
+void mesh_bvh_query(const MeshBvh *bvh, const Aabb *box, MeshQueryFn fn, void *ctx) {
+  if (bvh->node_count == 0 || box_outside(&bvh->bounds, box)) return;
+
+  uint16_t lo[3], hi[3];
+  quantize_box(bvh, box, lo, hi);
+
+  int stack[MESH_MAX_DEPTH];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    int index = stack[--top];
+    const MeshNode *n = &bvh->nodes[index];
+    int hit = (n->lo[0] <= hi[0]) & (lo[0] <= n->hi[0]) &
+              (n->lo[1] <= hi[1]) & (lo[1] <= n->hi[1]) &
+              (n->lo[2] <= hi[2]) & (lo[2] <= n->hi[2]);
+    if (!hit) continue;
+
+    if (n->data >= 0) {
+      stack[top++] = n->data;
+      stack[top++] = index + 1;
+      continue;
+    }
+    int leaf = ~n->data, first = leaf >> 3, count = leaf & 7;
+    for (int i = first; i < first + count; i++) {
+      if (!fn(ctx, i)) return;
+    }
+  }
+}
+
+// Slab test against a node. Returns the entry distance or -1.
+static float node_ray(const Aabb *box, Vec3f origin, Vec3f inv_dir, float max_t) {
+  float t0 = 0.0f, t1 = max_t;
+  for (int axis = 0; axis < 3; axis++) {
+    float o = axis_value(origin, axis), inv = axis_value(inv_dir, axis);
+    float lo = axis_value(box->min, axis), hi = axis_value(box->max, axis);
+    if (isinf(inv)) {
+      if (o < lo || o > hi) return -1.0f;
+      continue;
+    }
+    float near = (lo - o) * inv, far = (hi - o) * inv;
+    if (near > far) {
+      float t = near;
+      near = far;
+      far = t;
+    }
+    if (near > t0) t0 = near;
+    if (far < t1) t1 = far;
+    if (t0 > t1) return -1.0f;
+  }
+  return t0;
+}
+
+// Moller-Trumbore, either side facing.
+static float ray_triangle(const Vec3f *v, Vec3f origin, Vec3f dir, float max_t) {
+  Vec3f e1 = sub3(v[1], v[0]), e2 = sub3(v[2], v[0]);
+  Vec3f p = cross3(dir, e2);
+  float det = dot3(e1, p);
+  if (det == 0.0f) return -1.0f;
+  float inv = 1.0f / det;
+  Vec3f s = sub3(origin, v[0]);
+  float u = dot3(s, p) * inv;
+  if (u < 0.0f || u > 1.0f) return -1.0f;
+  Vec3f q = cross3(s, e1);
+  float w = dot3(dir, q) * inv;
+  if (w < 0.0f || u + w > 1.0f) return -1.0f;
+  float t = dot3(e2, q) * inv;
+  return t >= 0.0f && t <= max_t ? t : -1.0f;
+}
+
+float mesh_bvh_raycast(const MeshBvh *bvh, Vec3f origin, Vec3f dir, float max_t, Vec3f *normal) {
+  if (bvh->node_count == 0) return -1.0f;
+  Vec3f inv_dir = { 1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z };
+  int best = -1;
+
+  int stack[MESH_MAX_DEPTH];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    int index = stack[--top];
+    const MeshNode *n = &bvh->nodes[index];
+    Aabb box = node_box(bvh, n);
+    if (node_ray(&box, origin, inv_dir, max_t) < 0.0f) continue;
+
+    if (n->data >= 0) {
+      // Nearer child on top of the stack, so early hits prune the far one.
+      Aabb a = node_box(bvh, &bvh->nodes[index + 1]), b = node_box(bvh, &bvh->nodes[n->data]);
+      float ta = node_ray(&a, origin, inv_dir, max_t), tb = node_ray(&b, origin, inv_dir, max_t);
+      int first = index + 1, second = n->data;
+      if (tb >= 0.0f && (ta < 0.0f || tb < ta)) {
+        first = n->data;
+        second = index + 1;
+        float t = ta;
+        ta = tb;
+        tb = t;
+      }
+      if (tb >= 0.0f) stack[top++] = second;
+      if (ta >= 0.0f) stack[top++] = first;
+      continue;
+    }
+    int leaf = ~n->data, first = leaf >> 3, count = leaf & 7;
+    for (int i = first; i < first + count; i++) {
+      float t = ray_triangle(mesh_bvh_triangle(bvh, i), origin, dir, max_t);
+      if (t < 0.0f) continue;
+      max_t = t;
+      best = i;
+    }
+  }
+
+  if (best < 0) return -1.0f;
+  if (normal) {
+    const Vec3f *v = mesh_bvh_triangle(bvh, best);
+    Vec3f n = cross3(sub3(v[1], v[0]), sub3(v[2], v[0]));
+    float length = sqrtf(dot3(n, n));
+    n = (Vec3f){ n.x / length, n.y / length, n.z / length };
+    *normal = dot3(n, dir) > 0.0f ? neg3(n) : n;
+  }
+  return max_t;
+}
+
+// BOX VS TRIANGLE
+
+// The separating axes of a box and a triangle given relative to the box
+// centre: the three box axes and the triangle normal first, then the edge
+// cross products that are not degenerate, all unit length. Returns 0 for a
+// triangle with no area.
+static int triangle_axes(const Vec3f *v, Vec3f *axes) {
+  Vec3f edges[3] = { sub3(v[1], v[0]), sub3(v[2], v[1]), sub3(v[0], v[2]) };
+  Vec3f n = cross3(edges[0], edges[1]);
+  float length = sqrtf(dot3(n, n));
+  if (length == 0.0f) return 0;
+
+  int count = 0;
+  axes[count++] = (Vec3f){ 1.0f, 0.0f, 0.0f };
+  axes[count++] = (Vec3f){ 0.0f, 1.0f, 0.0f };
+  axes[count++] = (Vec3f){ 0.0f, 0.0f, 1.0f };
+  axes[count++] = (Vec3f){ n.x / length, n.y / length, n.z / length };
+  for (int e = 0; e < 3; e++) {
+    Vec3f d = edges[e];
+    Vec3f candidates[3] = { { 0.0f, d.z, -d.y }, { -d.z, 0.0f, d.x }, { d.y, -d.x, 0.0f } };
+    for (int j = 0; j < 3; j++) {
+      Vec3f a = candidates[j];
+      float l = sqrtf(dot3(a, a));
+      if (l < 1e-6f) continue;
+      axes[count++] = (Vec3f){ a.x / l, a.y / l, a.z / l };
+    }
+  }
+  return count;
+}
+
+static void project(const Vec3f *v, Vec3f axis, float *lo, float *hi) {
+  float p0 = dot3(v[0], axis), p1 = dot3(v[1], axis), p2 = dot3(v[2], axis);
+  *lo = fminf(p0, fminf(p1, p2));
+  *hi = fmaxf(p0, fmaxf(p1, p2));
+}
+
+static float box_radius(Vec3f half_extents, Vec3f axis) {
+  return half_extents.x * fabsf(axis.x) + half_extents.y * fabsf(axis.y) + half_extents.z * fabsf(axis.z);
+}
+
+int box_triangle_penetration(Vec3f center, Vec3f half_extents, const Vec3f *triangle,
+                             Vec3f *normal, float *depth) {
+  Vec3f v[3] = { sub3(triangle[0], center), sub3(triangle[1], center), sub3(triangle[2], center) };
+  // Most triangles a query returns are already separated on a box axis,
+  // which needs no normalized axes to find out.
+  Vec3f lo = min3(v[0], min3(v[1], v[2])), hi = max3(v[0], max3(v[1], v[2]));
+  if (!(lo.x < half_extents.x && hi.x > -half_extents.x && lo.y < half_extents.y && hi.y > -half_extents.y &&
+        lo.z < half_extents.z && hi.z > -half_extents.z)) {
+    return 0;
+  }
+  Vec3f axes[13];
+  int count = triangle_axes(v, axes);
+  if (count == 0) return 0;
+
+  float best = INFINITY;
+  for (int i = 0; i < count; i++) {
+    float lo, hi, r = box_radius(half_extents, axes[i]);
+    project(v, axes[i], &lo, &hi);
+    if (!(lo < r && hi > -r)) return 0;
+
+    // Out along -axis until the box ends at lo, or along +axis past hi.
+    float down = r - lo, up = hi + r;
+    float d = down < up ? down : up;
+    if ((i < 4 ? d : d * EDGE_BIAS) < best) {
+      best    = d;
+      *normal = down < up ? neg3(axes[i]) : axes[i];
+    }
+  }
+  *depth = best;
+  return 1;
+}
+
+// Same interval logic as narrowphase_sweep() over the triangle's axes.
+static int box_triangle_sweep(Vec3f center, Vec3f half_extents, Vec3f delta, const Vec3f *triangle,
+                              float *toi, Vec3f *normal) {
+  Vec3f v[3] = { sub3(triangle[0], center), sub3(triangle[1], center), sub3(triangle[2], center) };
+  Vec3f axes[13];
+  int count = triangle_axes(v, axes);
+  if (count == 0) return 0;
+
+  float enter = -INFINITY, exit = INFINITY;
+  int hit_axis = -1;
+  Vec3f hit_normal = { 0.0f, 0.0f, 0.0f };
+  for (int i = 0; i < count; i++) {
+    float lo, hi, r = box_radius(half_extents, axes[i]);
+    project(v, axes[i], &lo, &hi);
+    lo -= r;
+    hi += r;
+    float s = dot3(delta, axes[i]);
+    if (s == 0.0f) {
+      if (!(lo < 0.0f && 0.0f < hi)) return 0;
+      continue;
+    }
+    float t0 = lo / s, t1 = hi / s;
+    if (t0 > t1) {
+      float t = t0;
+      t0 = t1;
+      t1 = t;
+    }
+    if (t0 > enter) {
+      enter = t0;
+      hit_axis = i;
+      hit_normal = s > 0.0f ? neg3(axes[i]) : axes[i];
+    }
+    if (t1 < exit) exit = t1;
+  }
+
+  if (hit_axis < 0 || enter < 0.0f || enter > 1.0f || enter >= exit) return 0;
+  *toi    = enter;
+  *normal = hit_normal;
+  return 1;
+}
+
+typedef struct {
+  const MeshBvh *bvh;
+  Vec3f         center;
+  Vec3f         half_extents;
+  Vec3f         delta;
+  float         toi;
+  Vec3f         normal;
+  int           hit;
+} BoxQuery;
+
+static int overlap_triangle(void *ctx, int triangle) {
+  BoxQuery *q = ctx;
+  Vec3f normal;
+  float depth;
+  q->hit = box_triangle_penetration(q->center, q->half_extents, mesh_bvh_triangle(q->bvh, triangle), &normal, &depth);
+  return !q->hit;
+}
+
+int mesh_bvh_overlaps(const MeshBvh *bvh, Vec3f center, Vec3f half_extents) {
+  BoxQuery q = { .bvh = bvh, .center = center, .half_extents = half_extents };
+  Aabb box = { sub3(center, half_extents), (Vec3f){ center.x + half_extents.x, center.y + half_extents.y, center.z + half_extents.z } };
+  mesh_bvh_query(bvh, &box, overlap_triangle, &q);
+  return q.hit;
+}
+
+static int sweep_triangle(void *ctx, int triangle) {
+  BoxQuery *q = ctx;
+  float toi;
+  Vec3f normal;
+  if (box_triangle_sweep(q->center, q->half_extents, q->delta, mesh_bvh_triangle(q->bvh, triangle), &toi, &normal) &&
+      toi < q->toi) {
+    q->toi    = toi;
+    q->normal = normal;
+    q->hit    = 1;
+  }
+  return 1;
+}
+
+int mesh_bvh_sweep(const MeshBvh *bvh, Vec3f center, Vec3f half_extents, Vec3f delta,
+                   float *toi, Vec3f *normal) {
+  BoxQuery q = { .bvh = bvh, .center = center, .half_extents = half_extents, .delta = delta, .toi = INFINITY };
+  Vec3f to = { center.x + delta.x, center.y + delta.y, center.z + delta.z };
+  Aabb swept = { sub3(min3(center, to), half_extents), max3(center, to) };
+  swept.max = (Vec3f){ swept.max.x + half_extents.x, swept.max.y + half_extents.y, swept.max.z + half_extents.z };
+  mesh_bvh_query(bvh, &swept, sweep_triangle, &q);
+  if (!q.hit) return 0;
+  *toi    = q.toi;
+  *normal = q.normal;
+  return 1;
+}
@@ -0,0 +1,70 @@
+#ifndef MESH_BVH_H
+#define MESH_BVH_H
+
+#include <stdint.h>
+#include "physics/PairList.h"
+
+#define MESH_LEAF_SIZE 4
+// Median splits keep the depth near log2(triangles / MESH_LEAF_SIZE).
+#define MESH_MAX_DEPTH 64
+
+// 16 bytes, four to a cache line. Bounds are quantized to 16 bits per axis
+// over the mesh bounds, rounded outward so they stay conservative. An
+// internal node's children are the node right after it and node `data`; a
+// leaf stores ~(first * 8 + count) over the triangles in leaf order.
+typedef struct {
+  uint16_t  lo[3];
+  uint16_t  hi[3];
+  int32_t   data;
+} MeshNode;
+
+// Immutable triangle BVH for static level geometry, built top-down with
+// median splits like StaticBvh. Triangles are copied out in leaf order, so
+// a leaf is three consecutive vertices per triangle. Everything is in the
+// collider's local space: callers subtract the entity's position.
+typedef struct {
+  MeshNode  *nodes;
+  int       node_count;
+  Vec3f     *vertices;
+  int       triangle_count;
+  Aabb      bounds;
+  Vec3f     step;       // world size of one quantization unit per axis
+  Vec3f     inv_step;   // 0 on an axis where the mesh is flat
+} MeshBvh;
+
+// Returns 0 to stop the query.
+typedef int (*MeshQueryFn)(void *ctx, int triangle);
+
+// Builds over `index_count / 3` triangles of `positions`, each moved by
+// `transform`.
+void  mesh_bvh_build(MeshBvh *bvh, const Vec3f *positions, const int *indices, int index_count, Mat4 transform);
+void  mesh_bvh_destroy(MeshBvh *bvh);
+
+static inline const Vec3f* mesh_bvh_triangle(const MeshBvh *bvh, int triangle) {
+  return bvh->vertices + triangle * 3;
+}
+
+// Every triangle whose node bounds may overlap `box`, for an exact test.
+void  mesh_bvh_query(const MeshBvh *bvh, const Aabb *box, MeshQueryFn fn, void *ctx);
+// Closest triangle along origin + t * dir within [0, max_t], either side
+// facing. Returns t, or -1 on a miss, with the face normal turned against
+// the ray in *normal.
+float mesh_bvh_raycast(const MeshBvh *bvh, Vec3f origin, Vec3f dir, float max_t, Vec3f *normal);
+// Whether the box overlaps any triangle (touching does not count).
+int   mesh_bvh_overlaps(const MeshBvh *bvh, Vec3f center, Vec3f half_extents);
+// First triangle the box touches when moved by `delta`, as
+// narrowphase_sweep() does for boxes: *toi is the fraction of `delta` and
+// *normal the face pushing back. Triangles it starts overlapping are skipped.
+int   mesh_bvh_sweep(const MeshBvh *bvh, Vec3f center, Vec3f half_extents, Vec3f delta,
+                     float *toi, Vec3f *normal);
+
+// Separating-axis test of a box against one triangle over the box axes,
+// the triangle normal and the nine edge-axis cross products. If they
+// overlap, returns 1 with the shallowest way out: moving the box by
+// normal * depth separates it. Face axes win ties with edge axes, so a box
+// sliding over a flat tessellated floor is pushed up rather than snagging
+// on inner edges.
+int   box_triangle_penetration(Vec3f center, Vec3f half_extents, const Vec3f *triangle,
+                               Vec3f *normal, float *depth);
+
+#endif
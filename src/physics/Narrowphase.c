@@ -0,0 +1,248 @@
+#include "Narrowphase.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+// `box` is the tested box as { px, py, pz, hx, hy, hz }.
+typedef int (*NarrowphaseKernel)(const NarrowphaseBatch *b, int begin, const float *box, int *axis, float *push);
+
+static int narrowphase_scalar(const NarrowphaseBatch *b, int begin, const float *box, int *axis, float *push) {
+  Vec3f position = { box[0], box[1], box[2] };
+  Vec3f half     = { box[3], box[4], box[5] };
+  for (int i = begin; i < b->count; i++) {
+    Vec3f other_position = { b->px[i], b->py[i], b->pz[i] };
+    Vec3f other_half     = { b->hx[i], b->hy[i], b->hz[i] };
+    if (narrowphase_pair(position, half, other_position, other_half, axis, push)) return i;
+  }
+  return b->count;
+}
+
+// Lanes of a group that hold candidates when `left` remain.
+static inline int live_lanes(int left) {
+  return left >= 8 ? 0xff : (1 << left) - 1;
+}
+
+// Picks lane `l` out of a group's shallowest-axis masks and pushes.
+static int lane_result(int l, int mx, int my, const float *pushes, int *axis, float *push) {
+  *axis = (mx >> l & 1) ? 0 : (my >> l & 1) ? 1 : 2;
+  *push = pushes[l];
+  return l;
+}
+
+#ifdef HAVE_X86
+static inline __m128 select_sse(__m128 mask, __m128 a, __m128 b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static int narrowphase_sse(const NarrowphaseBatch *b, int begin, const float *box, int *axis, float *push) {
+  __m128 px   = _mm_set1_ps(box[0]);
+  __m128 py   = _mm_set1_ps(box[1]);
+  __m128 pz   = _mm_set1_ps(box[2]);
+  __m128 hx   = _mm_set1_ps(box[3]);
+  __m128 hy   = _mm_set1_ps(box[4]);
+  __m128 hz   = _mm_set1_ps(box[5]);
+  __m128 sign = _mm_set1_ps(-0.0f);
+
+  for (int i = begin; i < b->count; i += 4) {
+    __m128 bx = _mm_loadu_ps(b->px + i);
+    __m128 by = _mm_loadu_ps(b->py + i);
+    __m128 bz = _mm_loadu_ps(b->pz + i);
+    __m128 ex = _mm_add_ps(hx, _mm_loadu_ps(b->hx + i));
+    __m128 ey = _mm_add_ps(hy, _mm_loadu_ps(b->hy + i));
+    __m128 ez = _mm_add_ps(hz, _mm_loadu_ps(b->hz + i));
+    __m128 ax = _mm_andnot_ps(sign, _mm_sub_ps(px, bx));
+    __m128 ay = _mm_andnot_ps(sign, _mm_sub_ps(py, by));
+    __m128 az = _mm_andnot_ps(sign, _mm_sub_ps(pz, bz));
+
+    int hit = _mm_movemask_ps(_mm_and_ps(_mm_and_ps(_mm_cmplt_ps(ax, ex), _mm_cmplt_ps(ay, ey)), _mm_cmplt_ps(az, ez)));
+    hit &= live_lanes(b->count - i);
+    if (!hit) continue;
+
+    __m128 dx = _mm_sub_ps(ex, ax);
+    __m128 dy = _mm_sub_ps(ey, ay);
+    __m128 dz = _mm_sub_ps(ez, az);
+    __m128 mx = _mm_and_ps(_mm_cmplt_ps(dx, dy), _mm_cmplt_ps(dx, dz));
+    __m128 my = _mm_and_ps(_mm_cmplt_ps(dy, dx), _mm_cmplt_ps(dy, dz));
+
+    __m128 depth = select_sse(mx, dx, select_sse(my, dy, dz));
+    __m128 neg   = select_sse(mx, _mm_cmplt_ps(px, bx), select_sse(my, _mm_cmplt_ps(py, by), _mm_cmplt_ps(pz, bz)));
+    float pushes[4];
+    _mm_storeu_ps(pushes, _mm_xor_ps(depth, _mm_and_ps(neg, sign)));
+    return i + lane_result(__builtin_ctz(hit), _mm_movemask_ps(mx), _mm_movemask_ps(my), pushes, axis, push);
+  }
+  return b->count;
+}
+
+__attribute__((target("avx2")))
+static int narrowphase_avx2(const NarrowphaseBatch *b, int begin, const float *box, int *axis, float *push) {
+  __m256 px   = _mm256_set1_ps(box[0]);
+  __m256 py   = _mm256_set1_ps(box[1]);
+  __m256 pz   = _mm256_set1_ps(box[2]);
+  __m256 hx   = _mm256_set1_ps(box[3]);
+  __m256 hy   = _mm256_set1_ps(box[4]);
+  __m256 hz   = _mm256_set1_ps(box[5]);
+  __m256 sign = _mm256_set1_ps(-0.0f);
+
+  for (int i = begin; i < b->count; i += 8) {
+    __m256 bx = _mm256_loadu_ps(b->px + i);
+    __m256 by = _mm256_loadu_ps(b->py + i);
+    __m256 bz = _mm256_loadu_ps(b->pz + i);
+    __m256 ex = _mm256_add_ps(hx, _mm256_loadu_ps(b->hx + i));
+    __m256 ey = _mm256_add_ps(hy, _mm256_loadu_ps(b->hy + i));
+    __m256 ez = _mm256_add_ps(hz, _mm256_loadu_ps(b->hz + i));
+    __m256 ax = _mm256_andnot_ps(sign, _mm256_sub_ps(px, bx));
+    __m256 ay = _mm256_andnot_ps(sign, _mm256_sub_ps(py, by));
+    __m256 az = _mm256_andnot_ps(sign, _mm256_sub_ps(pz, bz));
+
+    int hit = _mm256_movemask_ps(_mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(ax, ex, _CMP_LT_OQ),
+                                                             _mm256_cmp_ps(ay, ey, _CMP_LT_OQ)),
+                                               _mm256_cmp_ps(az, ez, _CMP_LT_OQ)));
+    hit &= live_lanes(b->count - i);
+    if (!hit) continue;
+
+    __m256 dx = _mm256_sub_ps(ex, ax);
+    __m256 dy = _mm256_sub_ps(ey, ay);
+    __m256 dz = _mm256_sub_ps(ez, az);
+    __m256 mx = _mm256_and_ps(_mm256_cmp_ps(dx, dy, _CMP_LT_OQ), _mm256_cmp_ps(dx, dz, _CMP_LT_OQ));
+    __m256 my = _mm256_and_ps(_mm256_cmp_ps(dy, dx, _CMP_LT_OQ), _mm256_cmp_ps(dy, dz, _CMP_LT_OQ));
+
+    __m256 depth = _mm256_blendv_ps(_mm256_blendv_ps(dz, dy, my), dx, mx);
+    __m256 neg   = _mm256_blendv_ps(_mm256_blendv_ps(_mm256_cmp_ps(pz, bz, _CMP_LT_OQ), _mm256_cmp_ps(py, by, _CMP_LT_OQ), my),
+                                    _mm256_cmp_ps(px, bx, _CMP_LT_OQ), mx);
+    float pushes[8];
+    _mm256_storeu_ps(pushes, _mm256_xor_ps(depth, _mm256_and_ps(neg, sign)));
+    return i + lane_result(__builtin_ctz(hit), _mm256_movemask_ps(mx), _mm256_movemask_ps(my), pushes, axis, push);
+  }
+  return b->count;
+}
+#endif
+
+#ifdef HAVE_NEON
+static int lane_mask(uint32x4_t m) {
+  uint32_t l[4];
+  vst1q_u32(l, m);
+  return (l[0] & 1) | (l[1] & 2) | (l[2] & 4) | (l[3] & 8);
+}
+
+static int narrowphase_neon(const NarrowphaseBatch *b, int begin, const float *box, int *axis, float *push) {
+  float32x4_t px   = vdupq_n_f32(box[0]);
+  float32x4_t py   = vdupq_n_f32(box[1]);
+  float32x4_t pz   = vdupq_n_f32(box[2]);
+  float32x4_t hx   = vdupq_n_f32(box[3]);
+  float32x4_t hy   = vdupq_n_f32(box[4]);
+  float32x4_t hz   = vdupq_n_f32(box[5]);
+  uint32x4_t  sign = vdupq_n_u32(0x80000000u);
+
+  for (int i = begin; i < b->count; i += 4) {
+    float32x4_t bx = vld1q_f32(b->px + i);
+    float32x4_t by = vld1q_f32(b->py + i);
+    float32x4_t bz = vld1q_f32(b->pz + i);
+    float32x4_t ex = vaddq_f32(hx, vld1q_f32(b->hx + i));
+    float32x4_t ey = vaddq_f32(hy, vld1q_f32(b->hy + i));
+    float32x4_t ez = vaddq_f32(hz, vld1q_f32(b->hz + i));
+    float32x4_t ax = vabsq_f32(vsubq_f32(px, bx));
+    float32x4_t ay = vabsq_f32(vsubq_f32(py, by));
+    float32x4_t az = vabsq_f32(vsubq_f32(pz, bz));
+
+    uint32x4_t ov = vandq_u32(vandq_u32(vcltq_f32(ax, ex), vcltq_f32(ay, ey)), vcltq_f32(az, ez));
+    int hit = lane_mask(ov) & live_lanes(b->count - i);
+    if (!hit) continue;
+
+    float32x4_t dx = vsubq_f32(ex, ax);
+    float32x4_t dy = vsubq_f32(ey, ay);
+    float32x4_t dz = vsubq_f32(ez, az);
+    uint32x4_t  mx = vandq_u32(vcltq_f32(dx, dy), vcltq_f32(dx, dz));
+    uint32x4_t  my = vandq_u32(vcltq_f32(dy, dx), vcltq_f32(dy, dz));
+
+    float32x4_t depth = vbslq_f32(mx, dx, vbslq_f32(my, dy, dz));
+    uint32x4_t  neg   = vbslq_u32(mx, vcltq_f32(px, bx), vbslq_u32(my, vcltq_f32(py, by), vcltq_f32(pz, bz)));
+    float pushes[4];
+    vst1q_f32(pushes, vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(depth), vandq_u32(neg, sign))));
+    return i + lane_result(__builtin_ctz(hit), lane_mask(mx), lane_mask(my), pushes, axis, push);
+  }
+  return b->count;
+}
+#endif
+
+// Slab test of a's centre, moving by `delta`, against b grown by a's half
+// extents: a is inside b on an axis between that axis' entry and exit
+// times, and hits b when it is inside on all three at once.
+int narrowphase_sweep(Vec3f pos_a, Vec3f half_a, Vec3f delta, Vec3f pos_b, Vec3f half_b,
+                      float *toi, int *axis) {
+  float p[3] = { pos_a.x - pos_b.x, pos_a.y - pos_b.y, pos_a.z - pos_b.z };
+  float d[3] = { delta.x, delta.y, delta.z };
+  float e[3] = { half_a.x + half_b.x, half_a.y + half_b.y, half_a.z + half_b.z };
+
+  float enter = -INFINITY, exit = INFINITY;
+  int hit_axis = -1;
+  for (int i = 0; i < 3; i++) {
+    if (d[i] == 0.0f) {
+      if (!(fabsf(p[i]) < e[i])) return 0;
+      continue;
+    }
+    float t0 = (-e[i] - p[i]) / d[i];
+    float t1 = (e[i] - p[i]) / d[i];
+    if (t0 > t1) {
+      float t = t0;
+      t0 = t1;
+      t1 = t;
+    }
+    if (t0 > enter) {
+      enter = t0;
+      hit_axis = i;
+    }
+    if (t1 < exit) exit = t1;
+  }
+
+  if (hit_axis < 0 || enter < 0.0f || enter > 1.0f || enter >= exit) return 0;
+  *toi  = enter;
+  *axis = hit_axis;
+  return 1;
+}
+
+static NarrowphaseKernel kernel = NULL;
+static const char *kernel_name = "scalar";
+
+static void select_kernel(NarrowphaseBackend backend) {
+  kernel = narrowphase_scalar;
+  kernel_name = "scalar";
+  if (backend == NARROWPHASE_SCALAR) return;
+
+#ifdef HAVE_X86
+  __builtin_cpu_init();
+  if ((backend == NARROWPHASE_AUTO || backend == NARROWPHASE_AVX2) && __builtin_cpu_supports("avx2")) {
+    kernel = narrowphase_avx2;
+    kernel_name = "avx2";
+  } else if (__builtin_cpu_supports("sse2")) {
+    kernel = narrowphase_sse;
+    kernel_name = "sse";
+  }
+#elif defined(HAVE_NEON)
+  kernel = narrowphase_neon;
+  kernel_name = "neon";
+#endif
+}
+
+void narrowphase_set_backend(NarrowphaseBackend backend) {
+  select_kernel(backend);
+}
+
+const char* narrowphase_backend_name(void) {
+  if (!kernel) select_kernel(NARROWPHASE_AUTO);
+  return kernel_name;
+}
+
+int narrowphase_next(const NarrowphaseBatch *b, int begin, Vec3f position, Vec3f half_extents,
+                     int *axis, float *push) {
+  if (!kernel) select_kernel(NARROWPHASE_AUTO);
+  float box[6] = {
+    position.x, position.y, position.z,
+    half_extents.x, half_extents.y, half_extents.z
+  };
+  return kernel(b, begin, box, axis, push);
+}
@@ -0,0 +1,78 @@
+#ifndef NARROWPHASE_H
+#define NARROWPHASE_H
+
+#include <math.h>
+#include "maths/Maths3D.h"
+
+// Batched box-vs-boxes overlap test over SoA candidate arrays. The kernels
+// test 4 or 8 candidates at a time for an overlap mask and only work out
+// penetration for the group holding the first overlap, so walking every
+// overlap in order (as resolution does, moving the box between calls)
+// costs little more than one pass. Results match the scalar path bit for
+// bit.
+//
+// The last group may run past `count`: every array must stay readable for
+// NARROWPHASE_PADDING floats beyond it. What is there is ignored.
+#define NARROWPHASE_PADDING 7
+
+typedef struct {
+  const float *px, *py, *pz;
+  const float *hx, *hy, *hz;
+  int         count;
+} NarrowphaseBatch;
+
+typedef enum {
+  NARROWPHASE_AUTO,
+  NARROWPHASE_SCALAR,
+  NARROWPHASE_SSE,
+  NARROWPHASE_AVX2,
+  NARROWPHASE_NEON
+} NarrowphaseBackend;
+
+// Tests one pair: whether box a overlaps box b, and if so the axis of least
+// penetration (0 = x, 1 = y, 2 = z; x or y only when strictly shallowest)
+// and the signed distance that pushes a out along it. The batched kernels
+// give exactly these results.
+static inline int narrowphase_pair(Vec3f pos_a, Vec3f half_a, Vec3f pos_b, Vec3f half_b,
+                                   int *axis, float *push) {
+  float ax = fabsf(pos_a.x - pos_b.x);
+  float ay = fabsf(pos_a.y - pos_b.y);
+  float az = fabsf(pos_a.z - pos_b.z);
+  float ex = half_a.x + half_b.x;
+  float ey = half_a.y + half_b.y;
+  float ez = half_a.z + half_b.z;
+  if (!(ax < ex && ay < ey && az < ez)) return 0;
+
+  float dx = ex - ax;
+  float dy = ey - ay;
+  float dz = ez - az;
+  if (dx < dy && dx < dz) {
+    *axis = 0;
+    *push = pos_a.x < pos_b.x ? -dx : dx;
+  } else if (dy < dx && dy < dz) {
+    *axis = 1;
+    *push = pos_a.y < pos_b.y ? -dy : dy;
+  } else {
+    *axis = 2;
+    *push = pos_a.z < pos_b.z ? -dz : dz;
+  }
+  return 1;
+}
+
+// Returns the first candidate at or after `begin` that overlaps the box,
+// or count if none does, with *axis and *push as narrowphase_pair() gives
+// them.
+int         narrowphase_next(const NarrowphaseBatch *b, int begin, Vec3f position, Vec3f half_extents,
+                             int *axis, float *push);
+
+// Sweeps box a by `delta` against box b, which stays put. Returns 1 if a
+// starts clear of b and touches it within the sweep, with the fraction of
+// `delta` travelled at impact in *toi and the axis of the face it hits in
+// *axis. Boxes that already overlap are left to the overlap test.
+int         narrowphase_sweep(Vec3f pos_a, Vec3f half_a, Vec3f delta, Vec3f pos_b, Vec3f half_b,
+                              float *toi, int *axis);
+
+void        narrowphase_set_backend(NarrowphaseBackend backend);
+const char* narrowphase_backend_name(void);
+
+#endif
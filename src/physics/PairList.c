@@ -0,0 +1,34 @@
+#include "PairList.h"
+#include <stdlib.h>
+
+void pair_list_init(PairList *list) {
+  list->pairs     = NULL;
+  list->count     = 0;
+  list->capacity  = 0;
+}
+
+void pair_list_push(PairList *list, int a, int b) {
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 64;
+    list->pairs = realloc(list->pairs, list->capacity * sizeof(BodyPair));
+  }
+  list->pairs[list->count++] = a < b ? (BodyPair){ a, b } : (BodyPair){ b, a };
+}
+
+static int compare_pairs(const void *x, const void *y) {
+  const BodyPair *p = x, *q = y;
+  if (p->a != q->a) return p->a < q->a ? -1 : 1;
+  if (p->b != q->b) return p->b < q->b ? -1 : 1;
+  return 0;
+}
+
+// Orders pairs by (a, b), so results never depend on how a broadphase
+// happened to walk its structure.
+void pair_list_sort(PairList *list) {
+  qsort(list->pairs, list->count, sizeof(BodyPair), compare_pairs);
+}
+
+void pair_list_destroy(PairList *list) {
+  free(list->pairs);
+  pair_list_init(list);
+}
@@ -0,0 +1,49 @@
+#ifndef PAIR_LIST_H
+#define PAIR_LIST_H
+
+#include "maths/Maths3D.h"
+
+typedef struct {
+  Vec3f min;
+  Vec3f max;
+} Aabb;
+
+// Candidate pair of body indices, always a < b.
+typedef struct {
+  int a;
+  int b;
+} BodyPair;
+
+typedef struct {
+  BodyPair  *pairs;
+  int       count;
+  int       capacity;
+} PairList;
+
+// What every broadphase consumes: one AABB per body, indexed 0..count-1.
+// Static bodies never pair with each other. `layout_version` must change
+// whenever bodies may have been reindexed or static bounds may have
+// changed, so a broadphase can keep state between calls. `ids` are
+// non-negative handles that stay with a body across reindexing (entity
+// handles); they may be NULL, in which case indices are used.
+typedef struct {
+  const Aabb          *bounds;
+  const unsigned char *is_static;
+  const int           *ids;
+  int                 count;
+  unsigned int        layout_version;
+} BroadphaseInput;
+
+void pair_list_init(PairList *list);
+void pair_list_push(PairList *list, int a, int b);
+void pair_list_sort(PairList *list);
+void pair_list_destroy(PairList *list);
+
+// Touching bounds count as overlapping; the narrowphase decides contact.
+static inline int aabb_overlaps(const Aabb *a, const Aabb *b) {
+  return a->min.x <= b->max.x && b->min.x <= a->max.x &&
+         a->min.y <= b->max.y && b->min.y <= a->max.y &&
+         a->min.z <= b->max.z && b->min.z <= a->max.z;
+}
+
+#endif
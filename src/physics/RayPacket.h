@@ -0,0 +1,101 @@
+#ifndef RAY_PACKET_H
+#define RAY_PACKET_H
+
+#include "physics/PairList.h"
+
+#define RAY_PACKET_SIZE 8
+
+// Up to RAY_PACKET_SIZE rays traced through a hierarchy together: each node
+// is fetched once for the whole packet and tested against every lane still
+// in it, so coherent rays (probes fanned out from one spot, a row of
+// line-of-sight checks) share one traversal. Lanes are stored as
+// structure-of-arrays; a hit shortens its lane's max_t for the rest of the
+// traversal.
+typedef struct {
+  float  ox[RAY_PACKET_SIZE], oy[RAY_PACKET_SIZE], oz[RAY_PACKET_SIZE];
+  float  dx[RAY_PACKET_SIZE], dy[RAY_PACKET_SIZE], dz[RAY_PACKET_SIZE];
+  float  ix[RAY_PACKET_SIZE], iy[RAY_PACKET_SIZE], iz[RAY_PACKET_SIZE];
+  float  max_t[RAY_PACKET_SIZE];
+  int    hit[RAY_PACKET_SIZE];      // id of the closest hit so far, -1 if none
+  int    count;
+} RayPacket;
+
+// Returns the distance along lane `lane`'s ray to the shape with this id,
+// or a negative value on a miss. Same contract as TreeRayFn.
+typedef float (*RayHitFn)(void *ctx, int id, int lane, Vec3f origin, Vec3f dir, float max_t);
+
+// A zero direction component gets a huge reciprocal instead of infinity:
+// (lo - o) * inv then stays finite (0 on the slab plane), and the slab test
+// below accepts the lane exactly when o lies within [lo, hi] on that axis,
+// as aabb_ray() does.
+static inline float ray_packet_inverse(float d) {
+  return d != 0.0f ? 1.0f / d : 1e30f;
+}
+
+static inline void ray_packet_set(RayPacket *p, int lane, Vec3f origin, Vec3f dir, float max_t) {
+  p->ox[lane] = origin.x;
+  p->oy[lane] = origin.y;
+  p->oz[lane] = origin.z;
+  p->dx[lane] = dir.x;
+  p->dy[lane] = dir.y;
+  p->dz[lane] = dir.z;
+  p->ix[lane] = ray_packet_inverse(dir.x);
+  p->iy[lane] = ray_packet_inverse(dir.y);
+  p->iz[lane] = ray_packet_inverse(dir.z);
+  p->max_t[lane] = max_t;
+  p->hit[lane]   = -1;
+}
+
+static inline unsigned int ray_packet_all(const RayPacket *p) {
+  return (1u << p->count) - 1u;
+}
+
+static inline float ray_packet_min(float a, float b) { return a < b ? a : b; }
+static inline float ray_packet_max(float a, float b) { return a > b ? a : b; }
+
+// The lanes of `lanes` whose ray reaches the box within [0, max_t]. Every
+// lane is tested with plain min/max and no early out, which compilers turn
+// into packed compares over the whole packet; the mask is applied after.
+static inline unsigned int ray_packet_test(const RayPacket *p, const Aabb *box, unsigned int lanes) {
+  int hit[RAY_PACKET_SIZE];
+  for (int i = 0; i < RAY_PACKET_SIZE; i++) {
+    float nx = (box->min.x - p->ox[i]) * p->ix[i], fx = (box->max.x - p->ox[i]) * p->ix[i];
+    float ny = (box->min.y - p->oy[i]) * p->iy[i], fy = (box->max.y - p->oy[i]) * p->iy[i];
+    float nz = (box->min.z - p->oz[i]) * p->iz[i], fz = (box->max.z - p->oz[i]) * p->iz[i];
+    float t0 = ray_packet_max(ray_packet_max(ray_packet_min(nx, fx), ray_packet_min(ny, fy)),
+                              ray_packet_max(ray_packet_min(nz, fz), 0.0f));
+    float t1 = ray_packet_min(ray_packet_min(ray_packet_max(nx, fx), ray_packet_max(ny, fy)),
+                              ray_packet_min(ray_packet_max(nz, fz), p->max_t[i]));
+    hit[i] = t0 <= t1;
+  }
+  unsigned int hits = 0;
+  for (int i = 0; i < RAY_PACKET_SIZE; i++) hits |= (unsigned int)hit[i] << i;
+  return hits & lanes;
+}
+
+// Runs the exact test for every lane in `lanes` against shape `id`,
+// keeping each lane's closest hit.
+static inline void ray_packet_hit(RayPacket *p, unsigned int lanes, int id, RayHitFn fn, void *ctx) {
+  for (; lanes; lanes &= lanes - 1) {
+    int i = __builtin_ctz(lanes);
+    Vec3f origin = { p->ox[i], p->oy[i], p->oz[i] };
+    Vec3f dir    = { p->dx[i], p->dy[i], p->dz[i] };
+    float t = fn(ctx, id, i, origin, dir, p->max_t[i]);
+    if (t >= 0.0f && t <= p->max_t[i]) {
+      p->max_t[i] = t;
+      p->hit[i]   = id;
+    }
+  }
+}
+
+// Whether the packet, going by its first lane in `lanes`, meets box b
+// before box a, so traversal can visit that child first.
+static inline int ray_packet_prefers(const RayPacket *p, unsigned int lanes, const Aabb *a, const Aabb *b) {
+  int i = __builtin_ctz(lanes);
+  float d = (b->min.x + b->max.x - a->min.x - a->max.x) * p->dx[i] +
+            (b->min.y + b->max.y - a->min.y - a->max.y) * p->dy[i] +
+            (b->min.z + b->max.z - a->min.z - a->max.z) * p->dz[i];
+  return d < 0.0f;
+}
+
+#endif
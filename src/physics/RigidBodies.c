@@ -0,0 +1,60 @@
+#include "RigidBodies.h"
+#include <stdlib.h>
+#include <string.h>
+
+void rigid_bodies_init(RigidBodies *b) {
+  memset(b, 0, sizeof(RigidBodies));
+}
+
+void rigid_bodies_reserve(RigidBodies *b, int capacity) {
+  if (capacity <= b->capacity) return;
+  b->capacity    = capacity;
+  b->ids         = realloc(b->ids, capacity * sizeof(int));
+  b->px          = realloc(b->px, capacity * sizeof(float));
+  b->py          = realloc(b->py, capacity * sizeof(float));
+  b->pz          = realloc(b->pz, capacity * sizeof(float));
+  b->vx          = realloc(b->vx, capacity * sizeof(float));
+  b->vy          = realloc(b->vy, capacity * sizeof(float));
+  b->vz          = realloc(b->vz, capacity * sizeof(float));
+  b->hx          = realloc(b->hx, capacity * sizeof(float));
+  b->hy          = realloc(b->hy, capacity * sizeof(float));
+  b->hz          = realloc(b->hz, capacity * sizeof(float));
+  b->inv_mass    = realloc(b->inv_mass, capacity * sizeof(float));
+  b->friction    = realloc(b->friction, capacity * sizeof(float));
+  b->restitution = realloc(b->restitution, capacity * sizeof(float));
+  b->mesh        = realloc(b->mesh, capacity * sizeof(int));
+  b->grounded    = realloc(b->grounded, capacity * sizeof(int));
+  b->sleep_time  = realloc(b->sleep_time, capacity * sizeof(float));
+  b->rx          = realloc(b->rx, capacity * sizeof(float));
+  b->ry          = realloc(b->ry, capacity * sizeof(float));
+  b->rz          = realloc(b->rz, capacity * sizeof(float));
+  b->island      = realloc(b->island, capacity * sizeof(int));
+  b->island_size = realloc(b->island_size, capacity * sizeof(int));
+  b->flags       = realloc(b->flags, capacity);
+}
+
+void rigid_bodies_destroy(RigidBodies *b) {
+  free(b->ids);
+  free(b->px);
+  free(b->py);
+  free(b->pz);
+  free(b->vx);
+  free(b->vy);
+  free(b->vz);
+  free(b->hx);
+  free(b->hy);
+  free(b->hz);
+  free(b->inv_mass);
+  free(b->friction);
+  free(b->restitution);
+  free(b->mesh);
+  free(b->grounded);
+  free(b->sleep_time);
+  free(b->rx);
+  free(b->ry);
+  free(b->rz);
+  free(b->island);
+  free(b->island_size);
+  free(b->flags);
+  rigid_bodies_init(b);
+}
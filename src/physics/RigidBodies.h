@@ -0,0 +1,78 @@
+#ifndef RIGID_BODIES_H
+#define RIGID_BODIES_H
+
+#include "physics/PairList.h"
+
+// What a row has and what state it is in. The first four are fixed by the
+// layout; the rest are refreshed every time the row is copied in.
+#define BODY_POSITION   (1u << 0)
+#define BODY_VELOCITY   (1u << 1)
+#define BODY_MASS       (1u << 2)
+#define BODY_COLLIDER   (1u << 3)   // has a collider and a position, so it collides
+#define BODY_STATIC     (1u << 4)
+#define BODY_SLEEPING   (1u << 5)
+#define BODY_LOADED     (1u << 6)   // copied in this tick
+#define BODY_WOKEN      (1u << 7)   // woken this tick without being copied in
+#define BODY_LAYOUT     (BODY_POSITION | BODY_VELOCITY | BODY_MASS | BODY_COLLIDER)
+
+// Everything the physics step reads and writes about a body, as
+// structure-of-arrays indexed by row. Rows are owned and ordered by the
+// caller; `ids` are the handles (entities) the rows were copied from.
+// Fields a row has no component for hold neutral values: zero velocity,
+// zero inverse mass, no grounded or island handle (-1), mesh -1.
+typedef struct {
+  int             *ids;
+  float           *px, *py, *pz;
+  float           *vx, *vy, *vz;
+  float           *hx, *hy, *hz;
+  float           *inv_mass;
+  float           *friction;
+  float           *restitution;
+  int             *mesh;
+  int             *grounded;
+  float           *sleep_time;
+  float           *rx, *ry, *rz;      // where the body came to rest
+  int             *island;
+  int             *island_size;
+  unsigned char   *flags;
+  int             count;
+  int             capacity;
+} RigidBodies;
+
+void rigid_bodies_init(RigidBodies *b);
+// Keeps the first `count` rows.
+void rigid_bodies_reserve(RigidBodies *b, int capacity);
+void rigid_bodies_destroy(RigidBodies *b);
+
+static inline Vec3f rigid_body_position(const RigidBodies *b, int i) {
+  return (Vec3f){ b->px[i], b->py[i], b->pz[i] };
+}
+
+static inline void rigid_body_set_position(RigidBodies *b, int i, Vec3f p) {
+  b->px[i] = p.x;
+  b->py[i] = p.y;
+  b->pz[i] = p.z;
+}
+
+static inline Vec3f rigid_body_velocity(const RigidBodies *b, int i) {
+  return (Vec3f){ b->vx[i], b->vy[i], b->vz[i] };
+}
+
+static inline void rigid_body_set_velocity(RigidBodies *b, int i, Vec3f v) {
+  b->vx[i] = v.x;
+  b->vy[i] = v.y;
+  b->vz[i] = v.z;
+}
+
+static inline Vec3f rigid_body_half_extents(const RigidBodies *b, int i) {
+  return (Vec3f){ b->hx[i], b->hy[i], b->hz[i] };
+}
+
+// The row's box grown by `margin` on every side.
+static inline Aabb rigid_body_bounds(const RigidBodies *b, int i, float margin) {
+  Vec3f p    = rigid_body_position(b, i);
+  Vec3f half = vec3f_add(rigid_body_half_extents(b, i), (Vec3f){ margin, margin, margin });
+  return (Aabb){ vec3f_sub(p, half), vec3f_add(p, half) };
+}
+
+#endif
@@ -0,0 +1,278 @@
+#include "SpatialHash.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN_BUCKETS 16
+#define MAX_CELL_COORD 1.0e9f
+
+void spatial_hash_init(SpatialHash *h) {
+  memset(h, 0, sizeof(SpatialHash));
+  h->cell_size = 1.0f;
+}
+
+// LISTS
+
+static void index_push(IndexList *list, int value) {
+  if (list->count == list->capacity) {
+    list->capacity = list->capacity ? list->capacity * 2 : 16;
+    list->items = realloc(list->items, list->capacity * sizeof(int));
+  }
+  list->items[list->count++] = value;
+}
+
+static unsigned int cell_hash(int cx, int cy, int cz) {
+  return ((unsigned int)cx * 73856093u) ^ ((unsigned int)cy * 19349663u) ^ ((unsigned int)cz * 83492791u);
+}
+
+// LAYERS
+
+static void layer_add(HashLayer *l, int cx, int cy, int cz, int body) {
+  if (l->count == l->capacity) {
+    l->capacity = l->capacity ? l->capacity * 2 : 64;
+    l->scratch = realloc(l->scratch, l->capacity * sizeof(HashEntry));
+    l->entries = realloc(l->entries, l->capacity * sizeof(HashEntry));
+  }
+  l->scratch[l->count++] = (HashEntry){ cx, cy, cz, body };
+}
+
+// Counting sort of the added entries by bucket. Entries keep their add
+// order within a bucket, so the layout is deterministic.
+static void layer_finish(HashLayer *l) {
+  int buckets = MIN_BUCKETS;
+  while (buckets < l->count * 2) buckets *= 2;
+  if (buckets + 1 > l->bucket_capacity) {
+    l->bucket_capacity = buckets + 1;
+    l->start = realloc(l->start, l->bucket_capacity * sizeof(int));
+  }
+  l->bucket_count = buckets;
+
+  unsigned int mask = (unsigned int)buckets - 1;
+  memset(l->start, 0, (buckets + 1) * sizeof(int));
+  for (int i = 0; i < l->count; i++) {
+    HashEntry *e = &l->scratch[i];
+    l->start[(cell_hash(e->cx, e->cy, e->cz) & mask) + 1]++;
+  }
+  for (int b = 0; b < buckets; b++) l->start[b + 1] += l->start[b];
+
+  // start[b] doubles as the write cursor, then is shifted back.
+  for (int i = 0; i < l->count; i++) {
+    HashEntry *e = &l->scratch[i];
+    l->entries[l->start[cell_hash(e->cx, e->cy, e->cz) & mask]++] = *e;
+  }
+  for (int b = buckets; b > 0; b--) l->start[b] = l->start[b - 1];
+  l->start[0] = 0;
+}
+
+static void layer_destroy(HashLayer *l) {
+  free(l->entries);
+  free(l->scratch);
+  free(l->start);
+  memset(l, 0, sizeof(HashLayer));
+}
+
+// CELLS
+
+// floorf without the libm call; callers keep |v * inv_cell| in int range.
+static int cell_of(float v, float inv_cell) {
+  float f = v * inv_cell;
+  int i = (int)f;
+  return i - (f < (float)i);
+}
+
+static int in_grid(float v, float inv_cell) {
+  return fabsf(v * inv_cell) < MAX_CELL_COORD;
+}
+
+// Fills the inclusive cell range of `b` and returns 0 if it covers more
+// than `max_cells` (or lies outside the grid), so it can be handled
+// outside the grid.
+static int cell_range(const Aabb *b, float inv_cell, int max_cells, int lo[3], int hi[3]) {
+  if (!in_grid(b->min.x, inv_cell) || !in_grid(b->min.y, inv_cell) || !in_grid(b->min.z, inv_cell) ||
+      !in_grid(b->max.x, inv_cell) || !in_grid(b->max.y, inv_cell) || !in_grid(b->max.z, inv_cell)) {
+    return 0;
+  }
+
+  lo[0] = cell_of(b->min.x, inv_cell);
+  lo[1] = cell_of(b->min.y, inv_cell);
+  lo[2] = cell_of(b->min.z, inv_cell);
+  hi[0] = cell_of(b->max.x, inv_cell);
+  hi[1] = cell_of(b->max.y, inv_cell);
+  hi[2] = cell_of(b->max.z, inv_cell);
+
+  double span = (double)(hi[0] - lo[0] + 1) * (hi[1] - lo[1] + 1) * (hi[2] - lo[2] + 1);
+  return span <= max_cells;
+}
+
+static void add_cells(HashLayer *l, const int lo[3], const int hi[3], int body) {
+  for (int x = lo[0]; x <= hi[0]; x++) {
+    for (int y = lo[1]; y <= hi[1]; y++) {
+      for (int z = lo[2]; z <= hi[2]; z++) {
+        layer_add(l, x, y, z, body);
+      }
+    }
+  }
+}
+
+// Two overlapping boxes share every cell their intersection touches; the
+// pair is only reported from the cell holding the intersection's minimum
+// corner, which makes each pair come out once without a dedup pass.
+static int owns_pair(const HashEntry *e, const Aabb *a, const Aabb *b, float inv_cell) {
+  return e->cx == cell_of(fmaxf(a->min.x, b->min.x), inv_cell) &&
+         e->cy == cell_of(fmaxf(a->min.y, b->min.y), inv_cell) &&
+         e->cz == cell_of(fmaxf(a->min.z, b->min.z), inv_cell);
+}
+
+static int same_cell(const HashEntry *a, const HashEntry *b) {
+  return a->cx == b->cx && a->cy == b->cy && a->cz == b->cz;
+}
+
+// Power-of-two cell edge close to the mean dynamic body size, so it only
+// changes (and forces a static rebuild) when body sizes shift a lot.
+static float choose_cell_size(const BroadphaseInput *in) {
+  double total = 0.0;
+  int dynamic = 0;
+  for (int i = 0; i < in->count; i++) {
+    if (in->is_static[i]) continue;
+    const Aabb *b = &in->bounds[i];
+    float size = fmaxf(b->max.x - b->min.x, fmaxf(b->max.y - b->min.y, b->max.z - b->min.z));
+    total += size;
+    dynamic++;
+  }
+  if (dynamic == 0 || !(total > 0.0)) return 1.0f;
+  return exp2f(ceilf(log2f((float)(total / dynamic))));
+}
+
+// STATICS
+
+static void build_statics(SpatialHash *h, const BroadphaseInput *in, int static_count) {
+  float inv_cell = 1.0f / h->cell_size;
+  int lo[3], hi[3];
+
+  h->statics.count = 0;
+  h->big_statics.count = 0;
+  for (int i = 0; i < in->count; i++) {
+    if (!in->is_static[i]) continue;
+    if (cell_range(&in->bounds[i], inv_cell, HASH_MAX_STATIC_CELLS, lo, hi)) {
+      add_cells(&h->statics, lo, hi, i);
+    } else {
+      index_push(&h->big_statics, i);
+    }
+  }
+  layer_finish(&h->statics);
+
+  h->static_count   = static_count;
+  h->layout_version = in->layout_version;
+  h->static_ready   = 1;
+}
+
+// PAIRS
+
+static void dynamic_pairs(SpatialHash *h, const BroadphaseInput *in, PairList *out) {
+  float inv_cell = 1.0f / h->cell_size;
+  HashLayer *l = &h->dynamics;
+
+  for (int b = 0; b < l->bucket_count; b++) {
+    for (int i = l->start[b]; i < l->start[b + 1]; i++) {
+      HashEntry *e = &l->entries[i];
+      const Aabb *ba = &in->bounds[e->body];
+
+      for (int j = i + 1; j < l->start[b + 1]; j++) {
+        HashEntry *f = &l->entries[j];
+        const Aabb *bb = &in->bounds[f->body];
+        if (!same_cell(e, f) || !aabb_overlaps(ba, bb) || !owns_pair(e, ba, bb, inv_cell)) continue;
+        pair_list_push(out, e->body, f->body);
+      }
+    }
+  }
+}
+
+static void static_pairs(SpatialHash *h, const BroadphaseInput *in, PairList *out) {
+  float inv_cell = 1.0f / h->cell_size;
+  HashLayer *s = &h->statics;
+  unsigned int mask = (unsigned int)s->bucket_count - 1;
+
+  for (int i = 0; i < h->dynamics.count; i++) {
+    HashEntry *e = &h->dynamics.entries[i];
+    const Aabb *ba = &in->bounds[e->body];
+
+    unsigned int bucket = cell_hash(e->cx, e->cy, e->cz) & mask;
+    for (int j = s->start[bucket]; j < s->start[bucket + 1]; j++) {
+      HashEntry *f = &s->entries[j];
+      const Aabb *bb = &in->bounds[f->body];
+      if (!same_cell(e, f) || !aabb_overlaps(ba, bb) || !owns_pair(e, ba, bb, inv_cell)) continue;
+      pair_list_push(out, e->body, f->body);
+    }
+  }
+}
+
+// Oversized bodies are tested against everything they could pair with;
+// among two oversized dynamics only the lower index does the test.
+static void oversized_pairs(SpatialHash *h, const BroadphaseInput *in, PairList *out) {
+  for (int k = 0; k < h->big_dynamics.count; k++) {
+    int d = h->big_dynamics.items[k];
+    for (int j = 0; j < in->count; j++) {
+      if (j == d) continue;
+      if (!in->is_static[j] && h->big[j] && j < d) continue;
+      if (aabb_overlaps(&in->bounds[d], &in->bounds[j])) pair_list_push(out, d, j);
+    }
+  }
+
+  for (int k = 0; k < h->big_statics.count; k++) {
+    int s = h->big_statics.items[k];
+    for (int j = 0; j < in->count; j++) {
+      if (in->is_static[j] || h->big[j]) continue;
+      if (aabb_overlaps(&in->bounds[s], &in->bounds[j])) pair_list_push(out, s, j);
+    }
+  }
+}
+
+void spatial_hash_pairs(SpatialHash *h, const BroadphaseInput *in, PairList *out) {
+  out->count = 0;
+  if (in->count == 0) return;
+
+  int static_count = 0;
+  for (int i = 0; i < in->count; i++) static_count += in->is_static[i] != 0;
+
+  float cell_size = choose_cell_size(in);
+  if (!h->static_ready || h->layout_version != in->layout_version ||
+      h->static_count != static_count || h->cell_size != cell_size) {
+    h->cell_size = cell_size;
+    build_statics(h, in, static_count);
+  }
+
+  if (in->count > h->big_capacity) {
+    h->big_capacity = in->count;
+    h->big = realloc(h->big, h->big_capacity);
+  }
+
+  float inv_cell = 1.0f / h->cell_size;
+  int lo[3], hi[3];
+
+  h->dynamics.count = 0;
+  h->big_dynamics.count = 0;
+  for (int i = 0; i < in->count; i++) {
+    h->big[i] = 0;
+    if (in->is_static[i]) continue;
+    if (cell_range(&in->bounds[i], inv_cell, HASH_MAX_DYNAMIC_CELLS, lo, hi)) {
+      add_cells(&h->dynamics, lo, hi, i);
+    } else {
+      h->big[i] = 1;
+      index_push(&h->big_dynamics, i);
+    }
+  }
+  layer_finish(&h->dynamics);
+
+  dynamic_pairs(h, in, out);
+  static_pairs(h, in, out);
+  oversized_pairs(h, in, out);
+}
+
+void spatial_hash_destroy(SpatialHash *h) {
+  layer_destroy(&h->statics);
+  layer_destroy(&h->dynamics);
+  free(h->big_statics.items);
+  free(h->big_dynamics.items);
+  free(h->big);
+  spatial_hash_init(h);
+}
@@ -0,0 +1,54 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include "physics/PairList.h"
+
+// Bodies covering more cells than this skip the grid and are tested
+// against everything instead (e.g. a ground plane).
+#define HASH_MAX_DYNAMIC_CELLS  64
+#define HASH_MAX_STATIC_CELLS   4096
+
+typedef struct {
+  int cx, cy, cz;
+  int body;
+} HashEntry;
+
+// One grid layer in compact form: entries grouped by bucket, with
+// bucket b spanning entries[start[b] .. start[b + 1]).
+typedef struct {
+  HashEntry *entries;
+  HashEntry *scratch;
+  int       count;
+  int       capacity;
+  int       *start;
+  int       bucket_count;
+  int       bucket_capacity;
+} HashLayer;
+
+typedef struct {
+  int *items;
+  int count;
+  int capacity;
+} IndexList;
+
+// Uniform grid keyed by hashed cell coordinates. Static bodies go into
+// their own layer, which is kept until the static set changes; dynamic
+// bodies are re-bucketed every call, which is a linear pass.
+typedef struct {
+  float         cell_size;
+  HashLayer     statics;
+  HashLayer     dynamics;
+  IndexList     big_statics;
+  IndexList     big_dynamics;
+  unsigned char *big;
+  int           big_capacity;
+  int           static_count;
+  unsigned int  layout_version;
+  int           static_ready;
+} SpatialHash;
+
+void spatial_hash_init(SpatialHash *h);
+void spatial_hash_pairs(SpatialHash *h, const BroadphaseInput *in, PairList *out);
+void spatial_hash_destroy(SpatialHash *h);
+
+#endif
@@ -0,0 +1,256 @@
+#include "StaticBvh.h"
+#include "core/Trace.h"
+#include <stdlib.h>
+#include <string.h>
+
+void static_bvh_init(StaticBvh *bvh) {
+  memset(bvh, 0, sizeof(StaticBvh));
+}
+
+static void grow(StaticBvh *bvh, int count) {
+  if (count <= bvh->capacity) return;
+  bvh->capacity = count;
+  bvh->min_x    = realloc(bvh->min_x, count * sizeof(float));
+  bvh->min_y    = realloc(bvh->min_y, count * sizeof(float));
+  bvh->min_z    = realloc(bvh->min_z, count * sizeof(float));
+  bvh->max_x    = realloc(bvh->max_x, count * sizeof(float));
+  bvh->max_y    = realloc(bvh->max_y, count * sizeof(float));
+  bvh->max_z    = realloc(bvh->max_z, count * sizeof(float));
+  bvh->ids      = realloc(bvh->ids, count * sizeof(int));
+  bvh->order    = realloc(bvh->order, count * sizeof(int));
+  bvh->centers  = realloc(bvh->centers, count * sizeof(Vec3f));
+
+  // A subtree over m boxes has at most 2m - 1 nodes.
+  bvh->node_capacity = count * 2;
+  bvh->nodes = realloc(bvh->nodes, bvh->node_capacity * sizeof(BvhNode));
+}
+
+// BUILD
+
+static Vec3f min3(Vec3f a, Vec3f b) {
+  return (Vec3f){ a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y, a.z < b.z ? a.z : b.z };
+}
+
+static Vec3f max3(Vec3f a, Vec3f b) {
+  return (Vec3f){ a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y, a.z > b.z ? a.z : b.z };
+}
+
+static float axis_value(Vec3f v, int axis) {
+  return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+// Partially sorts order[lo, hi) so order[nth] holds the box whose centre
+// would be there if fully sorted along `axis`, with no larger centre before
+// it and no smaller one after.
+static void select_nth(const Vec3f *centers, int *order, int lo, int hi, int nth, int axis) {
+  while (hi - lo > 1) {
+    float pivot = axis_value(centers[order[lo + (hi - lo) / 2]], axis);
+    int i = lo, j = hi - 1;
+    while (i <= j) {
+      while (axis_value(centers[order[i]], axis) < pivot) i++;
+      while (axis_value(centers[order[j]], axis) > pivot) j--;
+      if (i <= j) {
+        int t = order[i];
+        order[i++] = order[j];
+        order[j--] = t;
+      }
+    }
+    if (nth <= j) {
+      hi = j + 1;
+    } else if (nth >= i) {
+      lo = i;
+    } else {
+      return;
+    }
+  }
+}
+
+static int build_node(StaticBvh *bvh, const Aabb *boxes, int begin, int end) {
+  int index = bvh->node_count++;
+  BvhNode *node = &bvh->nodes[index];
+
+  Aabb box = boxes[bvh->order[begin]];
+  Vec3f lo = bvh->centers[bvh->order[begin]], hi = lo;
+  for (int i = begin + 1; i < end; i++) {
+    const Aabb *b = &boxes[bvh->order[i]];
+    Vec3f c = bvh->centers[bvh->order[i]];
+    box.min = min3(box.min, b->min);
+    box.max = max3(box.max, b->max);
+    lo = min3(lo, c);
+    hi = max3(hi, c);
+  }
+  node->box = box;
+
+  if (end - begin <= BVH_LEAF_SIZE) {
+    node->first = begin;
+    node->count = end - begin;
+    return index;
+  }
+
+  Vec3f extent = vec3f_sub(hi, lo);
+  int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+  int mid = begin + (end - begin) / 2;
+  select_nth(bvh->centers, bvh->order, begin, end, mid, axis);
+
+  build_node(bvh, boxes, begin, mid);
+  node->first = build_node(bvh, boxes, mid, end);
+  node->count = 0;
+  return index;
+}
+
+static float box_size(const Aabb *b) {
+  Vec3f d = vec3f_sub(b->max, b->min);
+  return d.x > d.y ? (d.x > d.z ? d.x : d.z) : (d.y > d.z ? d.y : d.z);
+}
+
+// Moves boxes far larger than average (floors, terrain slabs) to the front
+// of `order` and returns how many there are. Mixed in with the rest, one of
+// them inflates every node on its path to the root, and any query that
+// touches it would walk both sides of each of those nodes.
+static int partition_oversized(StaticBvh *bvh, const Aabb *boxes, int count) {
+  double total = 0.0;
+  for (int i = 0; i < count; i++) total += box_size(&boxes[i]);
+  float limit = (float)(total / count) * BVH_OVERSIZED;
+
+  int big = 0;
+  for (int i = 0; i < count; i++) {
+    if (box_size(&boxes[bvh->order[i]]) <= limit) continue;
+    int t = bvh->order[big];
+    bvh->order[big++] = bvh->order[i];
+    bvh->order[i] = t;
+  }
+  return big;
+}
+
+// `ids` may be NULL, in which case a box is reported by its index.
+void static_bvh_build(StaticBvh *bvh, const Aabb *boxes, const int *ids, int count) {
+  TRACE_FN();
+  bvh->count = 0;
+  bvh->node_count = 0;
+  if (count <= 0) return;
+  grow(bvh, count);
+
+  for (int i = 0; i < count; i++) {
+    bvh->order[i]   = i;
+    bvh->centers[i] = vec3f_scale(vec3f_add(boxes[i].min, boxes[i].max), 0.5f);
+  }
+
+  // Oversized boxes get their own subtree right under the root.
+  int big = partition_oversized(bvh, boxes, count);
+  if (big == 0 || big == count) {
+    build_node(bvh, boxes, 0, count);
+  } else {
+    BvhNode *root = &bvh->nodes[bvh->node_count++];
+    build_node(bvh, boxes, 0, big);
+    root->first = build_node(bvh, boxes, big, count);
+    root->count = 0;
+    const Aabb *a = &bvh->nodes[1].box, *b = &bvh->nodes[root->first].box;
+    root->box = (Aabb){ min3(a->min, b->min), max3(a->max, b->max) };
+  }
+
+  for (int i = 0; i < count; i++) {
+    const Aabb *b = &boxes[bvh->order[i]];
+    bvh->min_x[i] = b->min.x;
+    bvh->min_y[i] = b->min.y;
+    bvh->min_z[i] = b->min.z;
+    bvh->max_x[i] = b->max.x;
+    bvh->max_y[i] = b->max.y;
+    bvh->max_z[i] = b->max.z;
+    bvh->ids[i]   = ids ? ids[bvh->order[i]] : bvh->order[i];
+  }
+  bvh->count = count;
+}
+
+// QUERY
+
+// Same test as aabb_overlaps, but without short-circuiting: node tests in
+// a traversal are close to coin flips, and six unpredictable branches per
+// node cost more than doing all six compares.
+static int overlaps(const Aabb *a, const Aabb *b) {
+  return (a->min.x <= b->max.x) & (b->min.x <= a->max.x) &
+         (a->min.y <= b->max.y) & (b->min.y <= a->max.y) &
+         (a->min.z <= b->max.z) & (b->min.z <= a->max.z);
+}
+
+// Reports every box overlapping `box` (inclusive, like aabb_overlaps).
+void static_bvh_query(const StaticBvh *bvh, const Aabb *box, BvhQueryFn fn, void *ctx) {
+  if (bvh->node_count == 0) return;
+
+  int stack[BVH_MAX_DEPTH];
+  int top = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    int index = stack[--top];
+    const BvhNode *n = &bvh->nodes[index];
+    if (!overlaps(&n->box, box)) continue;
+
+    if (n->count == 0) {
+      stack[top++] = n->first;
+      stack[top++] = index + 1;
+      continue;
+    }
+
+    for (int i = n->first; i < n->first + n->count; i++) {
+      int hit = (bvh->min_x[i] <= box->max.x) & (box->min.x <= bvh->max_x[i]) &
+                (bvh->min_y[i] <= box->max.y) & (box->min.y <= bvh->max_y[i]) &
+                (bvh->min_z[i] <= box->max.z) & (box->min.z <= bvh->max_z[i]);
+      if (hit && !fn(ctx, bvh->ids[i])) return;
+    }
+  }
+}
+
+// Closest hits of every lane of the packet. A node is entered with the
+// lanes that reached its parent and kept only for those that reach it
+// too, so shortened lanes drop out of far subtrees.
+void static_bvh_raycast_packet(const StaticBvh *bvh, RayPacket *packet, RayHitFn fn, void *ctx) {
+  if (bvh->node_count == 0 || packet->count == 0) return;
+
+  int stack[BVH_MAX_DEPTH];
+  unsigned int masks[BVH_MAX_DEPTH];
+  int top = 0;
+  stack[top] = 0;
+  masks[top++] = ray_packet_all(packet);
+  while (top > 0) {
+    --top;
+    int index = stack[top];
+    const BvhNode *n = &bvh->nodes[index];
+    unsigned int lanes = ray_packet_test(packet, &n->box, masks[top]);
+    if (!lanes) continue;
+
+    if (n->count == 0) {
+      int first = index + 1, second = n->first;
+      if (ray_packet_prefers(packet, lanes, &bvh->nodes[first].box, &bvh->nodes[second].box)) {
+        first = n->first;
+        second = index + 1;
+      }
+      stack[top] = second;
+      masks[top++] = lanes;
+      stack[top] = first;
+      masks[top++] = lanes;
+      continue;
+    }
+
+    for (int i = n->first; i < n->first + n->count; i++) {
+      Aabb box = {
+        { bvh->min_x[i], bvh->min_y[i], bvh->min_z[i] },
+        { bvh->max_x[i], bvh->max_y[i], bvh->max_z[i] }
+      };
+      unsigned int hit = ray_packet_test(packet, &box, lanes);
+      if (hit) ray_packet_hit(packet, hit, bvh->ids[i], fn, ctx);
+    }
+  }
+}
+
+void static_bvh_destroy(StaticBvh *bvh) {
+  free(bvh->nodes);
+  free(bvh->min_x);
+  free(bvh->min_y);
+  free(bvh->min_z);
+  free(bvh->max_x);
+  free(bvh->max_y);
+  free(bvh->max_z);
+  free(bvh->ids);
+  free(bvh->order);
+  free(bvh->centers);
+  static_bvh_init(bvh);
+}
@@ -0,0 +1,49 @@
+#ifndef STATIC_BVH_H
+#define STATIC_BVH_H
+
+#include "physics/PairList.h"
+#include "physics/RayPacket.h"
+
+#define BVH_LEAF_SIZE 4
+// Median splits keep the depth near log2(count / BVH_LEAF_SIZE), far below
+// this for any entity count the world can hold.
+#define BVH_MAX_DEPTH 64
+// Boxes this many times larger than the average are kept apart from the rest.
+#define BVH_OVERSIZED 16.0f
+
+// A leaf (count > 0) covers boxes [first, first + count). An internal
+// node's children are the node right after it and node `first`.
+typedef struct {
+  Aabb  box;
+  int   first;
+  int   count;
+} BvhNode;
+
+// Immutable bounding-volume hierarchy for boxes that never move. Built
+// top-down by splitting at the median centre along the widest axis, with
+// nodes in depth-first order and the boxes stored as structure-of-arrays
+// in leaf order, so a query walks a compact array and each leaf is a short
+// linear scan. Oversized boxes are split off into their own subtree first.
+typedef struct {
+  BvhNode   *nodes;
+  int       node_count;
+  int       node_capacity;
+  float     *min_x, *min_y, *min_z;
+  float     *max_x, *max_y, *max_z;
+  int       *ids;
+  int       count;
+  int       capacity;
+  int       *order;
+  Vec3f     *centers;
+} StaticBvh;
+
+// Returns 0 to stop the query.
+typedef int (*BvhQueryFn)(void *ctx, int id);
+
+void static_bvh_init(StaticBvh *bvh);
+void static_bvh_build(StaticBvh *bvh, const Aabb *boxes, const int *ids, int count);
+void static_bvh_query(const StaticBvh *bvh, const Aabb *box, BvhQueryFn fn, void *ctx);
+void static_bvh_raycast_packet(const StaticBvh *bvh, RayPacket *packet, RayHitFn fn, void *ctx);
+void static_bvh_destroy(StaticBvh *bvh);
+
+#endif
@@ -0,0 +1,278 @@
+#include "SweepAndPrune.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define EMPTY_KEY     UINT64_MAX
+#define MIN_SLOTS     64
+
+void sweep_prune_init(SweepAndPrune *s) {
+  memset(s, 0, sizeof(SweepAndPrune));
+  pair_list_init(&s->set.pairs);
+  pair_list_init(&s->set.ids);
+  pair_list_init(&s->previous.pairs);
+  pair_list_init(&s->previous.ids);
+  pair_list_init(&s->began);
+  pair_list_init(&s->ended);
+}
+
+// PAIR SET
+
+static uint64_t pair_key(int id_a, int id_b) {
+  if (id_a > id_b) {
+    int t = id_a;
+    id_a = id_b;
+    id_b = t;
+  }
+  return (uint64_t)(uint32_t)id_a << 32 | (uint32_t)id_b;
+}
+
+static unsigned int key_hash(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+  return (unsigned int)key;
+}
+
+static int find_slot(const PairSet *set, uint64_t key) {
+  if (!set->slot_count) return -1;
+  unsigned int mask = (unsigned int)set->slot_count - 1;
+  for (unsigned int i = key_hash(key) & mask; ; i = (i + 1) & mask) {
+    if (set->slots[i].key == key) return (int)i;
+    if (set->slots[i].key == EMPTY_KEY) return -1;
+  }
+}
+
+static void insert_slot(PairSet *set, uint64_t key, int index) {
+  unsigned int mask = (unsigned int)set->slot_count - 1;
+  unsigned int i = key_hash(key) & mask;
+  while (set->slots[i].key != EMPTY_KEY) i = (i + 1) & mask;
+  set->slots[i] = (PairSlot){ key, index };
+}
+
+static void grow_slots(PairSet *set, int min_count) {
+  int slot_count = set->slot_count ? set->slot_count : MIN_SLOTS;
+  while (slot_count < min_count * 2) slot_count *= 2;
+  if (slot_count == set->slot_count) return;
+
+  set->slot_count = slot_count;
+  set->slots = realloc(set->slots, slot_count * sizeof(PairSlot));
+  for (int i = 0; i < slot_count; i++) set->slots[i].key = EMPTY_KEY;
+  for (int i = 0; i < set->ids.count; i++) {
+    insert_slot(set, pair_key(set->ids.pairs[i].a, set->ids.pairs[i].b), i);
+  }
+}
+
+static int set_contains(const PairSet *set, int id_a, int id_b) {
+  return find_slot(set, pair_key(id_a, id_b)) >= 0;
+}
+
+static int set_add(PairSet *set, int a, int b, int id_a, int id_b) {
+  uint64_t key = pair_key(id_a, id_b);
+  if (find_slot(set, key) >= 0) return 0;
+
+  grow_slots(set, set->ids.count + 1);
+  insert_slot(set, key, set->ids.count);
+  pair_list_push(&set->pairs, a, b);
+  pair_list_push(&set->ids, id_a, id_b);
+  return 1;
+}
+
+// Swap-removes the dense entry and backward-shifts the probe chain, so
+// lookups never need tombstones.
+static int set_remove(PairSet *set, int id_a, int id_b) {
+  int slot = find_slot(set, pair_key(id_a, id_b));
+  if (slot < 0) return 0;
+
+  int index = set->slots[slot].index;
+  int last  = set->ids.count - 1;
+  if (index != last) {
+    set->pairs.pairs[index] = set->pairs.pairs[last];
+    set->ids.pairs[index]   = set->ids.pairs[last];
+    int moved = find_slot(set, pair_key(set->ids.pairs[index].a, set->ids.pairs[index].b));
+    set->slots[moved].index = index;
+  }
+  set->pairs.count--;
+  set->ids.count--;
+
+  unsigned int mask = (unsigned int)set->slot_count - 1;
+  unsigned int hole = (unsigned int)slot;
+  for (unsigned int i = (hole + 1) & mask; set->slots[i].key != EMPTY_KEY; i = (i + 1) & mask) {
+    unsigned int home = key_hash(set->slots[i].key) & mask;
+    // Move the entry into the hole unless its home lies cyclically in (hole, i].
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      set->slots[hole] = set->slots[i];
+      hole = i;
+    }
+  }
+  set->slots[hole].key = EMPTY_KEY;
+  return 1;
+}
+
+static void set_clear(PairSet *set) {
+  set->pairs.count = 0;
+  set->ids.count = 0;
+  for (int i = 0; i < set->slot_count; i++) set->slots[i].key = EMPTY_KEY;
+}
+
+static void set_destroy(PairSet *set) {
+  pair_list_destroy(&set->pairs);
+  pair_list_destroy(&set->ids);
+  free(set->slots);
+  set->slots = NULL;
+  set->slot_count = 0;
+}
+
+// ENDPOINTS
+
+static int body_id(const BroadphaseInput *in, int body) {
+  return in->ids ? in->ids[body] : body;
+}
+
+static float endpoint_value(const BroadphaseInput *in, int tag, int axis) {
+  const Aabb *b = &in->bounds[tag >> 1];
+  const Vec3f *v = (tag & 1) ? &b->max : &b->min;
+  return axis == 0 ? v->x : axis == 1 ? v->y : v->z;
+}
+
+// At equal values mins sort before maxes, which matches the inclusive
+// aabb_overlaps test: touching bounds overlap.
+static int endpoint_less(const Endpoint *x, const Endpoint *y) {
+  return x->value < y->value || (x->value == y->value && !(x->tag & 1) && (y->tag & 1));
+}
+
+static int compare_endpoints(const void *x, const void *y) {
+  if (endpoint_less(x, y)) return -1;
+  if (endpoint_less(y, x)) return 1;
+  return 0;
+}
+
+static void touch_pair(SweepAndPrune *s, const BroadphaseInput *in, int a, int b, int overlapping) {
+  if (in->is_static[a] && in->is_static[b]) return;
+  int id_a = body_id(in, a), id_b = body_id(in, b);
+
+  if (overlapping) {
+    if (!aabb_overlaps(&in->bounds[a], &in->bounds[b])) return;
+    if (set_add(&s->set, a, b, id_a, id_b)) pair_list_push(&s->began, id_a, id_b);
+  } else {
+    if (set_remove(&s->set, id_a, id_b)) pair_list_push(&s->ended, id_a, id_b);
+  }
+}
+
+// Insertion sort; each time an endpoint passes another the pair's overlap
+// on this axis flips, and the full 3D test decides the pair's state.
+static void sort_axis(SweepAndPrune *s, const BroadphaseInput *in, int axis) {
+  Endpoint *e = s->axes[axis];
+  int n = s->count * 2;
+
+  for (int i = 0; i < n; i++) e[i].value = endpoint_value(in, e[i].tag, axis);
+
+  for (int i = 1; i < n; i++) {
+    Endpoint cur = e[i];
+    int j = i - 1;
+    for (; j >= 0 && endpoint_less(&cur, &e[j]); j--) {
+      int cur_max = cur.tag & 1, other_max = e[j].tag & 1;
+      if (cur_max != other_max) touch_pair(s, in, cur.tag >> 1, e[j].tag >> 1, !cur_max);
+      e[j + 1] = e[j];
+    }
+    e[j + 1] = cur;
+  }
+}
+
+// REBUILD
+
+static void grow(SweepAndPrune *s, int count) {
+  if (count <= s->capacity) return;
+  s->capacity = count;
+  for (int axis = 0; axis < 3; axis++) {
+    s->axes[axis] = realloc(s->axes[axis], count * 2 * sizeof(Endpoint));
+  }
+  s->active = realloc(s->active, count * sizeof(int));
+}
+
+// Sorts every axis from scratch and sweeps x for the initial pair set.
+// The previous set is kept by id, so pairs that survive a reindex raise
+// no events.
+static void rebuild(SweepAndPrune *s, const BroadphaseInput *in, int static_count) {
+  grow(s, in->count);
+  s->count = in->count;
+
+  PairSet swap = s->previous;
+  s->previous = s->set;
+  s->set = swap;
+  set_clear(&s->set);
+
+  for (int axis = 0; axis < 3; axis++) {
+    Endpoint *e = s->axes[axis];
+    for (int i = 0; i < s->count * 2; i++) {
+      e[i].tag   = i;
+      e[i].value = endpoint_value(in, i, axis);
+    }
+    qsort(e, s->count * 2, sizeof(Endpoint), compare_endpoints);
+  }
+
+  int active = 0;
+  Endpoint *x = s->axes[0];
+  for (int i = 0; i < s->count * 2; i++) {
+    int body = x[i].tag >> 1;
+    if (x[i].tag & 1) {
+      for (int k = 0; k < active; k++) {
+        if (s->active[k] != body) continue;
+        s->active[k] = s->active[--active];
+        break;
+      }
+      continue;
+    }
+
+    for (int k = 0; k < active; k++) {
+      int other = s->active[k];
+      if (in->is_static[body] && in->is_static[other]) continue;
+      if (!aabb_overlaps(&in->bounds[body], &in->bounds[other])) continue;
+      set_add(&s->set, other, body, body_id(in, other), body_id(in, body));
+    }
+    s->active[active++] = body;
+  }
+
+  for (int i = 0; i < s->set.ids.count; i++) {
+    BodyPair p = s->set.ids.pairs[i];
+    if (!set_contains(&s->previous, p.a, p.b)) pair_list_push(&s->began, p.a, p.b);
+  }
+  for (int i = 0; i < s->previous.ids.count; i++) {
+    BodyPair p = s->previous.ids.pairs[i];
+    if (!set_contains(&s->set, p.a, p.b)) pair_list_push(&s->ended, p.a, p.b);
+  }
+  set_clear(&s->previous);
+
+  s->static_count   = static_count;
+  s->layout_version = in->layout_version;
+  s->ready          = 1;
+}
+
+void sweep_prune_pairs(SweepAndPrune *s, const BroadphaseInput *in, PairList *out) {
+  s->began.count = 0;
+  s->ended.count = 0;
+
+  int static_count = 0;
+  for (int i = 0; i < in->count; i++) static_count += in->is_static[i] != 0;
+
+  if (!s->ready || s->layout_version != in->layout_version ||
+      s->count != in->count || s->static_count != static_count) {
+    rebuild(s, in, static_count);
+  } else {
+    for (int axis = 0; axis < 3; axis++) sort_axis(s, in, axis);
+  }
+
+  out->count = 0;
+  for (int i = 0; i < s->set.pairs.count; i++) {
+    pair_list_push(out, s->set.pairs.pairs[i].a, s->set.pairs.pairs[i].b);
+  }
+}
+
+void sweep_prune_destroy(SweepAndPrune *s) {
+  for (int axis = 0; axis < 3; axis++) free(s->axes[axis]);
+  free(s->active);
+  set_destroy(&s->set);
+  set_destroy(&s->previous);
+  pair_list_destroy(&s->began);
+  pair_list_destroy(&s->ended);
+  sweep_prune_init(s);
+}
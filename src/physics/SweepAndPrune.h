@@ -0,0 +1,52 @@
+#ifndef SWEEP_AND_PRUNE_H
+#define SWEEP_AND_PRUNE_H
+
+#include <stdint.h>
+#include "physics/PairList.h"
+
+typedef struct {
+  float value;
+  int   tag;      // body << 1, low bit set for a max endpoint
+} Endpoint;
+
+typedef struct {
+  uint64_t  key;
+  int       index;
+} PairSlot;
+
+// Dense list of overlapping pairs (as body indices and, in parallel, as
+// ids) plus an open-addressing index from the id pair to its position.
+typedef struct {
+  PairList  pairs;
+  PairList  ids;
+  PairSlot  *slots;
+  int       slot_count;
+} PairSet;
+
+// Incremental sort-and-sweep. Min/max endpoints of every body are kept
+// sorted per axis and re-sorted with insertion sort each call, which is
+// close to linear when bodies barely move. Whenever a min passes a max
+// the pair's overlap may change, so the overlapping-pair set is updated
+// on the spot instead of being rebuilt.
+//
+// `began`/`ended` hold the id pairs (ids from BroadphaseInput, or indices)
+// whose bounds started or stopped overlapping during the last call.
+typedef struct {
+  Endpoint      *axes[3];
+  int           count;
+  int           capacity;
+  PairSet       set;
+  PairSet       previous;
+  PairList      began;
+  PairList      ended;
+  int           *active;
+  int           static_count;
+  unsigned int  layout_version;
+  int           ready;
+} SweepAndPrune;
+
+void sweep_prune_init(SweepAndPrune *s);
+void sweep_prune_pairs(SweepAndPrune *s, const BroadphaseInput *in, PairList *out);
+void sweep_prune_destroy(SweepAndPrune *s);
+
+#endif
@@ -2,6 +2,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#ifdef HEADLESS
+
+// The caller's Mesh is moved into the RenderMesh, so its free_mesh() after
+// upload is a no-op and the data lives until renderer_free().
+RenderMesh renderer_upload_mesh(Mesh *mesh) {
+  RenderMesh rm = {0};
+  rm.mesh = *mesh;
+  rm.index_count = mesh->index_count;
+  *mesh = (Mesh){0};
+  return rm;
+}
+
+void renderer_draw(RenderMesh *rm, GLuint shader) {
+  (void)rm;
+  (void)shader;
+}
+
+void renderer_free(RenderMesh *rm) {
+  free_mesh(&rm->mesh);
+  rm->mesh = (Mesh){0};
+}
+
+#else
+
 float* get_vertex_data(Mesh *mesh) {
   float *vertex_data = malloc(mesh->vertex_count * 8 * sizeof(float));
   for (int i = 0; i < mesh->vertex_count; i++) {
@@ -66,3 +90,5 @@ void renderer_free(RenderMesh *rm) {
   glDeleteBuffers(1, &rm->vbo);
   glDeleteBuffers(1, &rm->ebo);
 }
+
+#endif
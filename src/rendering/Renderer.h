@@ -1,14 +1,25 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
-#include <GL/glew.h>
 #include "assets/Mesh.h"
 
+#ifdef HEADLESS
+typedef unsigned int GLuint;
+#else
+#include <GL/glew.h>
+#endif
+
+// Headless builds have no GL context: the RenderMesh keeps the CPU-side
+// mesh instead of GPU buffers.
 typedef struct {
   int mesh_id;
+#ifdef HEADLESS
+  Mesh mesh;
+#else
   GLuint vao;
   GLuint vbo;
   GLuint ebo;
+#endif
   int index_count;
 } RenderMesh;
 
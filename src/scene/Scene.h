@@ -1,9 +1,11 @@
 #ifndef SCENE_H
 #define SCENE_H
 
+#include "ecs/World.h"
+#ifndef HEADLESS
 #include "app/App.h"
 #include "assets/Grid.h"
-#include "ecs/World.h"
+#endif
 
 typedef struct {
   Vec3f color;
@@ -12,11 +14,15 @@ typedef struct {
 typedef struct {
   World   world;
   Skybox  skybox;
+#ifndef HEADLESS
   Grid    grid;
+#endif
 } Scene;
 
+#ifndef HEADLESS
 void scene_create(Scene *scene);
 void scene_render(Scene *scene, App *app);
 void scene_destroy(Scene *scene);
+#endif
 
 #endif
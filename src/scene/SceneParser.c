@@ -1,11 +1,15 @@
 #include "SceneParser.h"
 #include "assets/Texture.h"
+#include "core/Trace.h"
+#include "ecs/System.h"
 #include "ecs/World.h"
 #include "maths/Maths3D.h"
 #include "scene/Registry.h"
 #include "scene/Scene.h"
 #include <ctype.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 static void trimString(char *str) {
   int start = 0, end = strlen(str) -1;
@@ -26,14 +30,24 @@ static int find_id(char names[][64], int count, char *name) {
 }
 
 
+// A `collider mesh` waits for the end of its object, when the object's
+// mesh and scale are known.
+typedef struct {
+  int   active;
+  char  mesh_name[64];
+  float restitution;
+  float friction;
+} PendingMeshCollider;
+
 typedef struct {
   FILE *file;
   char line[128];
   int  in_multiline_comment;
   char mesh_names[MAX_MESHES][64];
+  Mesh meshes[MAX_MESHES];              // positions and indices, for mesh colliders
   char material_names[MAX_MATERIALS][64];
-  char current_mesh_name[64];
-  char current_mat_name[64];
+  char object_mesh[64];
+  PendingMeshCollider mesh_collider;
 } SceneIterator;
 
 static int next_line(SceneIterator *it) {
@@ -80,8 +94,15 @@ static void parse_rotation(SceneIterator *it, Entity e, World *world) {
   world_add_rotation(world, e, rotation);
 }
 
+// `collider mesh [name]` collides with the triangles of the named mesh, the
+// object's own by default, scaled like the object. Mesh colliders are
+// always static.
 static void parse_collider(SceneIterator *it, Entity e, World *world) {
   int is_static = strncmp(it->line, "collider dynamic", 16) == 0 ? 0 : 1;
+  int is_mesh = strncmp(it->line, "collider mesh", 13) == 0;
+  char mesh_name[64];
+  snprintf(mesh_name, sizeof(mesh_name), "%s", it->object_mesh);
+  if (is_mesh) sscanf(it->line, "collider mesh %63s", mesh_name);
   Vec3f half_extents = vec3f_identity();
   float restitution = 0.3;
   float friction = 0.5;
@@ -96,7 +117,12 @@ static void parse_collider(SceneIterator *it, Entity e, World *world) {
       sscanf(it->line, "friction %f", &friction);
     }
     if (strncmp(it->line, "end", 3) == 0) {
-      world_add_collider(world, e, half_extents, is_static, restitution, friction);
+      if (is_mesh) {
+        it->mesh_collider = (PendingMeshCollider){ 1, "", restitution, friction };
+        snprintf(it->mesh_collider.mesh_name, sizeof(it->mesh_collider.mesh_name), "%s", mesh_name);
+      } else {
+        world_add_collider(world, e, half_extents, is_static, restitution, friction);
+      }
       break;
     }
   }
@@ -189,19 +215,70 @@ typedef struct {
 
 // BLOCK PARSERS
 
-static void parse_object(SceneIterator *it, Scene *scene) {
-  sscanf(it->line, "object %s %s", it->current_mesh_name, it->current_mat_name);
+static void add_mesh_collider(SceneIterator *it, Scene *scene, Entity e) {
+  PendingMeshCollider *pending = &it->mesh_collider;
+  int mesh_id = find_id(it->mesh_names, scene->world.mesh_registry.count, pending->mesh_name);
+  if (mesh_id < 0) {
+    printf("Unknown collider mesh: %s\n", pending->mesh_name);
+    return;
+  }
+
+  Mesh *mesh = &it->meshes[mesh_id];
+  RotationComponent *rc = world_get_rotation(&scene->world, e);
+  ScaleComponent *sc = world_get_scale(&scene->world, e);
+  Vec3f rotation = rc ? rc->rotation : vec3f_identity();
+  Vec3f scale = sc ? sc->scale : (Vec3f){ 1.0f, 1.0f, 1.0f };
+  world_add_mesh_collider(&scene->world, e, mesh->positions, mesh->indices, mesh->index_count, rotation, scale,
+                          pending->restitution, pending->friction);
+}
+
+static void skip_block(SceneIterator *it) {
+  while (next_line(it)) {
+    if (strncmp(it->line, "end", 3) == 0) break;
+  }
+}
+
+// An `object` block may contain further `object` blocks; those become
+// children of the enclosing object and their transforms are local to it.
+// Physics works in world space, so nested objects cannot have a collider
+// or mass; those lines are reported and skipped.
+static Entity parse_object_node(SceneIterator *it, Scene *scene, Entity parent) {
+  char mesh_name[64] = "", mat_name[64] = "";
+  sscanf(it->line, "object %63s %63s", mesh_name, mat_name);
+
   Entity e = world_create_entity(&scene->world);
+  if (parent != ENTITY_NONE) world_set_parent(&scene->world, e, parent);
+
+  PendingMeshCollider outer_collider = it->mesh_collider;
+  char outer_mesh[64];
+  memcpy(outer_mesh, it->object_mesh, sizeof(outer_mesh));
+  memcpy(it->object_mesh, mesh_name, sizeof(mesh_name));
+  it->mesh_collider.active = 0;
+
   while (next_line(it)) {
 
     if (strncmp(it->line, "end", 3) == 0) {
-      int mesh_id = find_id(it->mesh_names, scene->world.mesh_registry.count, it->current_mesh_name);
-      int mat_id = find_id(it->material_names, scene->world.material_registry.count, it->current_mat_name);
+      if (it->mesh_collider.active) add_mesh_collider(it, scene, e);
+      int mesh_id = find_id(it->mesh_names, scene->world.mesh_registry.count, mesh_name);
+      int mat_id = find_id(it->material_names, scene->world.material_registry.count, mat_name);
       if (mesh_id >= 0) world_add_mesh(&scene->world, e, mesh_id);
       if (mat_id >= 0) world_add_material(&scene->world, e, mat_id);
       break;
     }
 
+    if (strncmp(it->line, "object", 6) == 0) {
+      parse_object_node(it, scene, e);
+      continue;
+    }
+
+    int is_collider = strncmp(it->line, "collider", 8) == 0;
+    if (parent != ENTITY_NONE && (is_collider || strncmp(it->line, "mass", 4) == 0)) {
+      printf("Ignoring '%s' on nested object %s - only top-level objects can be physics bodies\n",
+             it->line, mesh_name);
+      if (is_collider) skip_block(it);
+      continue;
+    }
+
     int n = sizeof(component_parsers) / sizeof(component_parsers[0]);
     for (int i = 0; i < n; i++) {
       if (strncmp(it->line, component_parsers[i].keyword, component_parsers[i].keyword_len) == 0) {
@@ -209,6 +286,25 @@ static void parse_object(SceneIterator *it, Scene *scene) {
       }
     }
   }
+
+  it->mesh_collider = outer_collider;
+  memcpy(it->object_mesh, outer_mesh, sizeof(outer_mesh));
+  return e;
+}
+
+static void parse_object(SceneIterator *it, Scene *scene) {
+  parse_object_node(it, scene, ENTITY_NONE);
+}
+
+// Mesh colliders only need positions and indices. The upload may take
+// the loaded mesh, so they get their own copy, freed when parsing ends.
+static Mesh copy_triangles(const Mesh *mesh) {
+  Mesh copy = { .vertex_count = mesh->vertex_count, .index_count = mesh->index_count };
+  copy.positions = malloc(mesh->vertex_count * sizeof(Vec3f));
+  copy.indices   = malloc(mesh->index_count * sizeof(int));
+  if (mesh->vertex_count) memcpy(copy.positions, mesh->positions, mesh->vertex_count * sizeof(Vec3f));
+  if (mesh->index_count) memcpy(copy.indices, mesh->indices, mesh->index_count * sizeof(int));
+  return copy;
 }
 
 static void parse_mesh(SceneIterator *it, Scene *scene) {
@@ -219,8 +315,15 @@ static void parse_mesh(SceneIterator *it, Scene *scene) {
   it->mesh_names[scene->world.mesh_registry.count][63] = '\0';
 
   Mesh mesh = load_obj(path);
+  Mesh triangles = copy_triangles(&mesh);
+  TRACE_ZONE("upload_mesh");
   RenderMesh rm = renderer_upload_mesh(&mesh);
-  mesh_reg_add(&scene->world.mesh_registry, rm);
+  int id = mesh_reg_add(&scene->world.mesh_registry, rm);
+  if (id >= 0) {
+    it->meshes[id] = triangles;
+  } else {
+    free_mesh(&triangles);
+  }
 
   free_mesh(&mesh);
 }
@@ -243,7 +346,9 @@ static void parse_material(SceneIterator *it, Scene *scene) {
     if (strncmp(it->line, "texture", 7) == 0) {
       char path[256];
       sscanf(it->line, "texture %s", path);
+#ifndef HEADLESS
       mat.texture_id = texture_load(path);
+#endif
     }
     if (strncmp(it->line, "end", 3) == 0) {
       mat_reg_add(&scene->world.material_registry, mat);
@@ -273,9 +378,11 @@ static const BlockParserEntry block_parsers[] = {
 };
 
 int parse_scene_file(Scene *scene, char* filepath) {
+  TRACE_FN();
   world_init(&scene->world);
 
   SceneIterator it;
+  memset(&it, 0, sizeof(SceneIterator));
 
   it.file = fopen(filepath, "r");
   if (!it.file) {
@@ -292,5 +399,9 @@ int parse_scene_file(Scene *scene, char* filepath) {
     }
   }
 
+  for (int i = 0; i < MAX_MESHES; i++) free_mesh(&it.meshes[i]);
+  fclose(it.file);
+
+  systems_bake_statics(&scene->world);
   return 0;
 }
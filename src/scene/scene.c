@@ -9,6 +9,7 @@
 #include "app/App.h"
 #include "assets/Grid.h"
 #include "camera.h"
+#include "core/Trace.h"
 #include "ecs/World.h"
 #include "maths/Maths3D.h"
 #include "rendering/Renderer.h"
@@ -20,20 +21,12 @@ void scene_create(Scene *scene) {
   parse_scene_file(scene, "scenes/scene1.scene");
 }
 
-void scene_render(Scene *scene, App *app) {
-  glClearColor(scene->skybox.color.x, scene->skybox.color.y, scene->skybox.color.z, 1.0);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-  Mat4 view = get_camera_view(&scene->world.camera);
-  Mat4 proj = mat4_perspective(1.0f, (float)app->width / app->height, 0.1f, 100.0f);
-
-  shader_use(app->shader);
-
-  glUniform3f(glGetUniformLocation(app->shader, "u_light_dir"), 0.3f, 1.0f, 0.7f);
-
+static void draw_meshes(Scene *scene, App *app, Mat4 view, Mat4 proj) {
+  TRACE_FN();
 
-  MeshComponent *mesh_c, *tmp;
-  HASH_ITER(hh, scene->world.meshes, mesh_c, tmp) {
+  SparseSet *meshes = &scene->world.components[COMPONENT_MESH];
+  for (int i = 0; i < meshes->count; i++) {
+    MeshComponent *mesh_c = sparse_set_at(meshes, MeshComponent, i);
     Entity e = mesh_c->entity;
 
     MaterialComponent *mat_c = world_get_material(&scene->world, e);
@@ -64,10 +57,26 @@ void scene_render(Scene *scene, App *app) {
 
     renderer_draw(mesh, app->shader);
   }
+}
 
-  grid_render(&scene->grid, app->flat_shader, &proj.m[0][0], &view.m[0][0]);
+void scene_render(Scene *scene, App *app) {
+  TRACE_FN();
 
-  glfwSwapBuffers(app->window);
+  glClearColor(scene->skybox.color.x, scene->skybox.color.y, scene->skybox.color.z, 1.0);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+  Mat4 view = get_camera_view(&scene->world.camera);
+  Mat4 proj = mat4_perspective(1.0f, (float)app->width / app->height, 0.1f, 100.0f);
+
+  shader_use(app->shader);
+
+  glUniform3f(glGetUniformLocation(app->shader, "u_light_dir"), 0.3f, 1.0f, 0.7f);
+
+  world_update_transforms(&scene->world);
+
+  draw_meshes(scene, app, view, proj);
+
+  grid_render(&scene->grid, app->flat_shader, &proj.m[0][0], &view.m[0][0]);
 }
 
 void scene_destroy(Scene *scene) {